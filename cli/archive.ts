@@ -0,0 +1,116 @@
+import { readdirSync, statSync, readFileSync, writeFileSync } from "fs";
+import { join, relative, sep, extname } from "path";
+
+// Must match webview/common/asset_archive.h
+const MAGIC = "TRBNPAK1";
+const VERSION = 2;
+const HEADER_SIZE = 32;
+const ENTRY_SIZE = 40;
+const ALIGNMENT = 64;
+
+const ENCODING_NONE = 0;
+const ENCODING_GZIP = 1;
+
+// Formats that are not compressed already
+const COMPRESSIBLE = new Set([
+  ".html", ".htm", ".js", ".mjs", ".css", ".json", ".map", ".txt", ".xml", ".svg", ".wasm", ".ttf", ".otf", ".ico",
+]);
+
+export type ArchiveCompression = "gzip" | false;
+
+export interface ArchiveSummary {
+  count: number;
+  bytes: number;
+  /** Total size of the assets before compression */
+  rawBytes: number;
+  compressed: number;
+}
+
+/**
+ * Writes the single-file asset archive served by the native host: a sorted
+ * path index followed by aligned blobs, so the host can map the file once
+ * and answer every request with a slice of the mapping. With compression,
+ * text-like assets are stored gzipped when that saves at least 10%.
+ */
+export class AssetArchive {
+  static write(sourceDir: string, outFile: string, compression: ArchiveCompression = false): ArchiveSummary {
+    const files = this.listFiles(sourceDir)
+      .map(file => {
+        const raw = readFileSync(file);
+        const stored = compression === "gzip" && COMPRESSIBLE.has(extname(file).toLowerCase())
+          ? this.gzip(raw)
+          : null;
+        return {
+          path: Buffer.from(relative(sourceDir, file).split(sep).join("/"), "utf8"),
+          raw,
+          data: stored ?? raw,
+          encoding: stored ? ENCODING_GZIP : ENCODING_NONE,
+        };
+      })
+      // Bytewise order, as the native binary search compares with memcmp
+      .sort((a, b) => Buffer.compare(a.path, b.path));
+
+    const stringsOffset = HEADER_SIZE + files.length * ENTRY_SIZE;
+    const stringsLength = files.reduce((total, file) => total + file.path.length, 0);
+
+    let offset = this.align(stringsOffset + stringsLength);
+    const offsets = files.map(file => {
+      const start = offset;
+      offset = this.align(start + file.data.length);
+      return start;
+    });
+
+    const archive = Buffer.alloc(files.length > 0 ? offsets[offsets.length - 1] + files[files.length - 1].data.length : offset);
+    archive.write(MAGIC, 0, "latin1");
+    archive.writeUInt32LE(VERSION, 8);
+    archive.writeUInt32LE(files.length, 12);
+    archive.writeBigUInt64LE(BigInt(stringsOffset), 16);
+    archive.writeBigUInt64LE(BigInt(stringsLength), 24);
+
+    let pathOffset = 0;
+    files.forEach((file, index) => {
+      const entry = HEADER_SIZE + index * ENTRY_SIZE;
+      archive.writeBigUInt64LE(BigInt(offsets[index]), entry);
+      archive.writeBigUInt64LE(BigInt(file.data.length), entry + 8);
+      archive.writeBigUInt64LE(BigInt(file.raw.length), entry + 16);
+      archive.writeUInt32LE(pathOffset, entry + 24);
+      archive.writeUInt32LE(file.path.length, entry + 28);
+      archive.writeUInt32LE(Bun.hash.crc32(file.raw) >>> 0, entry + 32);
+      archive.writeUInt32LE(file.encoding, entry + 36);
+
+      file.path.copy(archive, stringsOffset + pathOffset);
+      file.data.copy(archive, offsets[index]);
+      pathOffset += file.path.length;
+    });
+
+    writeFileSync(outFile, archive);
+    return {
+      count: files.length,
+      bytes: archive.length,
+      rawBytes: files.reduce((total, file) => total + file.raw.length, 0),
+      compressed: files.filter(file => file.encoding !== ENCODING_NONE).length,
+    };
+  }
+
+  private static gzip(data: Buffer): Buffer | null {
+    const compressed = Buffer.from(Bun.gzipSync(data, { level: 9 }));
+    return compressed.length <= data.length * 0.9 ? compressed : null;
+  }
+
+  private static align(offset: number): number {
+    return Math.ceil(offset / ALIGNMENT) * ALIGNMENT;
+  }
+
+  private static listFiles(dir: string): string[] {
+    const files: string[] = [];
+    for (const item of readdirSync(dir)) {
+      const path = join(dir, item);
+      if (statSync(path).isDirectory()) {
+        files.push(...this.listFiles(path));
+      } else {
+        files.push(path);
+      }
+    }
+    return files;
+  }
+}
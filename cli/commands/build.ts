@@ -3,6 +3,7 @@ import { existsSync } from "fs";
 import { $ } from "bun";
 import type { TronbunConfig, BuildOptions } from "../types.js";
 import { Utils } from "../utils.js";
+import { AssetArchive } from "../archive.js";
 import { GenerateTypesCommand } from "./generate-types.js";
 
 export class BuildCommand {
@@ -132,6 +133,16 @@ export class BuildCommand {
         }
       }
 
+      // Pack the output into one archive the native host maps at startup;
+      // dev builds keep serving the loose files so hot reload sees changes
+      const archivePath = `${outDir}.pak`;
+      await $`rm -f ${archivePath}`;
+      if (!options.dev && config.build.archive !== false) {
+        const { count, bytes, rawBytes, compressed } = AssetArchive.write(outDir, archivePath, config.build.compress ?? false);
+        const savings = compressed > 0 ? `, ${compressed} gzipped from ${rawBytes} bytes` : "";
+        console.log(`📦 Packed ${count} web assets into ${archivePath} (${bytes} bytes${savings})`);
+      }
+
       console.log("✅ Web build complete");
       return true;
     } catch (error) {
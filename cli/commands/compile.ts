@@ -164,6 +164,7 @@ export class CompileCommand {
         Utils.ensureDir(resolve(resourcesDir, "dist"));
         
         console.log("📁 Copying web assets...");
+        // Only the loose files: pages here load over file://, so dist.pak would never be read
         await Utils.copyDirectory(webDistDir, resolve(resourcesDir, "dist"));
         console.log("✅ Web assets copied");
       }
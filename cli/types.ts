@@ -15,6 +15,10 @@ export interface TronbunConfig {
     target?: string;
     minify?: boolean;
     sourcemap?: boolean;
+    /** Pack the web output into <web.outDir>.pak for tronbun://; defaults to true */
+    archive?: boolean;
+    /** Store text-like assets in the archive gzipped; off by default */
+    compress?: "gzip" | false;
   };
 }
 
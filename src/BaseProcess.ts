@@ -1,11 +1,101 @@
 import { spawn } from "bun";
 import { dirname } from "path";
+import type { NativeHost } from "./NativeHost.js";
+
+/**
+ * Transport framing for the stdin/stdout channel.
+ * - 'line': newline-delimited JSON (default)
+ * - 'length': 4-byte big-endian length prefix + JSON payload, no size ceiling.
+ *   Also carries binary frames: JSON plus raw bytes, delivered as `attachment`.
+ */
+export type IPCFraming = 'line' | 'length';
+
+/**
+ * Per-method counters kept by the native method table.
+ */
+export interface IPCMethodMetrics {
+    calls: number;
+    errors: number;
+    total_us: number;
+    max_us: number;
+}
+
+export interface BaseProcessOptions {
+    /**
+     * Transport framing requested from the native process at spawn time.
+     * Defaults to TRONBUN_IPC_FRAMING, or 'line' when unset.
+     */
+    framing?: IPCFraming;
+    /**
+     * Maximum number of commands the native process runs concurrently before
+     * it stops reading stdin. Responses are matched by id, so they may arrive
+     * in any order. Defaults to 32; 1 restores strictly serial execution.
+     */
+    maxInFlight?: number;
+    /**
+     * Milliseconds a command may wait in the native queue before it is
+     * rejected with "Command deadline exceeded". Defaults to 1000.
+     */
+    deadlineMs?: number;
+    /**
+     * Extra environment variables for the spawned process
+     */
+    env?: Record<string, string>;
+    /**
+     * Initial configuration the native object applies before its first event
+     * loop iteration. Passed as TRONBUN_CONFIG (JSON) when spawning, or with
+     * the create command when hosted.
+     */
+    config?: Record<string, any>;
+    /**
+     * Run inside a shared native host instead of spawning a process. The
+     * host's framing and in-flight settings apply; the options above are ignored.
+     */
+    host?: NativeHost;
+}
+
+/**
+ * Kinds of object a NativeHost can create
+ */
+export type HostObjectKind = 'webview' | 'tray';
+
+/**
+ * One command inside a batch.
+ */
+export interface BatchCommand {
+    method: string;
+    params?: any;
+}
+
+/**
+ * Outcome of one batched command: `result` on success, `error` otherwise.
+ */
+export interface BatchResult {
+    result?: any;
+    error?: string;
+}
+
+export interface BatchOptions {
+    /**
+     * Skip the remaining commands once one fails. Defaults to true.
+     */
+    stopOnError?: boolean;
+}
+
+const FRAME_HEADER_LENGTH = 4;
+// Set in the length of frames whose payload is a 4-byte JSON length, the JSON, then raw bytes
+const FRAME_BINARY_FLAG = 0x80000000;
+// IPC_MAX_FRAME_LENGTH on the native side, which closes the channel on anything larger
+const MAX_FRAME_LENGTH = 1024 * 1024 * 1024;
+const DEFAULT_MAX_IN_FLIGHT = 32;
 
 export interface BaseResponse {
     type: string;
     id: string;
     result?: any;
     error?: string;
+    /** Raw bytes that came with the message in a binary frame */
+    attachment?: Uint8Array;
     [key: string]: any;
 }
 
@@ -17,12 +107,45 @@ export abstract class BaseProcess {
         timeout: Timer;
     }>();
     protected isDestroyed = false;
+    protected readonly framing: IPCFraming;
+    private readonly encoder = new TextEncoder();
+    /** Shared host this object lives in, or null when it owns its process */
+    protected readonly host: NativeHost | null;
+    /** Handle addressing this object inside its host */
+    protected readonly target: number | null = null;
+
+    /**
+     * Whether cleanup() has run, e.g. because the process exited
+     */
+    get destroyed(): boolean {
+        return this.isDestroyed;
+    }
 
-    constructor(executablePath: string) {
+    constructor(executablePath: string, options: BaseProcessOptions = {}) {
+        this.framing = options.framing
+            ?? (process.env.TRONBUN_IPC_FRAMING === 'length' ? 'length' : 'line');
+        this.host = options.host ?? null;
+
+        if (this.host) {
+            // Commands are addressed to the handle; the host routes replies and events back
+            this.target = this.host.attach(this, this.getHostKind(), options.config);
+            return;
+        }
+
+        // The native process reads TRONBUN_IPC_FRAMING before touching stdin and
+        // confirms the framing in effect with an `ipc:ready` message
         this.process = spawn({
             cmd: [executablePath],
             cwd: dirname(executablePath),
             stdio: ['pipe', 'pipe', 'pipe'],
+            env: {
+                ...process.env,
+                TRONBUN_IPC_FRAMING: this.framing,
+                TRONBUN_IPC_MAX_INFLIGHT: String(options.maxInFlight ?? DEFAULT_MAX_IN_FLIGHT),
+                ...(options.deadlineMs ? { TRONBUN_IPC_DEADLINE_MS: String(options.deadlineMs) } : {}),
+                ...(options.config ? { TRONBUN_CONFIG: JSON.stringify(options.config) } : {}),
+                ...options.env,
+            },
         });
 
         this.startReadingResponses();
@@ -47,15 +170,34 @@ export abstract class BaseProcess {
     protected abstract handleSpecificResponse(response: BaseResponse): Promise<void> | void;
 
     /**
-     * Send a command to the process
+     * Object kind to create when this instance runs inside a NativeHost
      */
-    async sendCommand(method: string, params: any = {}, customId?: string): Promise<any> {
+    protected getHostKind(): HostObjectKind {
+        throw new Error(`${this.getProcessName()} cannot run inside a native host`);
+    }
+
+    /**
+     * Framing of the channel commands actually travel on: the host's when hosted
+     */
+    protected get channelFraming(): IPCFraming {
+        return this.host ? this.host.channelFraming : this.framing;
+    }
+
+    /**
+     * Send a command to the process. An attachment is sent as raw bytes after
+     * the JSON in one binary frame, which needs 'length' framing.
+     */
+    async sendCommand(method: string, params: any = {}, customId?: string, attachment?: Uint8Array): Promise<any> {
         if (this.isDestroyed) {
             throw new Error(`${this.getProcessName()} process is destroyed`);
         }
 
+        if (attachment && this.channelFraming !== 'length') {
+            throw new Error(`Binary attachments need 'length' framing`);
+        }
+
         const id = customId || Date.now().toString() + Math.random().toString(36).substring(2);
-        const command = { method, id, params };
+        const command = this.target === null ? { method, id, params } : { method, id, params, target: this.target };
     
         return new Promise((resolve, reject) => {
             const timeout = setTimeout(() => {
@@ -65,73 +207,223 @@ export abstract class BaseProcess {
     
             this.pendingCommands.set(id, { resolve, reject, timeout });
     
-            const commandJson = JSON.stringify(command) + '\n';
+            const commandJson = JSON.stringify(command);
             if (process.env.TRONBUN_DEBUG) {
-                console.debug(`📤 ${this.getProcessName()} Sending:`, commandJson.trim());
+                console.debug(`📤 ${this.getProcessName()} Sending:`, commandJson);
             }
             
-            if (this.process?.stdin) {
-                this.process.stdin.write(new TextEncoder().encode(commandJson));
+            try {
+                if (this.host) {
+                    this.host.forward(this, id, commandJson, attachment);
+                } else {
+                    this.writeMessage(commandJson, attachment);
+                }
+            } catch (error) {
+                clearTimeout(timeout);
+                this.pendingCommands.delete(id);
+                reject(error);
             }
         });
     }
 
+    /**
+     * Send several commands as a single `batch` message. The native process
+     * runs them in order within one main-thread dispatch and answers once.
+     */
+    async sendBatch(commands: BatchCommand[], options: BatchOptions = {}): Promise<BatchResult[]> {
+        if (commands.length === 0) return [];
+        return await this.sendCommand('batch', {
+            commands,
+            stop_on_error: options.stopOnError ?? true,
+        });
+    }
+
+    /**
+     * Start a batch: commands are queued locally and sent together on commit()
+     */
+    batch(options: BatchOptions = {}): CommandBatch {
+        return new CommandBatch(this, options);
+    }
+
+    /**
+     * Write one message to the process stdin using the negotiated framing.
+     * Throws before writing anything if the frame would exceed MAX_FRAME_LENGTH.
+     */
+    protected writeMessage(json: string, attachment?: Uint8Array): void {
+        if (!this.process?.stdin) return;
+
+        if (attachment) {
+            // The bytes follow the JSON as they are, in a second write
+            const frame = new Uint8Array(FRAME_HEADER_LENGTH * 2 + json.length * 3);
+            const { written } = this.encoder.encodeInto(json, frame.subarray(FRAME_HEADER_LENGTH * 2));
+            this.checkFrameLength(FRAME_HEADER_LENGTH + written + attachment.length);
+            const header = new DataView(frame.buffer);
+            header.setUint32(0, (FRAME_BINARY_FLAG | (FRAME_HEADER_LENGTH + written + attachment.length)) >>> 0);
+            header.setUint32(FRAME_HEADER_LENGTH, written);
+            this.process.stdin.write(frame.subarray(0, FRAME_HEADER_LENGTH * 2 + written));
+            this.process.stdin.write(attachment);
+        } else if (this.framing === 'length') {
+            // Encode straight after the header to send the frame in one write
+            const frame = new Uint8Array(FRAME_HEADER_LENGTH + json.length * 3);
+            const { written } = this.encoder.encodeInto(json, frame.subarray(FRAME_HEADER_LENGTH));
+            this.checkFrameLength(written);
+            new DataView(frame.buffer).setUint32(0, written);
+            this.process.stdin.write(frame.subarray(0, FRAME_HEADER_LENGTH + written));
+        } else {
+            this.process.stdin.write(this.encoder.encode(json + '\n'));
+        }
+    }
+
+    /**
+     * Reject frames the native reader would refuse, so only this message fails
+     */
+    private checkFrameLength(length: number): void {
+        if (length > MAX_FRAME_LENGTH) {
+            throw new Error(`Message of ${length} bytes exceeds the ${MAX_FRAME_LENGTH}-byte frame limit`);
+        }
+    }
+
     /**
      * Start reading responses from the process stdout
      */
     private startReadingResponses() {
         if (!this.process?.stdout) return;
 
+        const reader = this.process.stdout.getReader();
+        const readLoop = this.framing === 'length'
+            ? this.readFrames(reader)
+            : this.readLines(reader);
+
+        readLoop.catch(() => {
+            console.log(`${this.getProcessName()} stdout reading ended`);
+        });
+    }
+
+    /**
+     * Read newline-delimited messages
+     */
+    private async readLines(reader: any): Promise<void> {
         const decoder = new TextDecoder();
         let buffer = '';
 
-        const reader = this.process.stdout.getReader();
-        
-        const readLoop = async () => {
-            try {
-                while (true) {
-                    const { done, value } = await reader.read();
-                    if (done) break;
-
-                    buffer += decoder.decode(value, { stream: true });
-                    
-                    const lines = buffer.split('\n');
-                    buffer = lines.pop() || '';
-                    
-                    for (const line of lines) {
-                        if (line.trim()) {
-                            // Only log in debug mode to improve IPC performance
-                            if (process.env.TRONBUN_DEBUG) {
-                                console.log(`📥 ${this.getProcessName()} Received:`, line);
-                            }
-                            try {
-                                const response: BaseResponse = JSON.parse(line);
-                                // Handle responses asynchronously but don't await to avoid blocking the read loop
-                                this.handleResponse(response).catch(error => {
-                                    if (process.env.TRONBUN_DEBUG) {
-                                        console.error(`Error handling response:`, error);
-                                    }
-                                });
-                            } catch (error) {
-                                if (process.env.TRONBUN_DEBUG) {
-                                    console.log(`📄 ${this.getProcessName()} Raw output:`, line);
-                                }
-                            }
-                        }
-                    }
+        while (true) {
+            const { done, value } = await reader.read();
+            if (done) break;
+
+            buffer += decoder.decode(value, { stream: true });
+            
+            const lines = buffer.split('\n');
+            buffer = lines.pop() || '';
+            
+            for (const line of lines) {
+                if (line.trim()) {
+                    this.dispatchMessage(line);
                 }
-            } catch (error) {
-                console.log(`${this.getProcessName()} stdout reading ended`);
             }
-        };
+        }
+    }
 
-        readLoop();
+    /**
+     * Read length-prefixed frames into a growable buffer, so payloads of any
+     * size are decoded once, without line splitting or string concatenation
+     */
+    private async readFrames(reader: any): Promise<void> {
+        const decoder = new TextDecoder();
+        let buffer = new Uint8Array(64 * 1024);
+        let view = new DataView(buffer.buffer);
+        let start = 0;
+        let end = 0;
+
+        while (true) {
+            const { done, value } = await reader.read();
+            if (done) break;
+
+            const chunk: Uint8Array = value;
+            if (end + chunk.length > buffer.length) {
+                // Compact first, then grow if the pending frame still doesn't fit
+                buffer.copyWithin(0, start, end);
+                end -= start;
+                start = 0;
+                if (end + chunk.length > buffer.length) {
+                    const grown = new Uint8Array(Math.max(buffer.length * 2, end + chunk.length));
+                    grown.set(buffer.subarray(0, end));
+                    buffer = grown;
+                    view = new DataView(buffer.buffer);
+                }
+            }
+            buffer.set(chunk, end);
+            end += chunk.length;
+
+            while (end - start >= FRAME_HEADER_LENGTH) {
+                const header = view.getUint32(start);
+                const length = header & ~FRAME_BINARY_FLAG;
+                if (end - start - FRAME_HEADER_LENGTH < length) break;
+
+                const payloadStart = start + FRAME_HEADER_LENGTH;
+                start = payloadStart + length;
+                if (header & FRAME_BINARY_FLAG) {
+                    // Copied out, as the buffer is reused for the next frames
+                    const jsonLength = view.getUint32(payloadStart);
+                    const jsonStart = payloadStart + FRAME_HEADER_LENGTH;
+                    const message = decoder.decode(buffer.subarray(jsonStart, jsonStart + jsonLength));
+                    this.dispatchMessage(message, buffer.slice(jsonStart + jsonLength, start));
+                } else {
+                    this.dispatchMessage(decoder.decode(buffer.subarray(payloadStart, start)));
+                }
+            }
+
+            if (start === end) {
+                start = 0;
+                end = 0;
+            }
+        }
+    }
+
+    /**
+     * Parse one message and hand it to the response handler
+     */
+    private dispatchMessage(message: string, attachment?: Uint8Array): void {
+        // Only log in debug mode to improve IPC performance
+        if (process.env.TRONBUN_DEBUG) {
+            console.log(`📥 ${this.getProcessName()} Received:`, message);
+        }
+        try {
+            const response: BaseResponse = JSON.parse(message);
+            if (attachment) {
+                response.attachment = attachment;
+            }
+            // Handle responses asynchronously but don't await to avoid blocking the read loop
+            this.handleResponse(response).catch(error => {
+                if (process.env.TRONBUN_DEBUG) {
+                    console.error(`Error handling response:`, error);
+                }
+            });
+        } catch (error) {
+            if (process.env.TRONBUN_DEBUG) {
+                console.log(`📄 ${this.getProcessName()} Raw output:`, message);
+            }
+        }
+    }
+
+    /**
+     * Handle a message a NativeHost routed to this instance
+     * @internal
+     */
+    deliver(response: BaseResponse): Promise<void> {
+        return this.handleResponse(response);
     }
 
     /**
      * Handle responses from the process
      */
     private async handleResponse(response: BaseResponse) {
+        if (response.type === 'ipc:ready') {
+            if (response.data?.framing !== this.framing) {
+                console.warn(`${this.getProcessName()} does not support '${this.framing}' framing`);
+            }
+            return;
+        }
+
         // Handle standard command responses first (most common case)
         const pending = this.pendingCommands.get(response.id);
         if (pending) {   
@@ -181,6 +473,13 @@ export abstract class BaseProcess {
         }
         this.pendingCommands.clear();
 
+        // A hosted object only releases its handle; the host process keeps running
+        if (this.host) {
+            this.host.detach(this);
+            console.log(`🧹 ${this.getProcessName()} cleaned up`);
+            return;
+        }
+
         // Close streams
         if (this.process?.stdin) {
             try {
@@ -207,8 +506,72 @@ export abstract class BaseProcess {
      * Close/terminate the process
      */
     close() {
-        if (this.process) {
+        if (this.host) {
+            this.cleanup();
+        } else if (this.process) {
             this.process.kill();
         }
     }
 }
+
+/**
+ * Commands queued for a single round trip. Each add() returns a promise for
+ * that command's own result; commit() sends the batch and rejects with the
+ * first error if any command failed.
+ */
+export class CommandBatch {
+    private readonly commands: BatchCommand[] = [];
+    private readonly settlers: { resolve: (value: any) => void; reject: (error: Error) => void }[] = [];
+    private committed = false;
+
+    constructor(private readonly owner: BaseProcess, private readonly options: BatchOptions = {}) {}
+
+    get size(): number {
+        return this.commands.length;
+    }
+
+    add(method: string, params: any = {}): Promise<any> {
+        if (this.committed) {
+            throw new Error('Batch already committed');
+        }
+
+        this.commands.push({ method, params });
+        const result = new Promise<any>((resolve, reject) => {
+            this.settlers.push({ resolve, reject });
+        });
+        // Callers may only await commit(); don't report these as unhandled
+        result.catch(() => {});
+        return result;
+    }
+
+    async commit(): Promise<BatchResult[]> {
+        if (this.committed) {
+            throw new Error('Batch already committed');
+        }
+        this.committed = true;
+
+        let results: BatchResult[];
+        try {
+            results = await this.owner.sendBatch(this.commands, this.options);
+        } catch (error) {
+            for (const settler of this.settlers) settler.reject(error as Error);
+            throw error;
+        }
+
+        let firstError: string | undefined;
+        this.settlers.forEach((settler, index) => {
+            const entry = results[index] ?? { error: 'Missing batch result' };
+            if (entry.error !== undefined) {
+                firstError ??= entry.error;
+                settler.reject(new Error(entry.error));
+            } else {
+                settler.resolve(entry.result);
+            }
+        });
+
+        if (firstError !== undefined) {
+            throw new Error(firstError);
+        }
+        return results;
+    }
+}
@@ -0,0 +1,120 @@
+import { resolveWebviewPath } from "./utils.js";
+import { BaseProcess, type BaseProcessOptions, type BaseResponse, type HostObjectKind } from "./BaseProcess.js";
+import { assetConfig } from "./Webview.js";
+
+export interface NativeHostOptions extends Omit<BaseProcessOptions, 'host'> {
+    /** Directory served as tronbun://app/ to every hosted webview */
+    assetRoot?: string;
+    /** Cache-Control max-age for tronbun:// assets in seconds */
+    assetMaxAge?: number;
+}
+
+/**
+ * One native process that owns several webviews and trays, sharing a single
+ * event loop and stdio channel. Pass it as the `host` option of Webview,
+ * Window or Tray; their commands carry a target handle and the host routes
+ * replies and events back to them.
+ */
+export class NativeHost extends BaseProcess {
+    private readonly objects = new Map<number, BaseProcess>();
+    // Command ids awaiting a reply, by the object that sent them
+    private readonly commandOwners = new Map<string, BaseProcess>();
+    private nextHandle = 1;
+
+    constructor(options: NativeHostOptions = {}) {
+        const assets = assetConfig(options.assetRoot, options.assetMaxAge);
+        super(resolveWebviewPath(), {
+            ...options,
+            env: { ...options.env, TRONBUN_HOST_MODE: '1' },
+            config: assets ? { ...options.config, assets } : options.config,
+        });
+    }
+
+    protected getProcessName(): string {
+        return "NativeHost";
+    }
+
+    /**
+     * Create the native object for a hosted instance. The handle is chosen
+     * here, so the instance can queue commands before the host has answered.
+     * @internal
+     */
+    attach(owner: BaseProcess, kind: HostObjectKind, config?: Record<string, any>): number {
+        const handle = this.nextHandle++;
+        this.objects.set(handle, owner);
+        this.sendCommand(`host_create_${kind}`, config ? { handle, config } : { handle }).catch(error => {
+            console.error(`Failed to create hosted ${kind}:`, error);
+            this.objects.delete(handle);
+            owner.cleanup();
+        });
+        return handle;
+    }
+
+    /**
+     * Destroy the native object of a hosted instance
+     * @internal
+     */
+    detach(owner: BaseProcess): void {
+        for (const [id, commandOwner] of this.commandOwners) {
+            if (commandOwner === owner) this.commandOwners.delete(id);
+        }
+        for (const [handle, object] of this.objects) {
+            if (object !== owner) continue;
+            this.objects.delete(handle);
+            if (!this.isDestroyed) {
+                this.sendCommand('host_destroy', { handle }).catch(() => {});
+            }
+        }
+    }
+
+    /**
+     * Write a hosted instance's command to the shared channel
+     * @internal
+     */
+    forward(owner: BaseProcess, id: string, json: string, attachment?: Uint8Array): void {
+        if (this.isDestroyed) return;
+        this.commandOwners.set(id, owner);
+        try {
+            this.writeMessage(json, attachment);
+        } catch (error) {
+            this.commandOwners.delete(id);
+            throw error;
+        }
+    }
+
+    protected async handleSpecificResponse(response: BaseResponse): Promise<void> {
+        // Events name their object; replies are matched by the command id
+        if (response.target !== undefined) {
+            const owner = this.objects.get(response.target);
+            if (!owner) return;
+
+            if (response.type === 'host:closed') {
+                // The user closed the window; the native side already released it
+                this.objects.delete(response.target);
+                owner.cleanup();
+                return;
+            }
+            await owner.deliver(response);
+            return;
+        }
+
+        const owner = this.commandOwners.get(response.id);
+        if (owner) {
+            this.commandOwners.delete(response.id);
+            await owner.deliver(response);
+        }
+    }
+
+    // Hosted objects go away with the process
+    override cleanup(): void {
+        if (this.isDestroyed) return;
+        super.cleanup();
+
+        const owners = [...this.objects.values()];
+        this.objects.clear();
+        this.commandOwners.clear();
+        for (const owner of owners) {
+            owner.cleanup();
+        }
+    }
+}
@@ -1,5 +1,6 @@
 import { resolveWebviewPath } from "./utils.js";
-import { BaseProcess, type BaseResponse } from "./BaseProcess.js";
+import { BaseProcess, type CommandBatch, type BaseResponse, type HostObjectKind, type IPCFraming, type IPCMethodMetrics } from "./BaseProcess.js";
+import type { NativeHost } from "./NativeHost.js";
 
 export interface TrayMenuItem {
     id: string;
@@ -16,25 +17,71 @@ export interface TrayOptions {
     icon: string;
     tooltip?: string;
     menu?: TrayMenuItem[];
+    /** Transport framing for the native process (see BaseProcessOptions) */
+    framing?: IPCFraming;
+    /** Create this tray in a shared native host instead of its own process */
+    host?: NativeHost;
 }
 
 export interface TrayResponse extends BaseResponse {
-    type: 'response' | 'menu_click';
+    type: 'response' | 'menu_click' | 'notification';
     data?: {
         menuId?: string;
+        id?: string;
+        status?: TrayNotificationStatus;
+        error?: string;
     };
 }
 
+/** `replaced` means a newer notification with the same tag superseded it before it was shown */
+export type TrayNotificationStatus = 'shown' | 'failed' | 'replaced';
+
+export interface TrayNotificationOptions {
+    /** Notifications sharing a tag replace each other instead of stacking */
+    tag?: string;
+}
+
+export interface TrayNotificationLimit {
+    /** Notifications allowed at once; 0 disables the limit */
+    burst: number;
+    /** One more notification is allowed every intervalMs */
+    intervalMs?: number;
+}
+
 export type TrayMenuClickHandler = (menuId: string) => void;
 
+/** Menu item fields the native process knows about (callbacks stay in Bun) */
+type NativeMenuItem = Omit<TrayMenuItem, 'callback' | 'submenu'>;
+
+function toNativeItem(item: TrayMenuItem): NativeMenuItem {
+    const { callback: _callback, submenu: _submenu, ...native } = item;
+    return native;
+}
+
+function sameNativeItem(a: TrayMenuItem, b: TrayMenuItem): boolean {
+    return a.label === b.label
+        && (a.type ?? 'normal') === (b.type ?? 'normal')
+        && (a.enabled ?? true) === (b.enabled ?? true)
+        && (a.checked ?? false) === (b.checked ?? false)
+        && a.accelerator === b.accelerator;
+}
+
+function hasUniqueIds(menu: TrayMenuItem[]): boolean {
+    return new Set(menu.map(item => item.id)).size === menu.length;
+}
+
 export class Tray extends BaseProcess {
     private menuClickHandlers = new Map<string, TrayMenuClickHandler>();
+    // Last menu sent to the native process, used to diff the next setMenu()
+    private currentMenu: TrayMenuItem[] | null = null;
+    private pendingNotifications = new Map<string, { resolve: (status: TrayNotificationStatus) => void; reject: (error: Error) => void }>();
+    private notificationCounter = 0;
 
     constructor(options: TrayOptions) {
         // Resolve the tray executable path using cross-platform utility
         const webviewPath = resolveWebviewPath();
         const trayPath = webviewPath.replace('webview_main', 'tray_main');
-        super(trayPath);
+        super(trayPath, { framing: options.framing, host: options.host });
 
         // Initialize tray with options
         this.initialize(options);
@@ -44,6 +91,10 @@ export class Tray extends BaseProcess {
         return "Tray";
     }
 
+    protected override getHostKind(): HostObjectKind {
+        return 'tray';
+    }
+
     protected async handleSpecificResponse(response: TrayResponse): Promise<void> {
         if (response.type === 'menu_click') {
             const menuId = response.data?.menuId;
@@ -55,6 +106,20 @@ export class Tray extends BaseProcess {
             }
             return;
         }
+
+        if (response.type === 'notification') {
+            const id = response.data?.id;
+            const pending = id ? this.pendingNotifications.get(id) : undefined;
+            if (id && pending) {
+                this.pendingNotifications.delete(id);
+                if (response.data?.status === 'failed') {
+                    pending.reject(new Error(response.data.error ?? 'Notification failed'));
+                } else {
+                    pending.resolve(response.data?.status ?? 'shown');
+                }
+            }
+            return;
+        }
     }
 
     private async initialize(options: TrayOptions) {
@@ -78,6 +143,10 @@ export class Tray extends BaseProcess {
     override cleanup(): void {
         // Clear handlers before calling parent cleanup
         this.menuClickHandlers.clear();
+        for (const pending of this.pendingNotifications.values()) {
+            pending.reject(new Error('Tray destroyed'));
+        }
+        this.pendingNotifications.clear();
         super.cleanup();
     }
 
@@ -111,6 +180,37 @@ export class Tray extends BaseProcess {
         await this.sendCommand('tray_set_icon', { icon: iconPath });
     }
 
+    /**
+     * Set the tray icon from encoded image bytes (PNG), without a temp file.
+     * Decoded icons are cached natively, so switching between a few generated
+     * icons only decodes each one once.
+     * @param data Image bytes
+     */
+    async setIconData(data: Uint8Array | ArrayBuffer): Promise<void> {
+        const bytes = data instanceof ArrayBuffer ? new Uint8Array(data) : data;
+        await this.sendCommand('tray_set_icon_data', {
+            data: Buffer.from(bytes.buffer, bytes.byteOffset, bytes.byteLength).toString('base64'),
+        });
+    }
+
+    /**
+     * Animate the tray icon natively. Frames are decoded once and cycled by a
+     * timer in the tray process, so this is one command per animation rather
+     * than one per frame. Setting an icon or calling stopAnimation() ends it.
+     * @param frames Paths of the frame images, in order
+     * @param intervalMs Time each frame is shown
+     */
+    async setAnimation(frames: string[], intervalMs: number = 100): Promise<void> {
+        await this.sendCommand('tray_set_animation', { frames, interval_ms: intervalMs });
+    }
+
+    /**
+     * Stop the icon animation and restore the icon shown before it started
+     */
+    async stopAnimation(): Promise<void> {
+        await this.sendCommand('tray_stop_animation');
+    }
+
     /**
      * Set the tray tooltip
      * @param tooltip Tooltip text
@@ -120,13 +220,153 @@ export class Tray extends BaseProcess {
     }
 
     /**
-     * Set the tray menu
+     * Set the tray menu. After the first call only the items that changed are
+     * sent, as one batch of update/insert/remove commands keyed by item id.
      * @param menu Array of menu items
      */
     async setMenu(menu: TrayMenuItem[]): Promise<void> {
         // Register any inline callbacks before setting the menu
         this.registerMenuCallbacks(menu);
-        await this.sendCommand('tray_set_menu', { menu });
+
+        const previous = this.currentMenu;
+        const changes = previous ? this.diffMenu(previous, menu) : null;
+        this.currentMenu = menu.map(item => ({ ...item }));
+
+        try {
+            if (!changes) {
+                await this.sendCommand('tray_set_menu', { menu });
+            } else if (changes.size > 0) {
+                await changes.commit();
+            }
+        } catch (error) {
+            // The native menu is in an unknown state; rebuild it next time
+            this.currentMenu = null;
+            throw error;
+        }
+    }
+
+    /**
+     * Update a single menu item in place
+     * @param item New state of the item (matched by id)
+     */
+    async updateMenuItem(item: TrayMenuItem): Promise<void> {
+        this.registerMenuCallbacks([item]);
+        await this.sendCommand('tray_update_item', { item: toNativeItem(item) });
+        if (this.currentMenu) {
+            const index = this.currentMenu.findIndex(existing => existing.id === item.id);
+            if (index >= 0) this.currentMenu[index] = { ...item };
+        }
+    }
+
+    /**
+     * Insert a single menu item
+     * @param item Item to insert
+     * @param position Index to insert at (appends when omitted)
+     */
+    async insertMenuItem(item: TrayMenuItem, position?: number): Promise<void> {
+        this.registerMenuCallbacks([item]);
+        await this.sendCommand('tray_insert_item', { item: toNativeItem(item), position: position ?? -1 });
+        if (this.currentMenu) {
+            const index = position === undefined || position < 0 ? this.currentMenu.length : position;
+            this.currentMenu.splice(index, 0, { ...item });
+        }
+    }
+
+    /**
+     * Remove a single menu item
+     * @param id Menu item ID
+     */
+    async removeMenuItem(id: string): Promise<void> {
+        await this.sendCommand('tray_remove_item', { id });
+        if (this.currentMenu) {
+            this.currentMenu = this.currentMenu.filter(item => item.id !== id);
+        }
+    }
+
+    /**
+     * Build the item commands that turn the previous menu into the next one,
+     * or return null when a full tray_set_menu is simpler
+     */
+    private diffMenu(previous: TrayMenuItem[], next: TrayMenuItem[]): CommandBatch | null {
+        if (!hasUniqueIds(previous) || !hasUniqueIds(next)) return null;
+        if (next.some(item => item.submenu?.length) || previous.some(item => item.submenu?.length)) return null;
+
+        const batch = this.batch();
+        const nextIds = new Set(next.map(item => item.id));
+        const live = previous.filter(item => {
+            if (nextIds.has(item.id)) return true;
+            batch.add('tray_remove_item', { id: item.id });
+            return false;
+        });
+
+        next.forEach((item, index) => {
+            const current = live[index];
+            if (current?.id === item.id) {
+                if (!sameNativeItem(current, item)) {
+                    batch.add('tray_update_item', { item: toNativeItem(item) });
+                }
+                return;
+            }
+
+            // Moved or new: (re)insert at this index
+            const moved = live.findIndex(existing => existing.id === item.id);
+            if (moved >= 0) {
+                batch.add('tray_remove_item', { id: item.id });
+                live.splice(moved, 1);
+            }
+            batch.add('tray_insert_item', { item: toNativeItem(item), position: index });
+            live.splice(index, 0, item);
+        });
+
+        // A mostly new menu is cheaper to send whole
+        return batch.size > next.length ? null : batch;
+    }
+
+    /**
+     * Show a notification. The native side queues it without blocking other
+     * tray commands; the promise settles once the notification server answers.
+     * @param title Notification title
+     * @param body Notification body
+     * @param options Tag used to replace an earlier notification
+     * @returns 'shown', or 'replaced' if a newer one with the same tag won
+     */
+    async showNotification(title: string, body: string, options: TrayNotificationOptions = {}): Promise<TrayNotificationStatus> {
+        const notificationId = `notification-${++this.notificationCounter}`;
+        const outcome = new Promise<TrayNotificationStatus>((resolve, reject) => {
+            this.pendingNotifications.set(notificationId, { resolve, reject });
+        });
+
+        try {
+            await this.sendCommand('tray_show_notification', {
+                title,
+                body,
+                tag: options.tag,
+                notification_id: notificationId,
+            });
+        } catch (error) {
+            this.pendingNotifications.delete(notificationId);
+            throw error;
+        }
+        return await outcome;
+    }
+
+    /**
+     * Limit how many notifications the tray shows; extra ones are rejected
+     * @param limit Burst size and refill interval
+     */
+    async setNotificationLimit(limit: TrayNotificationLimit): Promise<void> {
+        await this.sendCommand('tray_configure_notifications', {
+            burst: limit.burst,
+            interval_ms: limit.intervalMs ?? 1000,
+        });
+    }
+
+    /**
+     * Get per-method call counts and timings from the native tray process
+     */
+    async getMetrics(): Promise<Record<string, IPCMethodMetrics>> {
+        const result = await this.sendCommand('tray_get_metrics');
+        return typeof result === 'string' ? JSON.parse(result) : result;
     }
 
     /**
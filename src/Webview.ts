@@ -1,5 +1,6 @@
 import { resolveWebviewPath } from "./utils.js";
-import { BaseProcess, type BaseResponse } from "./BaseProcess.js";
+import { BaseProcess, type BaseResponse, type HostObjectKind, type IPCFraming, type IPCMethodMetrics } from "./BaseProcess.js";
+import type { NativeHost } from "./NativeHost.js";
 
 export interface WebViewOptions {
     debug?: boolean;
@@ -18,63 +19,327 @@ export interface WebViewOptions {
     position?: { x: number; y: number };
     center?: boolean;
     hidden?: boolean;
+    /**
+     * Keep the window hidden until there is something to show: its first
+     * contentful paint (true or 'paint'), or the page calling
+     * window.tronbun.ready() ('mark'). Ignored when `hidden` is set.
+     */
+    showWhenReady?: boolean | 'paint' | 'mark';
+    /**
+     * Directory served as tronbun://app/ (see webAssetUrl). Fixed for the
+     * process; hosted webviews use the host's assetRoot instead.
+     */
+    assetRoot?: string;
+    /** Cache-Control max-age for tronbun:// assets in seconds; 0 (default) revalidates every load */
+    assetMaxAge?: number;
+    /** Transport framing for the native process (see BaseProcessOptions) */
+    framing?: IPCFraming;
+    /** Commands the native process may run concurrently (see BaseProcessOptions) */
+    maxInFlight?: number;
+    /** Open this webview in a shared native host instead of its own process */
+    host?: NativeHost;
 }  
+/**
+ * Page lifecycle states pushed by the native side. `dom-ready` and `finished`
+ * are reported on every platform; `started`, `failed` and `crashed` need
+ * engine load events (WebKitGTK).
+ */
+export type WebViewLoadState = 'started' | 'dom-ready' | 'finished' | 'failed' | 'crashed';
+
+export interface WebViewLoadEvent {
+    state: WebViewLoadState;
+    url?: string;
+    /** failed and crashed only */
+    error?: string;
+}
+
+/**
+ * Startup milestones of a webview, in ms since its native process started
+ * (or since the host created it). Unreached milestones are left out.
+ */
+export interface WebViewStartupTiming {
+    /** What ended startup: first paint, the page's ready mark, end of load, or a failed load */
+    trigger: 'paint' | 'mark' | 'load' | 'error';
+    /** Native window and web view created */
+    windowMs?: number;
+    /** Initial navigation issued */
+    navigationMs?: number;
+    domReadyMs?: number;
+    /** Startup ended; the window was shown here with showWhenReady */
+    readyMs: number;
+    /** From the Webview constructor to the startup event arriving in Bun */
+    totalMs: number;
+}
+
+/**
+ * A local file the page can fetch from the native process directly
+ */
+export interface SharedFile {
+    token: string;
+    /** tronbun://file/<token>; append "/<name>" freely, e.g. for download names */
+    url: string;
+}
+
 export interface WebViewResponse extends BaseResponse {
-    type: 'response' | 'bind_callback' | 'ipc:call';
+    type: 'response' | 'bind_callback' | 'ipc:call' | 'load' | 'startup';
     req?: any;
     seq?: string;
+    /** ipc:call only: channel and payload exactly as passed to window.tronbun.invoke */
+    channel?: string;
+    data?: any;
+    /** ipc:call only: the payload is the frame's attachment instead of data */
+    binary?: boolean;
+    /** load only */
+    state?: WebViewLoadState;
+    url?: string;
+}
+
+// Page bytes that couldn't travel raw arrive base64-encoded under this key,
+// and Uint8Array results for JSON calls go back the same way
+const BINARY_MARKER = '__tronbun_binary';
+
+function asBytes(value: any): Uint8Array | null {
+    if (value instanceof Uint8Array) return value;
+    if (value instanceof ArrayBuffer) return new Uint8Array(value);
+    if (ArrayBuffer.isView(value)) return new Uint8Array(value.buffer, value.byteOffset, value.byteLength);
+    return null;
+}
+
+function decodeBinaryMarker(data: any): any {
+    if (data && typeof data[BINARY_MARKER] === 'string') {
+        return new Uint8Array(Buffer.from(data[BINARY_MARKER], 'base64'));
+    }
+    return data;
+}
+
+function showWhen(options: WebViewOptions): 'paint' | 'mark' | undefined {
+    if (!options.showWhenReady) return undefined;
+    return options.showWhenReady === 'mark' ? 'mark' : 'paint';
+}
+
+/**
+ * Native configuration for the tronbun:// asset root, shared by webviews and hosts
+ */
+export function assetConfig(root?: string, maxAge?: number): Record<string, any> | undefined {
+    return root ? { root, max_age: maxAge ?? 0 } : undefined;
+}
+
+// Options that only take effect at creation time; always passed along
+function baseConfig(options: WebViewOptions): Record<string, any> {
+    return {
+        debug: options.debug ?? true,
+        hidden: options.hidden,
+        show_when: showWhen(options),
+        assets: assetConfig(options.assetRoot, options.assetMaxAge),
+    };
+}
+
+// Environment blocks are limited in size; larger configurations go over IPC
+const MAX_SPAWN_CONFIG_BYTES = 32 * 1024;
+
+/**
+ * Native window configuration for the options that can be applied at
+ * creation time, or null when it would be too large to pass along
+ */
+function spawnConfig(options: WebViewOptions): Record<string, any> | null {
+    const config: Record<string, any> = {
+        ...baseConfig(options),
+        title: options.title,
+        width: options.width,
+        height: options.height,
+        html: options.html,
+        url: options.url,
+        init: options.initScript ? [options.initScript] : undefined,
+        always_on_top: options.alwaysOnTop,
+        transparent: options.transparent,
+        opaque: options.opaque,
+        blur: options.blur,
+        decorations: options.decorations,
+        resizable: options.resizable,
+        position: options.position,
+        center: options.center,
+    };
+    return JSON.stringify(config).length <= MAX_SPAWN_CONFIG_BYTES ? config : null;
 }
 
 export class Webview extends BaseProcess {
     private bindCallbacks = new Map<string, (data: any) => void>();
-
-    public onIPC = (channel: string, data: any) => {
+    private domReady = false;
+    private readyWaiters: Array<{ resolve: () => void; reject: (error: Error) => void }> = [];
+
+    /**
+     * Handles window.tronbun.invoke calls. ArrayBuffer and typed array
+     * payloads arrive as a Uint8Array; return one to answer with raw bytes.
+     */
+    public onIPC = (channel: string, data: any): any => {
         console.log('onIPC', channel, data);
     };
 
+    /** Called for every page lifecycle event */
+    public onLoad: (event: WebViewLoadEvent) => void = () => undefined;
+
+    /** Called once, when startup ends (see WebViewStartupTiming) */
+    public onStartup: (timing: WebViewStartupTiming) => void = () => undefined;
+
+    /** Set when startup ended; null again once a pool takes the webview back */
+    public startupTiming: WebViewStartupTiming | null = null;
+
+    private readonly createdAt = performance.now();
+
     protected getProcessName(): string {
         return "WebView";
     }
 
+    protected override getHostKind(): HostObjectKind {
+        return 'webview';
+    }
+
     protected async handleSpecificResponse(response: WebViewResponse): Promise<void> {
-        if (response.type === 'ipc:call' && response.req) {
+        if (response.type === 'ipc:call' && response.channel !== undefined) {
             if (process.env.TRONBUN_DEBUG) {
-                console.log('ipc:call', response.req);
+                console.log('ipc:call', response.channel, response.data);
             }
 
-            const payload = JSON.parse(response.req[1]);
-            const result = await this.onIPC(payload.channel, payload.data);
-            this.sendCommand('ipc:response', { id: response.seq, result: result ?? "" }, response.seq);
+            // channel and data arrive as first-class fields, already decoded with the
+            // line; bytes from a binary call are the frame's attachment
+            const data = response.binary
+                ? response.attachment ?? new Uint8Array(0)
+                : decodeBinaryMarker(response.data);
+            let result: any;
+            try {
+                result = await this.onIPC(response.channel, data);
+            } catch (error) {
+                const message = error instanceof Error ? error.message : String(error);
+                this.sendCommand('ipc:response', { id: response.seq, error: message }, response.seq);
+                return;
+            }
+
+            const bytes = asBytes(result);
+            if (bytes && response.binary && this.channelFraming === 'length') {
+                this.sendCommand('ipc:response', { id: response.seq, binary: true }, response.seq, bytes);
+            } else if (bytes) {
+                const encoded = Buffer.from(bytes.buffer, bytes.byteOffset, bytes.byteLength).toString('base64');
+                this.sendCommand('ipc:response', { id: response.seq, result: { [BINARY_MARKER]: encoded } }, response.seq);
+            } else {
+                this.sendCommand('ipc:response', { id: response.seq, result: result ?? "" }, response.seq);
+            }
+        } else if (response.type === 'load' && response.state) {
+            this.handleLoadEvent({ state: response.state, url: response.url, error: response.error });
+        } else if (response.type === 'startup' && !this.startupTiming) {
+            this.startupTiming = {
+                trigger: response.trigger,
+                windowMs: response.window_ms,
+                navigationMs: response.navigation_ms,
+                domReadyMs: response.dom_ready_ms,
+                readyMs: response.ready_ms,
+                totalMs: Math.round(performance.now() - this.createdAt),
+            };
+            this.onStartup(this.startupTiming);
+        }
+    }
+
+    private handleLoadEvent(event: WebViewLoadEvent): void {
+        if (event.state === 'started' || event.state === 'crashed') {
+            this.domReady = false;
+        } else if (event.state === 'dom-ready' || event.state === 'finished') {
+            this.domReady = true;
+            for (const waiter of this.readyWaiters.splice(0)) waiter.resolve();
         }
+        this.onLoad(event);
+    }
+
+    /**
+     * Resolve once the current page's DOM is ready, instead of sleeping
+     * before talking to the page. Rejects after timeoutMs, if given.
+     */
+    whenReady(timeoutMs?: number): Promise<void> {
+        if (this.domReady) return Promise.resolve();
+        if (this.isDestroyed) return Promise.reject(new Error(`${this.getProcessName()} process is destroyed`));
+
+        return new Promise((resolve, reject) => {
+            const waiter = { resolve, reject };
+            this.readyWaiters.push(waiter);
+            if (timeoutMs === undefined) return;
+
+            const timer = setTimeout(() => {
+                const index = this.readyWaiters.indexOf(waiter);
+                if (index >= 0) this.readyWaiters.splice(index, 1);
+                reject(new Error(`Page not ready after ${timeoutMs}ms`));
+            }, timeoutMs);
+            waiter.resolve = () => { clearTimeout(timer); resolve(); };
+            waiter.reject = (error: Error) => { clearTimeout(timer); reject(error); };
+        });
     }
 
     constructor(options: WebViewOptions = {}) {
         // Resolve the webview executable path using cross-platform utility
         const webviewPath = resolveWebviewPath();
-        super(webviewPath);
-
-         // Apply initial options
-        if (options.title) this.setTitle(options.title);
-        if (options.width && options.height) this.setSize(options.width, options.height);
-        if (options.html) this.setHtml(options.html);
-        
-        if (options.initScript) this.init(options.initScript);
-        else if (options.url) this.navigate(options.url);
-
-        if (options.alwaysOnTop) this.setAlwaysOnTop(options.alwaysOnTop);
-        if (options.transparent) this.setTransparent();
-        if (options.opaque) this.setOpaque();
-        if (options.blur) this.enableBlur();
-        if (options.decorations === false) this.removeDecorations();
-        if (options.resizable) this.setResizable(options.resizable);
-        if (options.position) this.setPosition(options.position.x, options.position.y);
-        if (options.center) this.centerWindow();
-        if (options.hidden) this.hideWindow();
+        // The window is configured before its first frame, without a round trip
+        const config = spawnConfig(options);
+        super(webviewPath, {
+            framing: options.framing,
+            maxInFlight: options.maxInFlight,
+            host: options.host,
+            config: config ?? baseConfig(options),
+        });
+
+        if (!config) {
+            this.configure(options).catch(error => {
+                console.error('Failed to apply window options:', error);
+            });
+        }
+    }
+
+    /**
+     * Apply window options in one round trip; a failing option doesn't block the rest.
+     * With `show`, a hidden window (e.g. one claimed from a WebviewPool) is shown
+     * last unless `options.hidden` is set.
+     */
+    async configure(options: WebViewOptions, show: boolean = false): Promise<void> {
+        const setup = this.batch({ stopOnError: false });
+        if (options.title) setup.add('set_title', { title: options.title });
+        if (options.width && options.height) setup.add('set_size', { width: options.width, height: options.height, hints: 0 });
+        if (options.initScript) setup.add('init', { js: options.initScript });
+        if (options.html || options.url) this.domReady = false;
+        if (options.html) setup.add('set_html', { html: options.html });
+        else if (options.url) setup.add('navigate', { url: options.url });
+
+        if (options.alwaysOnTop) setup.add('window_set_always_on_top', { on_top: 1 });
+        if (options.transparent) setup.add('window_set_transparent');
+        if (options.opaque) setup.add('window_set_opaque');
+        if (options.blur) setup.add('window_enable_blur');
+        if (options.decorations === false) setup.add('window_remove_decorations');
+        if (options.resizable) setup.add('window_set_resizable', { resizable: 1 });
+        if (options.position) setup.add('window_set_position', { x: options.position.x, y: options.position.y });
+        if (options.center) setup.add('window_center');
+        if (options.hidden) setup.add('window_hide');
+        else if (show) setup.add('window_show');
+
+        if (setup.size > 0) {
+            await setup.commit();
+        }
+    }
+
+    /**
+     * Return the webview to its freshly started state: hidden, default title
+     * and size, blank page, no bindings, no cookies, storage or cache. Resolves
+     * false when state remains that cannot be undone (init scripts, blur, or
+     * website data where the platform can't clear it), so the instance shouldn't be reused.
+     */
+    async reset(): Promise<boolean> {
+        this.bindCallbacks.clear();
+        this.domReady = false;
+        const result = await this.sendCommand('reset');
+        const state = typeof result === 'string' ? JSON.parse(result) : result;
+        return state?.pristine === true;
     }
     // Override cleanup to also clear bind callbacks
     override cleanup(): void {
         // Clear callbacks before calling parent cleanup
         this.bindCallbacks.clear();
+        for (const waiter of this.readyWaiters.splice(0)) {
+            waiter.reject(new Error(`${this.getProcessName()} process is destroyed`));
+        }
         super.cleanup();
     }
 
@@ -89,10 +354,12 @@ export class Webview extends BaseProcess {
   }
 
   async navigate(url: string): Promise<void> {
+    this.domReady = false;
     await this.sendCommand('navigate', { url });
   }
 
   async setHtml(html: string): Promise<void> {
+    this.domReady = false;
     await this.sendCommand('set_html', { html });
   }
 
@@ -129,9 +396,38 @@ export class Webview extends BaseProcess {
     return typeof result === 'string' ? JSON.parse(result) : result;
   }
 
+  async getMetrics(): Promise<Record<string, IPCMethodMetrics>> {
+    const result = await this.sendCommand('get_metrics');
+    return typeof result === 'string' ? JSON.parse(result) : result;
+  }
+
+  /**
+   * Whether the current page's DOM is ready (see also whenReady() and onLoad)
+   */
   async isready(): Promise<boolean> {
     const result = await this.sendCommand('isready');
-    return result;
+    return result === true || result === 'true';
+  }
+
+  /**
+   * Let pages fetch a local file as tronbun://file/<token>, with Range support.
+   * The native process streams it from disk, so the contents never go
+   * through Bun. The token is valid for the whole native process (every view
+   * of a NativeHost) until unshareFile(). Served on Linux only for now.
+   * @param path Absolute path of a regular file
+   */
+  async shareFile(path: string): Promise<SharedFile> {
+    const result = await this.sendCommand('share_file', { path });
+    return typeof result === 'string' ? JSON.parse(result) : result;
+  }
+
+  /**
+   * Stop serving a file shared with shareFile(); downloads already started finish
+   * @returns false if the token was not shared
+   */
+  async unshareFile(token: string): Promise<boolean> {
+    const result = await this.sendCommand('unshare_file', { token });
+    return result === true || result === 'true';
   }
 
   // === Platform Window Control Methods ===
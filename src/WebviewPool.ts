@@ -0,0 +1,107 @@
+import { Webview, type WebViewOptions } from "./Webview.js";
+import type { IPCFraming } from "./BaseProcess.js";
+
+export interface WebviewPoolOptions {
+    /** Hidden, fully initialized webviews kept ready. Defaults to 1 */
+    size?: number;
+    /** Transport framing for the pooled processes (see BaseProcessOptions) */
+    framing?: IPCFraming;
+    /** Commands each pooled process may run concurrently (see BaseProcessOptions) */
+    maxInFlight?: number;
+}
+
+/**
+ * Keeps webview processes spawned and initialized ahead of time, so opening a
+ * window only costs one configuration round trip. Claimed instances are
+ * replaced in the background; released ones are reset and reused when the
+ * native side reports them pristine.
+ */
+export class WebviewPool {
+    private readonly idle: Webview[] = [];
+    private readonly size: number;
+    private closed = false;
+
+    constructor(private readonly options: WebviewPoolOptions = {}) {
+        this.size = Math.max(0, options.size ?? 1);
+        this.refill();
+    }
+
+    /**
+     * Number of webviews ready to be claimed
+     */
+    get available(): number {
+        return this.idle.length;
+    }
+
+    /**
+     * Claim a prewarmed webview and configure it, or spawn one if the pool is empty
+     */
+    acquire(options: WebViewOptions = {}): Webview {
+        let webview = this.idle.shift();
+        // Drop instances whose process exited while they waited
+        while (webview?.destroyed) webview = this.idle.shift();
+
+        if (!webview || this.poolIncompatible(options)) {
+            if (webview) this.idle.unshift(webview);
+            return new Webview(options);
+        }
+
+        webview.configure(options, true).catch(error => {
+            console.error('Failed to apply window options:', error);
+        });
+        setTimeout(() => this.refill(), 0);
+        return webview;
+    }
+
+    /**
+     * Give a webview back: it is reset and kept if there is room and nothing
+     * irreversible was done to it, otherwise its process is stopped
+     */
+    async release(webview: Webview): Promise<void> {
+        if (!this.closed && this.idle.length < this.size && !webview.destroyed) {
+            try {
+                if (await webview.reset() && !this.closed && this.idle.length < this.size) {
+                    // Nothing of the previous owner may reach the next one
+                    webview.onIPC = () => undefined;
+                    webview.onLoad = () => undefined;
+                    webview.onStartup = () => undefined;
+                    webview.startupTiming = null;
+                    this.idle.push(webview);
+                    return;
+                }
+            } catch (error) {
+                // Not reusable; fall through and stop it
+            }
+        }
+        webview.cleanup();
+    }
+
+    /**
+     * Stop every idle webview; claimed ones are left to their owners
+     */
+    close(): void {
+        this.closed = true;
+        for (const webview of this.idle.splice(0)) {
+            webview.cleanup();
+        }
+    }
+
+    // Options that only take effect at spawn time can't be applied to a pooled instance
+    private poolIncompatible(options: WebViewOptions): boolean {
+        return options.host !== undefined
+            || !!options.showWhenReady
+            || options.assetRoot !== undefined
+            || (options.framing !== undefined && options.framing !== this.options.framing)
+            || (options.maxInFlight !== undefined && options.maxInFlight !== this.options.maxInFlight);
+    }
+
+    private refill(): void {
+        while (!this.closed && this.idle.length < this.size) {
+            this.idle.push(new Webview({
+                hidden: true,
+                framing: this.options.framing,
+                maxInFlight: this.options.maxInFlight,
+            }));
+        }
+    }
+}
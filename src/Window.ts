@@ -1,8 +1,12 @@
 import { Webview } from "./Webview";
-import type { WebViewOptions } from "./Webview";
+import type { WebViewOptions, SharedFile } from "./Webview";
 import { setupHotReload } from "./utils";
+import type { WebviewPool } from "./WebviewPool";
 
-export interface WindowOptions extends WebViewOptions {}
+export interface WindowOptions extends WebViewOptions {
+    /** Claim a prewarmed webview from this pool (defaults to Window.setPool's pool) */
+    pool?: WebviewPool | null;
+}
 
 export type IPCHandler = (data: any) => any | Promise<any>;
 
@@ -12,10 +16,22 @@ export class Window {
     private ipcHandlers = new Map<string, IPCHandler>();
     private hotReloadCleanup: (() => void) | null = null;
     private currentUrl: string | null = null;
+    private sharedFiles = new Set<string>();
+    private readonly pool: WebviewPool | null;
+    private static defaultPool: WebviewPool | null = null;
+
+    /**
+     * Pool that new windows claim their webview from unless they pass `pool`
+     */
+    static setPool(pool: WebviewPool | null): void {
+        Window.defaultPool = pool;
+    }
     
     constructor(options: WindowOptions = {}) {
         this.id = Date.now().toString() + Math.random().toString(36).substring(2);
-        this.webview = new Webview(options);
+        const { pool = Window.defaultPool, ...webviewOptions } = options;
+        this.pool = pool;
+        this.webview = pool ? pool.acquire(webviewOptions) : new Webview(webviewOptions);
 
         this.webview.onIPC = this.onIPC.bind(this);
     }
@@ -56,8 +72,8 @@ export class Window {
         await this.webview.navigate(url);
         this.currentUrl = url;
         
-        // Set up hot reload for file:// URLs in development mode
-        if (url.startsWith('file://') && process.env.TRONBUN_DEV_MODE) {
+        // Set up hot reload for local assets in development mode
+        if ((url.startsWith('file://') || url.startsWith('tronbun://')) && process.env.TRONBUN_DEV_MODE) {
             this.setupHotReloadForUrl();
         } else {
             this.stopHotReload();
@@ -68,10 +84,42 @@ export class Window {
         return await this.webview.eval(script);
     }
 
+    async getMetrics() {
+        return await this.webview.getMetrics();
+    }
+
+    /**
+     * Serve a local file to the page as tronbun://file/<token> (see Webview.shareFile)
+     */
+    async shareFile(path: string): Promise<SharedFile> {
+        const shared = await this.webview.shareFile(path);
+        this.sharedFiles.add(shared.token);
+        return shared;
+    }
+
+    async unshareFile(token: string): Promise<boolean> {
+        this.sharedFiles.delete(token);
+        return await this.webview.unshareFile(token);
+    }
+
+    /**
+     * Resolve once the page's DOM is ready
+     */
+    async whenReady(timeoutMs?: number): Promise<void> {
+        await this.webview.whenReady(timeoutMs);
+    }
+
     async close(): Promise<void> {
         this.stopHotReload();
         this.ipcHandlers.clear();
-        await this.webview.close();
+        // Tokens belong to the native process, which may outlive this window (pool or host)
+        await Promise.all([...this.sharedFiles].map(token => this.webview.unshareFile(token)));
+        this.sharedFiles.clear();
+        if (this.pool) {
+            await this.pool.release(this.webview);
+        } else {
+            await this.webview.close();
+        }
     }
 
     private setupHotReloadForUrl(): void {
@@ -3,4 +3,6 @@ export * from './WindowIPC';
 export * from './decorators';
 export * from './utils';
 export * from './Webview';
-export * from './Tray';
\ No newline at end of file
+export * from './Tray';
+export * from './NativeHost';
+export * from './WebviewPool';
\ No newline at end of file
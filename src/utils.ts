@@ -73,6 +73,37 @@ export function resolveWebAssetPath(relativePath: string, callerDirname: string,
     }
 }
 
+/**
+ * URL of a web asset. Where the tronbun:// scheme is served (Linux), this is
+ * tronbun://app/<relativePath>, answered by the native host from the webview's
+ * `assetRoot` (see resolveWebAssetRoot); elsewhere it is a file:// URL.
+ *
+ * @param relativePath - The relative path from the configured output directory to the asset
+ * @param callerDirname - The __dirname of the calling file
+ * @param projectRoot - Optional project root path (defaults to process.cwd())
+ * @returns The URL to navigate to
+ */
+export function webAssetUrl(relativePath: string, callerDirname: string, projectRoot?: string): string {
+    if (process.platform === 'linux') {
+        const encoded = relativePath.replace(/^\/+/, '').split('/').map(encodeURIComponent).join('/');
+        return `tronbun://app/${encoded}`;
+    }
+    return `file://${resolveWebAssetPath(relativePath, callerDirname, projectRoot)}`;
+}
+
+/**
+ * Web assets to pass as the `assetRoot` option: the archive written by
+ * `tronbun build` when there is one, otherwise the asset directory.
+ *
+ * @param callerDirname - The __dirname of the calling file
+ * @param projectRoot - Optional project root path (defaults to process.cwd())
+ * @returns The resolved absolute archive or directory path
+ */
+export function resolveWebAssetRoot(callerDirname: string, projectRoot?: string): string {
+    const directory = resolveWebAssetPath(".", callerDirname, projectRoot);
+    return existsSync(`${directory}.pak`) ? `${directory}.pak` : directory;
+}
+
 /**
  * Finds and returns the first existing web asset path from multiple possible locations.
  * Uses the same detection logic as Webview.ts for consistent behavior.
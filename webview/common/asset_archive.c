@@ -0,0 +1,185 @@
+/*
+ * Indexed web asset archive
+ *
+ * Implementation of mapping, validating and searching asset archives.
+ */
+
+#if !defined(_WIN32) && !defined(__APPLE__) && !defined(_GNU_SOURCE)
+#define _XOPEN_SOURCE 600  // mmap and fstat under -std=c99
+#endif
+
+#include "asset_archive.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Byte-wise reads: the format is little-endian and fields may be unaligned
+static unsigned int read_u32(const unsigned char* p) {
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static unsigned long long read_u64(const unsigned char* p) {
+    return (unsigned long long)read_u32(p) | ((unsigned long long)read_u32(p + 4) << 32);
+}
+
+static const unsigned char* entry_at(const asset_archive_t* archive, unsigned int index) {
+    return archive->data + ASSET_ARCHIVE_HEADER_SIZE + (size_t)index * ASSET_ARCHIVE_ENTRY_SIZE;
+}
+
+// Every offset is checked once here, so lookups can trust the index
+static int validate(const asset_archive_t* archive) {
+    const unsigned char* data = archive->data;
+    unsigned long long size = archive->size;
+    if (size < ASSET_ARCHIVE_HEADER_SIZE || memcmp(data, ASSET_ARCHIVE_MAGIC, 8) != 0 ||
+        read_u32(data + 8) != ASSET_ARCHIVE_VERSION) {
+        return 0;
+    }
+    
+    unsigned long long count = read_u32(data + 12);
+    unsigned long long strings_offset = read_u64(data + 16);
+    unsigned long long strings_length = read_u64(data + 24);
+    if (count > (size - ASSET_ARCHIVE_HEADER_SIZE) / ASSET_ARCHIVE_ENTRY_SIZE ||
+        strings_offset > size || strings_length > size - strings_offset) {
+        return 0;
+    }
+    
+    for (unsigned int i = 0; i < (unsigned int)count; i++) {
+        const unsigned char* entry = data + ASSET_ARCHIVE_HEADER_SIZE + (size_t)i * ASSET_ARCHIVE_ENTRY_SIZE;
+        unsigned long long offset = read_u64(entry);
+        unsigned long long length = read_u64(entry + 8);
+        unsigned long long decoded = read_u64(entry + 16);
+        unsigned long long path_offset = read_u32(entry + 24);
+        unsigned long long path_length = read_u32(entry + 28);
+        unsigned int encoding = read_u32(entry + 36);
+        if (offset > size || length > size - offset ||
+            path_offset > strings_length || path_length > strings_length - path_offset) {
+            return 0;
+        }
+        if (encoding == ASSET_ENCODING_NONE ? decoded != length :
+            encoding != ASSET_ENCODING_GZIP || (unsigned long long)(size_t)decoded != decoded) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int asset_archive_open_memory(asset_archive_t* archive, const unsigned char* data, size_t size) {
+    memset(archive, 0, sizeof(asset_archive_t));
+    if (!data) return 0;
+    
+    archive->data = data;
+    archive->size = size;
+    if (!validate(archive)) {
+        memset(archive, 0, sizeof(asset_archive_t));
+        return 0;
+    }
+    archive->count = read_u32(data + 12);
+    return 1;
+}
+
+int asset_archive_open(asset_archive_t* archive, const char* path) {
+    memset(archive, 0, sizeof(asset_archive_t));
+    const unsigned char* data = NULL;
+    size_t size = 0;
+    void* mapping = NULL;
+    
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return 0;
+    LARGE_INTEGER file_size;
+    HANDLE map = NULL;
+    if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+        map = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+    CloseHandle(file);  // The mapping keeps the file open
+    if (!map) return 0;
+    data = (const unsigned char*)MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
+    if (!data) {
+        CloseHandle(map);
+        return 0;
+    }
+    size = (size_t)file_size.QuadPart;
+    mapping = map;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat info;
+    void* view = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        view = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);  // The mapping keeps the file open
+    if (view == MAP_FAILED) return 0;
+    data = (const unsigned char*)view;
+    size = (size_t)info.st_size;
+    mapping = view;
+#endif
+    
+    if (!asset_archive_open_memory(archive, data, size)) {
+#ifdef _WIN32
+        UnmapViewOfFile(data);
+        CloseHandle((HANDLE)mapping);
+#else
+        munmap(mapping, size);
+#endif
+        return 0;
+    }
+    archive->mapping = mapping;
+    return 1;
+}
+
+void asset_archive_close(asset_archive_t* archive) {
+    if (!archive) return;
+    if (archive->mapping) {
+#ifdef _WIN32
+        UnmapViewOfFile(archive->data);
+        CloseHandle((HANDLE)archive->mapping);
+#else
+        munmap(archive->mapping, archive->size);
+#endif
+    }
+    memset(archive, 0, sizeof(asset_archive_t));
+}
+
+int asset_archive_find(const asset_archive_t* archive, const char* path, asset_archive_entry_t* entry) {
+    if (!archive || !archive->data || !path) return 0;
+    
+    const unsigned char* strings = archive->data + read_u64(archive->data + 16);
+    size_t path_length = strlen(path);
+    unsigned int low = 0, high = archive->count;
+    
+    while (low < high) {
+        unsigned int middle = low + (high - low) / 2;
+        const unsigned char* candidate = entry_at(archive, middle);
+        size_t candidate_length = read_u32(candidate + 28);
+        size_t common = candidate_length < path_length ? candidate_length : path_length;
+    
+        int order = memcmp(strings + read_u32(candidate + 24), path, common);
+        if (order == 0) {
+            order = candidate_length < path_length ? -1 : (candidate_length > path_length ? 1 : 0);
+        }
+        if (order == 0) {
+            entry->data = archive->data + read_u64(candidate);
+            entry->length = (size_t)read_u64(candidate + 8);
+            entry->size = (size_t)read_u64(candidate + 16);
+            entry->crc32 = read_u32(candidate + 32);
+            entry->encoding = (asset_encoding_t)read_u32(candidate + 36);
+            entry->index = middle;
+            return 1;
+        }
+        if (order < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * Indexed web asset archive
+ *
+ * Read side of the single-file archive written by `tronbun build`. The file
+ * is mapped once and assets are returned as slices of the mapping.
+ *
+ * Layout, all integers little-endian:
+ *   header   "TRBNPAK1", u32 version, u32 count, u64 strings_offset, u64 strings_length
+ *   index    count entries sorted bytewise by path, 40 bytes each:
+ *            u64 offset, u64 length, u64 size, u32 path_offset, u32 path_length, u32 crc32, u32 encoding
+ *   strings  paths relative to the web root, '/'-separated
+ *   blobs    asset contents, each starting on an ASSET_ARCHIVE_ALIGNMENT boundary
+ *
+ * length is the number of bytes stored and size the decoded size; they are
+ * equal unless the blob is stored compressed (see asset_encoding_t). crc32
+ * is of the decoded contents.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#define ASSET_ARCHIVE_MAGIC "TRBNPAK1"
+#define ASSET_ARCHIVE_VERSION 2
+#define ASSET_ARCHIVE_HEADER_SIZE 32
+#define ASSET_ARCHIVE_ENTRY_SIZE 40
+#define ASSET_ARCHIVE_ALIGNMENT 64
+
+typedef enum {
+    ASSET_ENCODING_NONE = 0,
+    ASSET_ENCODING_GZIP = 1
+} asset_encoding_t;
+
+typedef struct {
+    const unsigned char* data;  // Whole archive
+    size_t size;
+    unsigned int count;
+    void* mapping;              // Platform mapping handle; NULL for archives in memory
+} asset_archive_t;
+
+typedef struct {
+    const unsigned char* data;  // Slice of the archive, valid while it is open
+    size_t length;              // Bytes stored
+    size_t size;                // Bytes once decoded
+    unsigned int crc32;         // Of the decoded contents, computed at build time
+    asset_encoding_t encoding;
+    unsigned int index;         // Position in the index, for per-entry caches
+} asset_archive_entry_t;
+
+/**
+ * Map an archive file and validate its index
+ * @param archive Archive to open
+ * @param path Archive file
+ * @return 1 on success, 0 if the file can't be mapped or is not a valid archive
+ */
+int asset_archive_open(asset_archive_t* archive, const char* path);
+
+/**
+ * Use an archive already in memory; the buffer must outlive the archive
+ * @param archive Archive to open
+ * @param data Archive bytes
+ * @param size Number of bytes
+ * @return 1 on success, 0 if the data is not a valid archive
+ */
+int asset_archive_open_memory(asset_archive_t* archive, const unsigned char* data, size_t size);
+
+/**
+ * Unmap an archive. Slices returned by asset_archive_find become invalid.
+ * @param archive Archive to close
+ */
+void asset_archive_close(asset_archive_t* archive);
+
+/**
+ * Look up an asset by binary search over the sorted index
+ * @param archive Open archive
+ * @param path Path relative to the web root, e.g. "assets/app.js"
+ * @param entry Filled in on success
+ * @return 1 if found, 0 otherwise
+ */
+int asset_archive_find(const asset_archive_t* archive, const char* path, asset_archive_entry_t* entry);
+
+#ifdef __cplusplus
+}
+#endif
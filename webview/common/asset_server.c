@@ -0,0 +1,596 @@
+/*
+ * Web asset server for the tronbun:// scheme
+ *
+ * Implementation of path resolution, MIME types, byte ranges, caching
+ * headers and content decoding for assets served by the native host, and
+ * of the table of files shared by token.
+ */
+
+#if !defined(_WIN32) && !defined(__APPLE__) && !defined(_GNU_SOURCE)
+#define _XOPEN_SOURCE 600  // struct stat modes and fseeko under -std=c99
+#endif
+#ifndef _WIN32
+#define _FILE_OFFSET_BITS 64  // Files past 2 GB where off_t would be 32-bit
+#endif
+
+#include "asset_server.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <ntsecapi.h>  // RtlGenRandom
+#endif
+
+#define ZLIB_CONST
+#include <zlib.h>
+
+#ifndef S_ISREG
+#define S_ISREG(mode) (((mode) & S_IFMT) == S_IFREG)
+#endif
+
+// 64-bit sizes and offsets, also where long is 32-bit
+#ifdef _WIN32
+typedef struct _stat64 asset_stat_t;
+#define asset_stat(path, info) _stat64(path, info)
+#define asset_seek(file, offset) _fseeki64(file, (__int64)(offset), SEEK_SET)
+#else
+typedef struct stat asset_stat_t;
+#define asset_stat(path, info) stat(path, info)
+#define asset_seek(file, offset) fseeko(file, (off_t)(offset), SEEK_SET)
+#endif
+
+#define ASSET_PATH_MAX 4096
+
+// Bounded ranges of files on disk are read into memory up to this size;
+// larger ones are answered with a shorter range
+#define ASSET_FILE_READ_LIMIT (8u * 1024u * 1024u)
+
+typedef struct {
+    const char* extension;
+    const char* type;
+} asset_mime_entry_t;
+
+static const asset_mime_entry_t g_mime_types[] = {
+    {"html", "text/html; charset=utf-8"},
+    {"htm", "text/html; charset=utf-8"},
+    {"js", "text/javascript; charset=utf-8"},
+    {"mjs", "text/javascript; charset=utf-8"},
+    {"css", "text/css; charset=utf-8"},
+    {"json", "application/json"},
+    {"map", "application/json"},
+    {"txt", "text/plain; charset=utf-8"},
+    {"xml", "application/xml"},
+    {"svg", "image/svg+xml"},
+    {"png", "image/png"},
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"gif", "image/gif"},
+    {"webp", "image/webp"},
+    {"avif", "image/avif"},
+    {"ico", "image/x-icon"},
+    {"woff", "font/woff"},
+    {"woff2", "font/woff2"},
+    {"ttf", "font/ttf"},
+    {"otf", "font/otf"},
+    {"wasm", "application/wasm"},
+    {"mp3", "audio/mpeg"},
+    {"ogg", "audio/ogg"},
+    {"wav", "audio/wav"},
+    {"mp4", "video/mp4"},
+    {"webm", "video/webm"},
+    {"pdf", "application/pdf"},
+};
+
+int asset_server_init(asset_server_t* server, const char* root, int max_age) {
+    if (!server || !root || !*root) return 0;
+    
+    size_t length = strlen(root);
+    while (length > 1 && (root[length - 1] == '/' || root[length - 1] == '\\')) {
+        length--;
+    }
+    memset(server, 0, sizeof(asset_server_t));
+    server->root = (char*)malloc(length + 1);
+    if (!server->root) return 0;
+    memcpy(server->root, root, length);
+    server->root[length] = '\0';
+    server->max_age = max_age > 0 ? max_age : 0;
+    
+    // A file is an archive, mapped once for the life of the server
+    asset_stat_t info;
+    if (asset_stat(server->root, &info) == 0 && S_ISREG(info.st_mode)) {
+        if (!asset_archive_open(&server->archive, server->root)) {
+            asset_server_free(server);
+            return 0;
+        }
+        server->has_archive = 1;
+        if (server->archive.count > 0) {
+            server->decoded = (unsigned char**)calloc(server->archive.count, sizeof(unsigned char*));
+        }
+    }
+    return 1;
+}
+
+void asset_server_free(asset_server_t* server) {
+    if (!server) return;
+    free(server->root);
+    server->root = NULL;
+    if (server->decoded) {
+        for (unsigned int i = 0; i < server->archive.count; i++) {
+            free(server->decoded[i]);
+        }
+        free(server->decoded);
+        server->decoded = NULL;
+        server->decoded_bytes = 0;
+    }
+    if (server->has_archive) {
+        asset_archive_close(&server->archive);
+        server->has_archive = 0;
+    }
+}
+
+const char* asset_mime_type(const char* path) {
+    const char* dot = path ? strrchr(path, '.') : NULL;
+    if (!dot || strchr(dot, '/')) return "application/octet-stream";
+    
+    for (size_t i = 0; i < sizeof(g_mime_types) / sizeof(g_mime_types[0]); i++) {
+        const char* extension = g_mime_types[i].extension;
+        const char* candidate = dot + 1;
+        size_t j = 0;
+        while (extension[j] && candidate[j] && tolower((unsigned char)candidate[j]) == extension[j]) {
+            j++;
+        }
+        if (!extension[j] && !candidate[j]) {
+            return g_mime_types[i].type;
+        }
+    }
+    return "application/octet-stream";
+}
+
+static int parse_offset(const char** cursor, long long* value) {
+    const char* p = *cursor;
+    if (!isdigit((unsigned char)*p)) return 0;
+    
+    long long result = 0;
+    while (isdigit((unsigned char)*p)) {
+        if (result > (0x7fffffffffffffffLL - 9) / 10) return 0;
+        result = result * 10 + (*p - '0');
+        p++;
+    }
+    *cursor = p;
+    *value = result;
+    return 1;
+}
+
+int asset_parse_range(const char* header, long long size, long long* start, long long* end) {
+    if (!header || strncmp(header, "bytes=", 6) != 0) return 0;
+    const char* p = header + 6;
+    while (*p == ' ') p++;
+    
+    long long first = -1, last = -1;
+    if (*p == '-') {
+        // Suffix range: the last N bytes
+        p++;
+        long long suffix;
+        if (!parse_offset(&p, &suffix)) return 0;
+        while (*p == ' ') p++;
+        if (*p) return 0;
+        if (suffix == 0 || size == 0) return -1;
+        first = suffix >= size ? 0 : size - suffix;
+        last = size - 1;
+    } else {
+        if (!parse_offset(&p, &first) || *p++ != '-') return 0;
+        if (isdigit((unsigned char)*p) && !parse_offset(&p, &last)) return 0;
+        while (*p == ' ') p++;
+        if (*p) return 0;  // Multiple ranges are answered with the whole asset
+        if (last >= 0 && last < first) return 0;
+        if (first >= size) return -1;
+        if (last < 0 || last >= size) last = size - 1;
+    }
+    
+    *start = first;
+    *end = last;
+    return 1;
+}
+
+int asset_accepts_encoding(const char* header, const char* encoding) {
+    if (!header || !encoding) return 0;
+    
+    size_t encoding_length = strlen(encoding);
+    const char* p = header;
+    while (*p) {
+        while (*p == ' ' || *p == ',') p++;
+        const char* name = p;
+        while (*p && *p != ',' && *p != ';' && *p != ' ') p++;
+        size_t name_length = (size_t)(p - name);
+    
+        // Only the q parameter matters: q=0 refuses the coding
+        int refused = 0;
+        while (*p && *p != ',') {
+            if ((*p == 'q' || *p == 'Q') && p[1] == '=') {
+                refused = strtod(p + 2, NULL) <= 0.0;
+            }
+            p++;
+        }
+    
+        int matches = name_length == encoding_length;
+        for (size_t i = 0; matches && i < name_length; i++) {
+            matches = tolower((unsigned char)name[i]) == tolower((unsigned char)encoding[i]);
+        }
+        if (matches || (name_length == 1 && *name == '*')) {
+            if (!refused) return 1;
+            if (matches) return 0;
+        }
+    }
+    return 0;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+int asset_resolve_path(const char* path, char* out, size_t out_size) {
+    if (!path || !out || out_size < 2) return 0;
+    
+    size_t length = 0;
+    size_t segment_start = 0;
+    const char* p = path;
+    while (*p == '/') p++;
+    
+    for (;; p++) {
+        char c = *p;
+        if (c == '%') {
+            int high = hex_value(p[1]);
+            int low = high >= 0 ? hex_value(p[2]) : -1;
+            if (low < 0) return 0;
+            c = (char)(high * 16 + low);
+            if (c == '\0' || c == '/') return 0;  // Encoded separators would hide ".." segments
+            p += 2;
+        } else if (c == '/' || c == '\0') {
+            // Close the segment: drop empty and "." segments, refuse ".."
+            const char* segment = out + segment_start;
+            size_t segment_length = length - segment_start;
+            if (segment_length == 2 && segment[0] == '.' && segment[1] == '.') return 0;
+            if (segment_length == 0 || (segment_length == 1 && segment[0] == '.')) {
+                length = segment_start;
+            } else if (c == '/') {
+                if (length + 1 >= out_size) return 0;
+                out[length++] = '/';
+                segment_start = length;
+            }
+            if (c == '\0') break;
+            continue;
+        }
+    
+        if (c == '\\' || c == ':') return 0;  // Windows separators and drive letters
+        if (length + 1 >= out_size) return 0;
+        out[length++] = c;
+    }
+    
+    // Directories serve their index file
+    if (length == 0 || out[length - 1] == '/') {
+        size_t index_length = strlen(ASSET_INDEX_FILE);
+        if (length + index_length + 1 > out_size) return 0;
+        memcpy(out + length, ASSET_INDEX_FILE, index_length);
+        length += index_length;
+    }
+    out[length] = '\0';
+    return 1;
+}
+
+static void set_error(asset_response_t* response, int status) {
+    response->status = status;
+    response->content_type = "text/plain; charset=utf-8";
+}
+
+// Read length bytes at start into a buffer owned by the response
+static int read_file_range(const char* path, long long start, size_t length, asset_response_t* response) {
+    if (length == 0) return 1;
+    FILE* file = fopen(path, "rb");
+    response->owned = (unsigned char*)malloc(length);
+    if (!file || !response->owned || asset_seek(file, start) != 0 ||
+        fread(response->owned, 1, length, file) != length) {
+        if (file) fclose(file);
+        asset_response_free(response);
+        return 0;
+    }
+    fclose(file);
+    response->body = response->owned;
+    return 1;
+}
+
+// Answer start..end of a file on disk. Bounded ranges, as media elements
+// seeking issue them, are small reads; everything up to the end is left for
+// the platform to stream from file_path, never held in memory.
+static int answer_file_range(const char* path, long long size, int ranged, long long start, long long* end,
+                             asset_response_t* response) {
+    if (ranged > 0 && *end < size - 1) {
+        if (*end - start + 1 > (long long)ASSET_FILE_READ_LIMIT) {
+            *end = start + ASSET_FILE_READ_LIMIT - 1;
+        }
+        response->length = (size_t)(*end - start + 1);
+        return read_file_range(path, start, response->length, response);
+    }
+    if (size > 0) {
+        size_t length = strlen(path);
+        response->file_path = (char*)malloc(length + 1);
+        if (!response->file_path) return 0;
+        memcpy(response->file_path, path, length + 1);
+        response->file_offset = start;
+        response->length = (size_t)(size - start);
+    }
+    return 1;
+}
+
+// Inflate a gzip blob that decodes to exactly size bytes
+static unsigned char* decode_gzip(const unsigned char* data, size_t length, size_t size) {
+    if ((size_t)(uInt)length != length || (size_t)(uInt)size != size) return NULL;
+    unsigned char* out = (unsigned char*)malloc(size > 0 ? size : 1);
+    if (!out) return NULL;
+    
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) {
+        free(out);
+        return NULL;
+    }
+    stream.next_in = data;
+    stream.avail_in = (uInt)length;
+    stream.next_out = out;
+    stream.avail_out = (uInt)size;
+    int ok = inflate(&stream, Z_FINISH) == Z_STREAM_END && stream.total_out == size;
+    inflateEnd(&stream);
+    if (!ok) {
+        free(out);
+        return NULL;
+    }
+    return out;
+}
+
+// Decoded contents of a compressed entry: cached on the server while under
+// the limit, otherwise owned by the response
+static const unsigned char* decoded_contents(asset_server_t* server, const asset_archive_entry_t* entry,
+                                             asset_response_t* response) {
+    if (server->decoded && server->decoded[entry->index]) {
+        return server->decoded[entry->index];
+    }
+    unsigned char* contents = decode_gzip(entry->data, entry->length, entry->size);
+    if (!contents) return NULL;
+    
+    if (server->decoded && entry->size <= ASSET_DECODE_CACHE_LIMIT - server->decoded_bytes) {
+        server->decoded[entry->index] = contents;
+        server->decoded_bytes += entry->size;
+    } else {
+        response->owned = contents;
+    }
+    return contents;
+}
+
+void asset_server_handle(asset_server_t* server, const char* path, const char* range,
+                         const char* if_none_match, const char* accept_encoding,
+                         asset_response_t* response) {
+    memset(response, 0, sizeof(asset_response_t));
+    
+    char relative[ASSET_PATH_MAX];
+    if (!server || !server->root) {
+        set_error(response, 404);
+        return;
+    }
+    if (!asset_resolve_path(path, relative, sizeof(relative))) {
+        set_error(response, 403);
+        return;
+    }
+    
+    // Locate the asset: a slice of the archive, or a file below the root
+    char full_path[ASSET_PATH_MAX];
+    asset_archive_entry_t entry;
+    long long size;
+    int passthrough = 0;
+    if (server->has_archive) {
+        if (!asset_archive_find(&server->archive, relative, &entry)) {
+            set_error(response, 404);
+            return;
+        }
+        // Compressed entries go out as stored when the client decodes them
+        // itself; ranges always apply to the decoded contents
+        passthrough = entry.encoding == ASSET_ENCODING_GZIP && !range &&
+                      asset_accepts_encoding(accept_encoding, "gzip");
+        size = (long long)(passthrough ? entry.length : entry.size);
+        snprintf(response->etag, sizeof(response->etag), "\"%x-%llx%s\"", entry.crc32,
+                 (unsigned long long)entry.size, passthrough ? "-gzip" : "");
+    } else {
+        if (snprintf(full_path, sizeof(full_path), "%s/%s", server->root, relative) >= (int)sizeof(full_path)) {
+            set_error(response, 400);
+            return;
+        }
+        asset_stat_t info;
+        if (asset_stat(full_path, &info) != 0 || !S_ISREG(info.st_mode)) {
+            set_error(response, 404);
+            return;
+        }
+        size = (long long)info.st_size;
+        snprintf(response->etag, sizeof(response->etag), "\"%llx-%llx\"",
+                 (unsigned long long)size, (unsigned long long)info.st_mtime);
+    }
+    
+    response->total = size;
+    response->content_type = asset_mime_type(relative);
+    if (server->max_age > 0) {
+        snprintf(response->cache_control, sizeof(response->cache_control), "public, max-age=%d", server->max_age);
+    } else {
+        snprintf(response->cache_control, sizeof(response->cache_control), "no-cache");
+    }
+    
+    if (if_none_match && (strstr(if_none_match, response->etag) || strcmp(if_none_match, "*") == 0)) {
+        response->status = 304;
+        return;
+    }
+    
+    long long start = 0, end = size - 1;
+    int ranged = asset_parse_range(range, size, &start, &end);
+    if (ranged < 0) {
+        set_error(response, 416);
+        snprintf(response->content_range, sizeof(response->content_range), "bytes */%lld", size);
+        return;
+    }
+    
+    if (server->has_archive) {
+        // Zero-copy: the mapping and the decode cache outlive every response
+        const unsigned char* contents = entry.data;
+        if (entry.encoding != ASSET_ENCODING_NONE && !passthrough) {
+            contents = decoded_contents(server, &entry, response);
+            if (!contents) {
+                set_error(response, 500);
+                return;
+            }
+        }
+        response->body = contents + start;
+        response->length = size > 0 ? (size_t)(end - start + 1) : 0;
+        response->content_encoding = passthrough ? "gzip" : NULL;
+    } else if (!answer_file_range(full_path, size, ranged, start, &end, response)) {
+        set_error(response, 500);
+        return;
+    }
+    
+    if (ranged > 0) {
+        response->status = 206;
+        snprintf(response->content_range, sizeof(response->content_range), "bytes %lld-%lld/%lld", start, end, size);
+    } else {
+        response->status = 200;
+    }
+}
+
+void asset_response_free(asset_response_t* response) {
+    if (!response) return;
+    free(response->owned);
+    free(response->file_path);
+    response->owned = NULL;
+    response->file_path = NULL;
+    response->body = NULL;
+    response->length = 0;
+}
+
+static int random_token(char* token) {
+    unsigned char bytes[ASSET_FILE_TOKEN_LENGTH / 2];
+#ifdef _WIN32
+    if (!RtlGenRandom(bytes, (ULONG)sizeof(bytes))) return 0;
+#else
+    FILE* random = fopen("/dev/urandom", "rb");
+    size_t count = random ? fread(bytes, 1, sizeof(bytes), random) : 0;
+    if (random) fclose(random);
+    if (count != sizeof(bytes)) return 0;
+#endif
+    for (size_t i = 0; i < sizeof(bytes); i++) {
+        snprintf(token + i * 2, 3, "%02x", bytes[i]);
+    }
+    return 1;
+}
+
+static asset_shared_file_t* find_shared_file(const asset_file_table_t* table, const char* token, size_t token_length) {
+    if (!table || token_length != ASSET_FILE_TOKEN_LENGTH) return NULL;
+    for (size_t i = 0; i < table->count; i++) {
+        if (memcmp(table->files[i].token, token, token_length) == 0) {
+            return &table->files[i];
+        }
+    }
+    return NULL;
+}
+
+int asset_files_share(asset_file_table_t* table, const char* path, char* token) {
+    asset_stat_t info;
+    if (!table || !path || asset_stat(path, &info) != 0 || !S_ISREG(info.st_mode)) return 0;
+    
+    if (table->count == table->capacity) {
+        size_t capacity = table->capacity ? table->capacity * 2 : 8;
+        asset_shared_file_t* files = (asset_shared_file_t*)realloc(table->files, capacity * sizeof(asset_shared_file_t));
+        if (!files) return 0;
+        table->files = files;
+        table->capacity = capacity;
+    }
+    
+    asset_shared_file_t* file = &table->files[table->count];
+    size_t length = strlen(path);
+    file->path = (char*)malloc(length + 1);
+    if (!file->path) return 0;
+    memcpy(file->path, path, length + 1);
+    if (!random_token(file->token)) {
+        free(file->path);
+        return 0;
+    }
+    file->token[ASSET_FILE_TOKEN_LENGTH] = '\0';
+    memcpy(token, file->token, ASSET_FILE_TOKEN_LENGTH + 1);
+    table->count++;
+    return 1;
+}
+
+int asset_files_unshare(asset_file_table_t* table, const char* token) {
+    asset_shared_file_t* file = token ? find_shared_file(table, token, strlen(token)) : NULL;
+    if (!file) return 0;
+    free(file->path);
+    *file = table->files[--table->count];
+    return 1;
+}
+
+void asset_files_free(asset_file_table_t* table) {
+    if (!table) return;
+    for (size_t i = 0; i < table->count; i++) {
+        free(table->files[i].path);
+    }
+    free(table->files);
+    memset(table, 0, sizeof(asset_file_table_t));
+}
+
+void asset_files_handle(const asset_file_table_t* table, const char* path, const char* range,
+                        const char* if_none_match, asset_response_t* response) {
+    memset(response, 0, sizeof(asset_response_t));
+    
+    // "/<token>", optionally followed by a file name for the page's benefit
+    const char* token = path ? path : "";
+    while (*token == '/') token++;
+    size_t token_length = strcspn(token, "/");
+    const asset_shared_file_t* file = find_shared_file(table, token, token_length);
+    asset_stat_t info;
+    if (!file || asset_stat(file->path, &info) != 0 || !S_ISREG(info.st_mode)) {
+        set_error(response, 404);
+        return;
+    }
+    
+    long long size = (long long)info.st_size;
+    response->total = size;
+    response->content_type = asset_mime_type(file->path);
+    snprintf(response->etag, sizeof(response->etag), "\"%llx-%llx\"",
+             (unsigned long long)size, (unsigned long long)info.st_mtime);
+    snprintf(response->cache_control, sizeof(response->cache_control), "no-cache");
+    if (if_none_match && (strstr(if_none_match, response->etag) || strcmp(if_none_match, "*") == 0)) {
+        response->status = 304;
+        return;
+    }
+    
+    long long start = 0, end = size - 1;
+    int ranged = asset_parse_range(range, size, &start, &end);
+    if (ranged < 0) {
+        set_error(response, 416);
+        snprintf(response->content_range, sizeof(response->content_range), "bytes */%lld", size);
+        return;
+    }
+    
+    if (!answer_file_range(file->path, size, ranged, start, &end, response)) {
+        set_error(response, 500);
+        return;
+    }
+    
+    if (ranged > 0) {
+        response->status = 206;
+        snprintf(response->content_range, sizeof(response->content_range), "bytes %lld-%lld/%lld", start, end, size);
+    } else {
+        response->status = 200;
+    }
+}
@@ -0,0 +1,178 @@
+/*
+ * Web asset server for the tronbun:// scheme
+ *
+ * Maps request paths to files below a root directory, or to entries of an
+ * asset archive, and builds the response: MIME type, byte ranges, and
+ * ETag/Cache-Control headers. Compressed archive entries are passed through
+ * when the client accepts their encoding and decoded otherwise.
+ * Also keeps the table of local files shared with pages by token, served
+ * straight from disk without a size limit.
+ * Platform-independent; the platform layer hands requests in and passes
+ * the response to the browser engine.
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include "asset_archive.h"
+
+#define ASSET_INDEX_FILE "index.html"
+
+// Decoded archive entries are kept for the life of the server up to this
+// many bytes; past it each response decodes its own copy
+#define ASSET_DECODE_CACHE_LIMIT (64u * 1024u * 1024u)
+
+// Hex characters in a shared file token (128 random bits)
+#define ASSET_FILE_TOKEN_LENGTH 32
+
+typedef struct {
+    char* root;               // Directory assets are served from, without a trailing separator
+    int max_age;              // Cache-Control max-age in seconds; 0 makes clients revalidate with the ETag
+    int has_archive;          // Serving from archive instead of root
+    asset_archive_t archive;
+    unsigned char** decoded;  // Per archive entry, decoded contents of compressed entries (or NULL)
+    size_t decoded_bytes;
+} asset_server_t;
+
+typedef struct {
+    int status;                 // 200, 206, 304, 400, 403, 404, 416 or 500
+    const char* content_type;   // Static string
+    const unsigned char* body;  // NULL for empty bodies; a slice of the archive when served from one
+    size_t length;
+    unsigned char* owned;       // Buffer to free, when body was read from disk
+    long long total;            // Size of the whole asset
+    char etag[48];              // Empty on errors
+    char cache_control[48];
+    char content_range[80];     // Empty unless status is 206 or 416
+    const char* content_encoding;  // "gzip" when body is sent still compressed, otherwise NULL
+    char* file_path;            // When set, body is NULL and length bytes are streamed from this
+    long long file_offset;      // file starting at file_offset; freed with the response
+} asset_response_t;
+
+typedef struct {
+    char token[ASSET_FILE_TOKEN_LENGTH + 1];
+    char* path;
+} asset_shared_file_t;
+
+typedef struct {
+    asset_shared_file_t* files;
+    size_t count;
+    size_t capacity;
+} asset_file_table_t;
+
+/**
+ * Set up a server for a root directory or an asset archive file
+ * @param server Server to initialize
+ * @param root Asset directory, or archive written by `tronbun build`
+ * @param max_age Cache-Control max-age in seconds (0 for no-cache)
+ * @return 1 on success, 0 on failure
+ */
+int asset_server_init(asset_server_t* server, const char* root, int max_age);
+
+/**
+ * Free the resources held by a server
+ * @param server Server to free
+ */
+void asset_server_free(asset_server_t* server);
+
+/**
+ * Answer one request. Directories ("/" or a trailing slash) serve their
+ * index.html; paths escaping the root are refused with 403. Archive entries
+ * are answered from the mapping; files below a root directory are streamed
+ * through file_path like shared files, with bounded ranges read into memory.
+ * Not thread-safe: the decode cache is filled in on demand.
+ * @param server Server
+ * @param path Request path, percent-encoded, without query or fragment
+ * @param range Range header value (or NULL)
+ * @param if_none_match If-None-Match header value (or NULL)
+ * @param accept_encoding Accept-Encoding header value (or NULL to always decode)
+ * @param response Filled in; release with asset_response_free
+ */
+void asset_server_handle(asset_server_t* server, const char* path, const char* range,
+                         const char* if_none_match, const char* accept_encoding,
+                         asset_response_t* response);
+
+/**
+ * Free the body of a response, if it was read from disk, and its file path
+ * @param response Response to free
+ */
+void asset_response_free(asset_response_t* response);
+
+/**
+ * Share a local file under a new random token
+ * @param table File table (zero-initialized before first use)
+ * @param path Regular file to share
+ * @param token Receives the token; ASSET_FILE_TOKEN_LENGTH + 1 bytes
+ * @return 1 on success, 0 if the path is not a regular file or no token could be made
+ */
+int asset_files_share(asset_file_table_t* table, const char* path, char* token);
+
+/**
+ * Stop sharing a file; responses already started keep streaming
+ * @param table File table
+ * @param token Token returned by asset_files_share
+ * @return 1 if the token was shared, 0 otherwise
+ */
+int asset_files_unshare(asset_file_table_t* table, const char* token);
+
+/**
+ * Free every entry of a file table
+ * @param table File table
+ */
+void asset_files_free(asset_file_table_t* table);
+
+/**
+ * Answer a request for a shared file. Open-ended requests are answered
+ * with file_path set so the platform streams the file; bounded ranges are
+ * read into memory, shortened to 8 MB.
+ * @param table File table
+ * @param path Request path, "/<token>" optionally followed by "/<name>"
+ * @param range Range header value (or NULL)
+ * @param if_none_match If-None-Match header value (or NULL)
+ * @param response Filled in; release with asset_response_free
+ */
+void asset_files_handle(const asset_file_table_t* table, const char* path, const char* range,
+                        const char* if_none_match, asset_response_t* response);
+
+/**
+ * Content type for a file name, by extension
+ * @param path File name or path
+ * @return MIME type, "application/octet-stream" when unknown
+ */
+const char* asset_mime_type(const char* path);
+
+/**
+ * Parse a single "bytes=" range against an asset size. Multiple ranges
+ * and malformed headers are ignored, so the whole asset is served.
+ * @param header Range header value (or NULL)
+ * @param size Asset size
+ * @param start Set to the first byte on success
+ * @param end Set to the last byte (inclusive) on success
+ * @return 1 for a valid range, 0 to serve everything, -1 if unsatisfiable
+ */
+int asset_parse_range(const char* header, long long size, long long* start, long long* end);
+
+/**
+ * Whether an Accept-Encoding header value allows an encoding
+ * @param header Accept-Encoding header value (or NULL)
+ * @param encoding Encoding name, e.g. "gzip"
+ * @return 1 if listed without q=0, 0 otherwise
+ */
+int asset_accepts_encoding(const char* header, const char* encoding);
+
+/**
+ * Decode a request path into a path relative to the root
+ * @param path Percent-encoded request path
+ * @param out Output buffer
+ * @param out_size Output buffer size
+ * @return 1 on success, 0 if the path is invalid or escapes the root
+ */
+int asset_resolve_path(const char* path, char* out, size_t out_size);
+
+#ifdef __cplusplus
+}
+#endif
@@ -8,11 +8,381 @@
  * cJSON: https://github.com/DaveGamble/cJSON
  */
 
+#if !defined(_WIN32) && !defined(__APPLE__) && !defined(_GNU_SOURCE)
+#define _XOPEN_SOURCE 600  // clock_gettime and usleep under -std=c99
+#endif
+
 #include "ipc_common.h"
+#include <assert.h>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#if defined(_MSC_VER)
+#define IPC_THREAD_LOCAL __declspec(thread)
+#elif defined(__cplusplus) && __cplusplus >= 201103L
+#define IPC_THREAD_LOCAL thread_local
+#else
+#define IPC_THREAD_LOCAL __thread
+#endif
 
 // Global command processor callback
 static void (*g_command_processor)(const char* command, void* context) = NULL;
 
+// Transport framing in effect for stdin/stdout
+static ipc_framing_t g_framing = IPC_FRAMING_LINE;
+
+// Raw JSON spans
+static size_t ipc_json_skip_ws(const char* json, size_t length, size_t pos) {
+    while (pos < length && (json[pos] == ' ' || json[pos] == '\t' || json[pos] == '\n' || json[pos] == '\r')) pos++;
+    return pos;
+}
+
+// Returns the position just past the string starting at pos (a quote), or 0
+static size_t ipc_json_skip_string(const char* json, size_t length, size_t pos) {
+    for (pos++; pos < length; pos++) {
+        if (json[pos] == '\\') pos++;
+        else if (json[pos] == '"') return pos + 1;
+    }
+    return 0;
+}
+
+// Returns the position just past the value starting at pos, or 0 if malformed
+static size_t ipc_json_skip_value(const char* json, size_t length, size_t pos) {
+    if (pos >= length) return 0;
+    
+    if (json[pos] == '"') return ipc_json_skip_string(json, length, pos);
+    
+    if (json[pos] == '{' || json[pos] == '[') {
+        int depth = 0;
+        while (pos < length) {
+            char c = json[pos];
+            if (c == '"') {
+                pos = ipc_json_skip_string(json, length, pos);
+                if (!pos) return 0;
+                continue;
+            }
+            if (c == '{' || c == '[') depth++;
+            else if (c == '}' || c == ']') {
+                if (--depth == 0) return pos + 1;
+            }
+            pos++;
+        }
+        return 0;
+    }
+    
+    // Number, true, false or null
+    size_t start = pos;
+    while (pos < length && json[pos] != ',' && json[pos] != '}' && json[pos] != ']' &&
+           json[pos] != ' ' && json[pos] != '\t' && json[pos] != '\n' && json[pos] != '\r') pos++;
+    return pos > start ? pos : 0;
+}
+
+int ipc_json_find_member(const char* json, size_t length, const char* key, const char** value, size_t* value_length) {
+    size_t key_length = strlen(key);
+    size_t pos = ipc_json_skip_ws(json, length, 0);
+    if (pos >= length || json[pos] != '{') return 0;
+    pos++;
+    
+    while (1) {
+        pos = ipc_json_skip_ws(json, length, pos);
+        if (pos >= length || json[pos] != '"') return 0;
+        
+        size_t name_start = pos + 1;
+        pos = ipc_json_skip_string(json, length, pos);
+        if (!pos) return 0;
+        int matches = (pos - 1 - name_start == key_length) && memcmp(json + name_start, key, key_length) == 0;
+        
+        pos = ipc_json_skip_ws(json, length, pos);
+        if (pos >= length || json[pos] != ':') return 0;
+        pos = ipc_json_skip_ws(json, length, pos + 1);
+        
+        size_t value_start = pos;
+        pos = ipc_json_skip_value(json, length, pos);
+        if (!pos) return 0;
+        
+        if (matches) {
+            *value = json + value_start;
+            *value_length = pos - value_start;
+            return 1;
+        }
+        
+        pos = ipc_json_skip_ws(json, length, pos);
+        if (pos >= length || json[pos] != ',') return 0;
+        pos++;
+    }
+}
+
+int ipc_json_find_element(const char* json, size_t length, int index, const char** value, size_t* value_length) {
+    size_t pos = ipc_json_skip_ws(json, length, 0);
+    if (pos >= length || json[pos] != '[' || index < 0) return 0;
+    pos++;
+    
+    for (int i = 0; ; i++) {
+        pos = ipc_json_skip_ws(json, length, pos);
+        if (pos >= length || json[pos] == ']') return 0;
+        
+        size_t value_start = pos;
+        pos = ipc_json_skip_value(json, length, pos);
+        if (!pos) return 0;
+        
+        if (i == index) {
+            *value = json + value_start;
+            *value_length = pos - value_start;
+            return 1;
+        }
+        
+        pos = ipc_json_skip_ws(json, length, pos);
+        if (pos >= length || json[pos] != ',') return 0;
+        pos++;
+    }
+}
+
+// Arenas and pooled commands
+#define IPC_ARENA_ALIGNMENT 16
+
+static size_t ipc_align(size_t size) {
+    return (size + IPC_ARENA_ALIGNMENT - 1) & ~(size_t)(IPC_ARENA_ALIGNMENT - 1);
+}
+
+static char* ipc_arena_block_data(ipc_arena_block_t* block) {
+    return (char*)block + ipc_align(sizeof(ipc_arena_block_t));
+}
+
+static ipc_arena_block_t* ipc_arena_block_create(size_t capacity) {
+    ipc_arena_block_t* block = (ipc_arena_block_t*)malloc(ipc_align(sizeof(ipc_arena_block_t)) + capacity);
+    if (!block) return NULL;
+    block->next = NULL;
+    block->capacity = capacity;
+    block->used = 0;
+    return block;
+}
+
+void ipc_arena_init(ipc_arena_t* arena) {
+    arena->head = NULL;
+}
+
+void* ipc_arena_alloc(ipc_arena_t* arena, size_t size) {
+    size = ipc_align(size ? size : 1);
+    
+    ipc_arena_block_t* block = arena->head;
+    if (!block || block->capacity - block->used < size) {
+        // Double on each new block so a large command needs few of them
+        size_t capacity = block ? block->capacity * 2 : IPC_ARENA_BLOCK_SIZE;
+        while (capacity < size) capacity *= 2;
+        
+        ipc_arena_block_t* grown = ipc_arena_block_create(capacity);
+        if (!grown) return NULL;
+        grown->next = block;
+        arena->head = grown;
+        block = grown;
+    }
+    
+    void* ptr = ipc_arena_block_data(block) + block->used;
+    block->used += size;
+    return ptr;
+}
+
+void ipc_arena_reset(ipc_arena_t* arena) {
+    ipc_arena_block_t* block = arena->head;
+    if (!block) return;
+    
+    // The newest block is the largest; keep it unless it came from an outlier
+    ipc_arena_block_t* rest = block->next;
+    while (rest) {
+        ipc_arena_block_t* next = rest->next;
+        free(rest);
+        rest = next;
+    }
+    
+    if (block->capacity > IPC_ARENA_RETAIN_LIMIT) {
+        free(block);
+        arena->head = NULL;
+        return;
+    }
+    
+    block->next = NULL;
+    block->used = 0;
+}
+
+void ipc_arena_destroy(ipc_arena_t* arena) {
+    ipc_arena_reset(arena);
+    free(arena->head);
+    arena->head = NULL;
+}
+
+// Walks the arena's blocks; used by assertions only, never per allocation
+static int ipc_arena_owns(const ipc_arena_t* arena, const void* ptr) {
+    for (ipc_arena_block_t* block = arena->head; block; block = block->next) {
+        const char* data = ipc_arena_block_data(block);
+        if ((const char*)ptr >= data && (const char*)ptr < data + block->capacity) return 1;
+    }
+    return 0;
+}
+
+// cJSON allocates through these hooks once ipc_init installed them; while a
+// thread is parsing into an arena, nodes come from it. Everything cJSON frees
+// during that parse was allocated by the same parse, so those frees are no-ops.
+static IPC_THREAD_LOCAL ipc_arena_t* t_parse_arena = NULL;
+static int g_json_hooks_installed = 0;
+
+static void* ipc_json_malloc(size_t size) {
+    return t_parse_arena ? ipc_arena_alloc(t_parse_arena, size) : malloc(size);
+}
+
+static void ipc_json_free(void* ptr) {
+    if (t_parse_arena) return;
+    free(ptr);
+}
+
+void ipc_init(void) {
+    static cJSON_Hooks hooks = { ipc_json_malloc, ipc_json_free };
+    if (g_json_hooks_installed) return;
+    cJSON_InitHooks(&hooks);
+    g_json_hooks_installed = 1;
+}
+
+void ipc_command_pool_init(ipc_command_pool_t* pool, int max_free) {
+    ipc_mutex_init(&pool->lock);
+    pool->free_list = NULL;
+    pool->free_count = 0;
+    pool->max_free = max_free > 0 ? max_free : IPC_COMMAND_POOL_MAX_FREE;
+    pool->created = 0;
+    pool->passthrough_method = NULL;
+    pool->passthrough_key = NULL;
+}
+
+void ipc_command_pool_destroy(ipc_command_pool_t* pool) {
+    ipc_mutex_lock(&pool->lock);
+    ipc_pooled_command_t* cmd = pool->free_list;
+    pool->free_list = NULL;
+    pool->free_count = 0;
+    ipc_mutex_unlock(&pool->lock);
+    
+    while (cmd) {
+        ipc_pooled_command_t* next = cmd->next_free;
+        ipc_arena_destroy(&cmd->arena);
+        free(cmd);
+        cmd = next;
+    }
+    ipc_mutex_destroy(&pool->lock);
+}
+
+ipc_pooled_command_t* ipc_command_pool_acquire(ipc_command_pool_t* pool, void* context) {
+    ipc_mutex_lock(&pool->lock);
+    ipc_pooled_command_t* cmd = pool->free_list;
+    if (cmd) {
+        pool->free_list = cmd->next_free;
+        pool->free_count--;
+    } else {
+        pool->created++;
+    }
+    ipc_mutex_unlock(&pool->lock);
+    
+    if (!cmd) {
+        cmd = (ipc_pooled_command_t*)malloc(sizeof(ipc_pooled_command_t));
+        if (!cmd) return NULL;
+        ipc_arena_init(&cmd->arena);
+        cmd->pool = pool;
+    }
+    
+    cmd->context = context;
+    cmd->next_free = NULL;
+    cmd->command.root = NULL;
+    cmd->command.method = NULL;
+    cmd->command.id = "unknown";
+    cmd->command.params = NULL;
+    cmd->command.deadline_ms = 0;
+    cmd->command.target = -1;
+    cmd->command.arena = NULL;
+    cmd->command.raw_key = NULL;
+    cmd->command.raw_value = NULL;
+    cmd->command.raw_length = 0;
+    cmd->command.attachment = NULL;
+    cmd->command.attachment_length = 0;
+    cmd->command.attachment_buffer = NULL;
+    return cmd;
+}
+
+void ipc_command_pool_set_passthrough(ipc_command_pool_t* pool, const char* method, const char* key) {
+    pool->passthrough_method = method;
+    pool->passthrough_key = key;
+}
+
+// Keep the passthrough param's bytes as they arrived and parse the rest of
+// the command with that value replaced by null. Returns -1 if not applicable.
+static int ipc_command_parse_passthrough(ipc_pooled_command_t* cmd, const char* json) {
+    ipc_command_pool_t* pool = cmd->pool;
+    if (!pool->passthrough_method || !json) return -1;
+    
+    size_t length = strlen(json);
+    const char* method;
+    size_t method_length;
+    if (!ipc_json_find_member(json, length, "method", &method, &method_length)) return -1;
+    size_t expected = strlen(pool->passthrough_method);
+    if (method_length != expected + 2 || memcmp(method + 1, pool->passthrough_method, expected) != 0) return -1;
+    
+    const char* params;
+    size_t params_length;
+    const char* value;
+    size_t value_length;
+    if (!ipc_json_find_member(json, length, "params", &params, &params_length)) return -1;
+    if (!ipc_json_find_member(params, params_length, pool->passthrough_key, &value, &value_length)) return -1;
+    
+    char* raw = (char*)ipc_arena_alloc(&cmd->arena, value_length + 1);
+    size_t prefix = (size_t)(value - json);
+    size_t suffix = length - prefix - value_length;
+    char* rest = (char*)ipc_arena_alloc(&cmd->arena, prefix + 4 + suffix + 1);
+    if (!raw || !rest) return -1;
+    
+    memcpy(raw, value, value_length);
+    raw[value_length] = '\0';
+    memcpy(rest, json, prefix);
+    memcpy(rest + prefix, "null", 4);
+    memcpy(rest + prefix + 4, value + value_length, suffix + 1);
+    
+    int parsed = ipc_command_parse_in(rest, &cmd->command, &cmd->arena);
+    cmd->command.raw_key = pool->passthrough_key;
+    cmd->command.raw_value = raw;
+    cmd->command.raw_length = value_length;
+    return parsed;
+}
+
+int ipc_command_pool_parse(ipc_pooled_command_t* cmd, const char* json) {
+    int parsed = ipc_command_parse_passthrough(cmd, json);
+    if (parsed >= 0) return parsed;
+    return ipc_command_parse_in(json, &cmd->command, &cmd->arena);
+}
+
+void ipc_command_pool_release(ipc_pooled_command_t* cmd) {
+    if (!cmd) return;
+    ipc_command_pool_t* pool = cmd->pool;
+    
+    ipc_command_release(&cmd->command);
+    ipc_arena_reset(&cmd->arena);
+    
+    ipc_mutex_lock(&pool->lock);
+    if (pool->free_count < pool->max_free) {
+        cmd->next_free = pool->free_list;
+        pool->free_list = cmd;
+        pool->free_count++;
+        cmd = NULL;
+    }
+    ipc_mutex_unlock(&pool->lock);
+    
+    // Freelist full: this object was a burst extra
+    if (cmd) {
+        ipc_arena_destroy(&cmd->arena);
+        free(cmd);
+    }
+}
+
 int ipc_parse_command(const char* json_string, char* method, char* id, char* params) {
     if (!json_string) return 0;
     
@@ -152,70 +522,1176 @@ void ipc_extract_param_json(const char* params, const char* key, char* value, si
     cJSON_Delete(json);
 }
 
+int ipc_command_parse(const char* json_string, ipc_command_t* cmd) {
+    return ipc_command_parse_in(json_string, cmd, NULL);
+}
+
+int ipc_command_parse_in(const char* json_string, ipc_command_t* cmd, ipc_arena_t* arena) {
+    cmd->root = NULL;
+    cmd->method = NULL;
+    cmd->id = "unknown";
+    cmd->params = NULL;
+    cmd->deadline_ms = 0;
+    cmd->target = -1;
+    cmd->arena = arena;
+    cmd->raw_key = NULL;
+    cmd->raw_value = NULL;
+    cmd->raw_length = 0;
+    cmd->attachment = NULL;
+    cmd->attachment_length = 0;
+    cmd->attachment_buffer = NULL;
+    
+    if (!json_string) return 0;
+    
+    // Without the hooks the tree would land on the heap and leak on reset
+    assert(!arena || g_json_hooks_installed);
+    ipc_arena_t* previous_arena = t_parse_arena;
+    t_parse_arena = arena;
+    cmd->root = cJSON_Parse(json_string);
+    t_parse_arena = previous_arena;
+    if (!cmd->root) return 0;
+    
+    cJSON *id_item = cJSON_GetObjectItem(cmd->root, "id");
+    if (!id_item || !cJSON_IsString(id_item)) return 0;
+    cmd->id = cJSON_GetStringValue(id_item);
+    
+    cJSON *method_item = cJSON_GetObjectItem(cmd->root, "method");
+    if (!method_item || !cJSON_IsString(method_item)) return 0;
+    cmd->method = cJSON_GetStringValue(method_item);
+    
+    cJSON *params_item = cJSON_GetObjectItem(cmd->root, "params");
+    if (params_item && cJSON_IsObject(params_item)) {
+        cmd->params = params_item;
+    }
+    
+    cJSON *deadline_item = cJSON_GetObjectItem(cmd->root, "deadline_ms");
+    if (deadline_item && cJSON_IsNumber(deadline_item) && cJSON_GetNumberValue(deadline_item) > 0) {
+        cmd->deadline_ms = (int)cJSON_GetNumberValue(deadline_item);
+    }
+    
+    // Set only by a multiplexed host, where one process owns several webviews and trays
+    cJSON *target_item = cJSON_GetObjectItem(cmd->root, "target");
+    if (target_item && cJSON_IsNumber(target_item) && cJSON_GetNumberValue(target_item) >= 0) {
+        cmd->target = (int)cJSON_GetNumberValue(target_item);
+    }
+    
+    return 1;
+}
+
+void ipc_command_release(ipc_command_t* cmd) {
+    if (!cmd) return;
+    
+    // Arena-backed trees are freed wholesale when the arena is reset; this is
+    // the only place they are dropped, and never through cJSON_Delete
+    assert(!cmd->root || !cmd->arena || ipc_arena_owns(cmd->arena, cmd->root));
+    if (cmd->root && !cmd->arena) {
+        cJSON_Delete(cmd->root);
+    }
+    cmd->root = NULL;
+    cmd->method = NULL;
+    cmd->id = "unknown";
+    cmd->params = NULL;
+    cmd->deadline_ms = 0;
+    cmd->target = -1;
+    cmd->arena = NULL;
+    cmd->raw_key = NULL;
+    cmd->raw_value = NULL;
+    cmd->raw_length = 0;
+    free(cmd->attachment_buffer);
+    cmd->attachment = NULL;
+    cmd->attachment_length = 0;
+    cmd->attachment_buffer = NULL;
+}
+
+const char* ipc_command_get_raw_param(const ipc_command_t* cmd, const char* key, size_t* length) {
+    if (!cmd || !cmd->raw_key || strcmp(cmd->raw_key, key) != 0) return NULL;
+    if (length) *length = cmd->raw_length;
+    return cmd->raw_value;
+}
+
+const cJSON* ipc_command_get_param(const ipc_command_t* cmd, const char* key) {
+    if (!cmd || !cmd->params) return NULL;
+    return cJSON_GetObjectItem(cmd->params, key);
+}
+
+const char* ipc_command_get_string(const ipc_command_t* cmd, const char* key, const char* default_value) {
+    const cJSON *item = ipc_command_get_param(cmd, key);
+    if (!item || !cJSON_IsString(item)) return default_value;
+    return cJSON_GetStringValue(item);
+}
+
+int ipc_command_get_int(const ipc_command_t* cmd, const char* key, int default_value) {
+    const cJSON *item = ipc_command_get_param(cmd, key);
+    if (!item || !cJSON_IsNumber(item)) return default_value;
+    return (int)cJSON_GetNumberValue(item);
+}
+
+float ipc_command_get_float(const ipc_command_t* cmd, const char* key, float default_value) {
+    const cJSON *item = ipc_command_get_param(cmd, key);
+    if (!item || !cJSON_IsNumber(item)) return default_value;
+    return (float)cJSON_GetNumberValue(item);
+}
+
+int ipc_command_get_bool(const ipc_command_t* cmd, const char* key, int default_value) {
+    const cJSON *item = ipc_command_get_param(cmd, key);
+    if (!item) return default_value;
+    if (cJSON_IsBool(item)) return cJSON_IsTrue(item) ? 1 : 0;
+    if (cJSON_IsNumber(item)) return cJSON_GetNumberValue(item) != 0 ? 1 : 0;
+    return default_value;
+}
+
+const unsigned char* ipc_command_get_base64(const ipc_command_t* cmd, const char* key, size_t* length) {
+    const cJSON *item = ipc_command_get_param(cmd, key);
+    if (!item || !cJSON_IsString(item) || !cmd->arena) return NULL;
+    
+    const char* text = cJSON_GetStringValue(item);
+    size_t text_length = strlen(text);
+    unsigned char* data = (unsigned char*)ipc_arena_alloc(cmd->arena, (text_length / 4 + 1) * 3);
+    if (!data) return NULL;
+    
+    size_t decoded = ipc_base64_decode(text, text_length, data);
+    if (decoded == (size_t)-1) return NULL;
+    
+    if (length) *length = decoded;
+    return data;
+}
+
+static int base64_value(unsigned char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+' || c == '-') return 62;
+    if (c == '/' || c == '_') return 63;
+    return -1;
+}
+
+size_t ipc_base64_decode(const char* input, size_t length, unsigned char* output) {
+    // Padding is optional; once it starts nothing else may follow
+    while (length > 0 && input[length - 1] == '=') length--;
+    if (length % 4 == 1) return (size_t)-1;
+    
+    size_t out = 0;
+    unsigned int bits = 0;
+    int bit_count = 0;
+    for (size_t i = 0; i < length; i++) {
+        int value = base64_value((unsigned char)input[i]);
+        if (value < 0) return (size_t)-1;
+        
+        bits = (bits << 6) | (unsigned int)value;
+        bit_count += 6;
+        if (bit_count >= 8) {
+            bit_count -= 8;
+            output[out++] = (unsigned char)(bits >> bit_count);
+        }
+    }
+    
+    return out;
+}
+
+// Transport framing
+ipc_framing_t ipc_framing_init_from_env(void) {
+    const char* requested = getenv(IPC_FRAMING_ENV);
+    ipc_framing_t framing = IPC_FRAMING_LINE;
+    
+    if (requested && strcmp(requested, "length") == 0) {
+        framing = IPC_FRAMING_LENGTH;
+    }
+    
+    ipc_set_framing(framing);
+    return framing;
+}
+
+void ipc_set_framing(ipc_framing_t framing) {
+    g_framing = framing;
+    
+#ifdef _WIN32
+    // Frames carry raw length bytes, so CRLF translation must be off
+    if (framing == IPC_FRAMING_LENGTH) {
+        _setmode(_fileno(stdin), _O_BINARY);
+        _setmode(_fileno(stdout), _O_BINARY);
+    }
+#endif
+}
+
+ipc_framing_t ipc_get_framing(void) {
+    return g_framing;
+}
+
+static int ipc_reserve(char** buffer, size_t* capacity, size_t needed) {
+    if (*buffer && *capacity >= needed) return 1;
+    
+    size_t grown = *capacity ? *capacity : 4096;
+    while (grown < needed) grown *= 2;
+    
+    char* resized = (char*)realloc(*buffer, grown);
+    if (!resized) return 0;
+    *buffer = resized;
+    *capacity = grown;
+    return 1;
+}
+
+static int ipc_read_line(FILE* stream, char** buffer, size_t* capacity, size_t* length) {
+    size_t len = 0;
+    if (!ipc_reserve(buffer, capacity, 4096)) return 0;
+    
+    while (fgets(*buffer + len, (int)(*capacity - len), stream) != NULL) {
+        len += strlen(*buffer + len);
+        
+        if (len > 0 && (*buffer)[len - 1] == '\n') {
+            (*buffer)[--len] = '\0';
+            if (length) *length = len;
+            return 1;
+        }
+        
+        // Line longer than the buffer: grow and keep reading
+        if (len + 1 >= *capacity && !ipc_reserve(buffer, capacity, *capacity * 2)) {
+            return 0;
+        }
+    }
+    
+    // EOF: return a trailing line without newline, if any
+    if (len > 0) {
+        if (length) *length = len;
+        return 1;
+    }
+    return 0;
+}
+
+static int ipc_read_frame(FILE* stream, char** buffer, size_t* capacity, size_t* length,
+                          size_t* attachment_offset, size_t* attachment_length) {
+    unsigned char header[IPC_FRAME_HEADER_LENGTH];
+    if (fread(header, 1, sizeof(header), stream) != sizeof(header)) {
+        return 0;
+    }
+    
+    size_t len = ((size_t)header[0] << 24) | ((size_t)header[1] << 16) |
+                 ((size_t)header[2] << 8) | (size_t)header[3];
+    int binary = (len & IPC_FRAME_BINARY_FLAG) != 0;
+    len &= ~(size_t)IPC_FRAME_BINARY_FLAG;
+    if (len > IPC_MAX_FRAME_LENGTH) {
+        fprintf(stderr, "[IPC] Frame too large (%lu bytes), closing input\n", (unsigned long)len);
+        return 0;
+    }
+    
+    if (!ipc_reserve(buffer, capacity, len + 1)) return 0;
+    
+    if (len > 0 && fread(*buffer, 1, len, stream) != len) {
+        return 0;
+    }
+    
+    size_t json_length = len;
+    size_t attachment = 0;
+    if (binary) {
+        const unsigned char* p = (const unsigned char*)*buffer;
+        json_length = len < 4 ? len : ((size_t)p[0] << 24) | ((size_t)p[1] << 16) |
+                                      ((size_t)p[2] << 8) | (size_t)p[3];
+        if (len < 4 || json_length > len - 4) {
+            fprintf(stderr, "[IPC] Malformed binary frame, closing input\n");
+            return 0;
+        }
+        // JSON to the front so it reads like any other message; the
+        // terminator lands inside its old span, before the attachment
+        memmove(*buffer, *buffer + 4, json_length);
+        attachment = 4 + json_length;
+    }
+    (*buffer)[json_length] = '\0';
+    
+    if (length) *length = json_length;
+    if (attachment_offset) *attachment_offset = attachment;
+    if (attachment_length) *attachment_length = binary ? len - attachment : 0;
+    return 1;
+}
+
+static int ipc_read_into(FILE* stream, char** buffer, size_t* capacity, size_t* length,
+                         size_t* attachment_offset, size_t* attachment_length) {
+    if (attachment_length) *attachment_length = 0;
+    if (g_framing == IPC_FRAMING_LENGTH) {
+        return ipc_read_frame(stream, buffer, capacity, length, attachment_offset, attachment_length);
+    }
+    return ipc_read_line(stream, buffer, capacity, length);
+}
+
+char* ipc_read_message(FILE* stream, size_t* length) {
+    if (!stream) return NULL;
+    
+    char* buffer = NULL;
+    size_t capacity = 0;
+    if (!ipc_read_into(stream, &buffer, &capacity, length, NULL, NULL)) {
+        free(buffer);
+        return NULL;
+    }
+    return buffer;
+}
+
+void ipc_reader_init(ipc_reader_t* reader) {
+    reader->buffer = NULL;
+    reader->capacity = 0;
+    reader->attachment_offset = 0;
+    reader->attachment_length = 0;
+}
+
+void ipc_reader_destroy(ipc_reader_t* reader) {
+    free(reader->buffer);
+    ipc_reader_init(reader);
+}
+
+const char* ipc_reader_next(ipc_reader_t* reader, FILE* stream, size_t* length) {
+    if (!stream) return NULL;
+    
+    // Don't let one oversized message pin its buffer for the process lifetime
+    if (reader->capacity > IPC_READER_RETAIN_LIMIT) {
+        ipc_reader_destroy(reader);
+    }
+    
+    if (!ipc_read_into(stream, &reader->buffer, &reader->capacity, length,
+                       &reader->attachment_offset, &reader->attachment_length)) {
+        return NULL;
+    }
+    return reader->buffer;
+}
+
+int ipc_reader_detach_attachment(ipc_reader_t* reader, ipc_command_t* cmd) {
+    if (!reader->attachment_length || !reader->buffer) return 0;
+    
+    free(cmd->attachment_buffer);
+    cmd->attachment_buffer = reader->buffer;
+    cmd->attachment = (const unsigned char*)reader->buffer + reader->attachment_offset;
+    cmd->attachment_length = reader->attachment_length;
+    ipc_reader_init(reader);
+    return 1;
+}
+
+// JSON message writer
+#ifdef _WIN32
+static SRWLOCK g_write_lock = SRWLOCK_INIT;
+#define ipc_write_lock() AcquireSRWLockExclusive(&g_write_lock)
+#define ipc_write_unlock() ReleaseSRWLockExclusive(&g_write_lock)
+#else
+static pthread_mutex_t g_write_lock = PTHREAD_MUTEX_INITIALIZER;
+#define ipc_write_lock() pthread_mutex_lock(&g_write_lock)
+#define ipc_write_unlock() pthread_mutex_unlock(&g_write_lock)
+#endif
+
+// Loops only on partial writes; callers hold the write lock
+static int ipc_write_all(const char* data, size_t length) {
+#ifdef _WIN32
+    int fd = _fileno(stdout);
+#else
+    int fd = fileno(stdout);
+#endif
+    
+    while (length > 0) {
+#ifdef _WIN32
+        int written = _write(fd, data, length > 0x7FFFFFFF ? 0x7FFFFFFF : (unsigned int)length);
+#else
+        ssize_t written = write(fd, data, length);
+        if (written < 0 && errno == EINTR) continue;
+#endif
+        if (written <= 0) return 0;
+        data += written;
+        length -= (size_t)written;
+    }
+    return 1;
+}
+
+// Hand one message to the kernel. The lock keeps messages from different
+// threads from interleaving.
+static int ipc_write_fd(const char* data, size_t length) {
+    ipc_write_lock();
+    int ok = ipc_write_all(data, length);
+    ipc_write_unlock();
+    return ok;
+}
+
+static int ipc_json_writer_reserve(ipc_json_writer_t* writer, size_t extra) {
+    if (writer->failed) return 0;
+    if (writer->length + extra <= writer->capacity) return 1;
+    
+    size_t capacity = writer->capacity * 2;
+    while (capacity < writer->length + extra) capacity *= 2;
+    
+    char* data;
+    if (writer->data == writer->inline_buffer) {
+        data = (char*)malloc(capacity);
+        if (data) memcpy(data, writer->data, writer->length);
+    } else {
+        data = (char*)realloc(writer->data, capacity);
+    }
+    if (!data) {
+        writer->failed = 1;
+        return 0;
+    }
+    
+    writer->data = data;
+    writer->capacity = capacity;
+    return 1;
+}
+
+void ipc_json_writer_begin(ipc_json_writer_t* writer) {
+    writer->data = writer->inline_buffer;
+    writer->capacity = sizeof(writer->inline_buffer);
+    writer->length = IPC_FRAME_HEADER_LENGTH;  // Filled in by send when framing by length
+    writer->failed = 0;
+}
+
+void ipc_json_writer_append_n(ipc_json_writer_t* writer, const char* json, size_t length) {
+    if (!ipc_json_writer_reserve(writer, length)) return;
+    memcpy(writer->data + writer->length, json, length);
+    writer->length += length;
+}
+
+void ipc_json_writer_append(ipc_json_writer_t* writer, const char* json) {
+    ipc_json_writer_append_n(writer, json, strlen(json));
+}
+
+// SWAR test for a byte in an 8-byte word that needs escaping: control
+// characters (< 0x20), '"' or '\'. Bytes >= 0x80 (UTF-8) pass through.
+#define IPC_ONES 0x0101010101010101ULL
+#define IPC_HIGHS 0x8080808080808080ULL
+static int ipc_word_needs_escape(unsigned long long word) {
+    unsigned long long quote = word ^ (IPC_ONES * '"');
+    unsigned long long backslash = word ^ (IPC_ONES * '\\');
+    unsigned long long control = (word - IPC_ONES * 0x20) & ~word;
+    unsigned long long has_quote = (quote - IPC_ONES) & ~quote;
+    unsigned long long has_backslash = (backslash - IPC_ONES) & ~backslash;
+    return ((control | has_quote | has_backslash) & IPC_HIGHS) != 0;
+}
+
+static size_t ipc_clean_prefix(const char* text, size_t length) {
+    size_t pos = 0;
+    
+    // 8 bytes at a time until a word contains something to escape
+    while (pos + 8 <= length) {
+        unsigned long long word;
+        memcpy(&word, text + pos, sizeof(word));
+        if (ipc_word_needs_escape(word)) break;
+        pos += 8;
+    }
+    
+    while (pos < length) {
+        unsigned char c = (unsigned char)text[pos];
+        if (c < 0x20 || c == '"' || c == '\\') break;
+        pos++;
+    }
+    return pos;
+}
+
+void ipc_json_writer_string(ipc_json_writer_t* writer, const char* text) {
+    static const char hex[] = "0123456789abcdef";
+    
+    if (!text) {
+        ipc_json_writer_append_n(writer, "null", 4);
+        return;
+    }
+    
+    size_t length = strlen(text);
+    ipc_json_writer_append_n(writer, "\"", 1);
+    
+    size_t pos = 0;
+    while (pos < length) {
+        // Copy the clean run in one go, then escape the byte that stopped it
+        size_t clean = ipc_clean_prefix(text + pos, length - pos);
+        ipc_json_writer_append_n(writer, text + pos, clean);
+        pos += clean;
+        if (pos >= length) break;
+        
+        unsigned char c = (unsigned char)text[pos++];
+        char escape[6] = { '\\', 0, 0, 0, 0, 0 };
+        size_t escape_length = 2;
+        switch (c) {
+            case '"':  escape[1] = '"'; break;
+            case '\\': escape[1] = '\\'; break;
+            case '\n': escape[1] = 'n'; break;
+            case '\r': escape[1] = 'r'; break;
+            case '\t': escape[1] = 't'; break;
+            case '\b': escape[1] = 'b'; break;
+            case '\f': escape[1] = 'f'; break;
+            default:
+                escape[1] = 'u';
+                escape[2] = '0';
+                escape[3] = '0';
+                escape[4] = hex[c >> 4];
+                escape[5] = hex[c & 0x0F];
+                escape_length = 6;
+                break;
+        }
+        ipc_json_writer_append_n(writer, escape, escape_length);
+    }
+    
+    ipc_json_writer_append_n(writer, "\"", 1);
+}
+
+int ipc_json_writer_send(ipc_json_writer_t* writer) {
+    int ok = 0;
+    
+    if (!writer->failed) {
+        size_t payload = writer->length - IPC_FRAME_HEADER_LENGTH;
+        const char* start;
+        size_t total;
+        
+        if (g_framing == IPC_FRAMING_LENGTH) {
+            writer->data[0] = (char)((payload >> 24) & 0xFF);
+            writer->data[1] = (char)((payload >> 16) & 0xFF);
+            writer->data[2] = (char)((payload >> 8) & 0xFF);
+            writer->data[3] = (char)(payload & 0xFF);
+            start = writer->data;
+            total = writer->length;
+        } else {
+            ipc_json_writer_append_n(writer, "\n", 1);
+            start = writer->data + IPC_FRAME_HEADER_LENGTH;
+            total = payload + 1;
+        }
+        
+        ok = !writer->failed && ipc_write_fd(start, total);
+    }
+    
+    if (writer->data != writer->inline_buffer) {
+        free(writer->data);
+    }
+    writer->data = writer->inline_buffer;
+    return ok;
+}
+
+int ipc_json_writer_send_binary(ipc_json_writer_t* writer, const void* data, size_t length) {
+    int ok = 0;
+    size_t json_length = writer->length - IPC_FRAME_HEADER_LENGTH;
+    size_t payload = 4 + json_length + length;
+    
+    if (!writer->failed && g_framing == IPC_FRAMING_LENGTH && length <= IPC_MAX_FRAME_LENGTH &&
+        payload <= IPC_MAX_FRAME_LENGTH) {
+        unsigned char prefix[8];
+        size_t header = payload | IPC_FRAME_BINARY_FLAG;
+        prefix[0] = (unsigned char)((header >> 24) & 0xFF);
+        prefix[1] = (unsigned char)((header >> 16) & 0xFF);
+        prefix[2] = (unsigned char)((header >> 8) & 0xFF);
+        prefix[3] = (unsigned char)(header & 0xFF);
+        prefix[4] = (unsigned char)((json_length >> 24) & 0xFF);
+        prefix[5] = (unsigned char)((json_length >> 16) & 0xFF);
+        prefix[6] = (unsigned char)((json_length >> 8) & 0xFF);
+        prefix[7] = (unsigned char)(json_length & 0xFF);
+        
+        // One frame from three pieces, so the bytes never pass through the writer
+        ipc_write_lock();
+        ok = ipc_write_all((const char*)prefix, sizeof(prefix)) &&
+             ipc_write_all(writer->data + IPC_FRAME_HEADER_LENGTH, json_length) &&
+             (length == 0 || ipc_write_all((const char*)data, length));
+        ipc_write_unlock();
+    }
+    
+    if (writer->data != writer->inline_buffer) {
+        free(writer->data);
+    }
+    writer->data = writer->inline_buffer;
+    return ok;
+}
+
+void ipc_write_message(const char* message, size_t length) {
+    ipc_json_writer_t writer;
+    ipc_json_writer_begin(&writer);
+    ipc_json_writer_append_n(&writer, message, length);
+    ipc_json_writer_send(&writer);
+}
+
+void ipc_write_messagef(const char* format, ...) {
+    char stack_buffer[1024];
+    va_list args;
+    va_list args_copy;
+    
+    va_start(args, format);
+    va_copy(args_copy, args);
+    int needed = vsnprintf(stack_buffer, sizeof(stack_buffer), format, args);
+    va_end(args);
+    
+    if (needed >= 0 && (size_t)needed < sizeof(stack_buffer)) {
+        ipc_write_message(stack_buffer, (size_t)needed);
+    } else if (needed >= 0) {
+        char* heap_buffer = (char*)malloc((size_t)needed + 1);
+        if (heap_buffer) {
+            vsnprintf(heap_buffer, (size_t)needed + 1, format, args_copy);
+            ipc_write_message(heap_buffer, (size_t)needed);
+            free(heap_buffer);
+        }
+    }
+    
+    va_end(args_copy);
+}
+
+void ipc_write_ready(void) {
+    ipc_write_event("ipc:ready", g_framing == IPC_FRAMING_LENGTH
+                    ? "{\"framing\":\"length\"}" : "{\"framing\":\"line\"}");
+}
+
+// Response capture for batches, active on the thread running the batch
+static IPC_THREAD_LOCAL ipc_response_capture_t* t_capture = NULL;
+
+static int ipc_capture_response(const char* result, int raw, const char* error) {
+    ipc_response_capture_t* capture = t_capture;
+    if (!capture || !capture->slot) return 0;
+    
+    // A later write for the same sub-command (e.g. an error after "true") wins
+    cJSON_DeleteItemFromObject(capture->slot, "result");
+    cJSON_DeleteItemFromObject(capture->slot, "error");
+    if (error) {
+        cJSON_AddStringToObject(capture->slot, "error", error);
+    } else if (raw) {
+        cJSON_AddRawToObject(capture->slot, "result", result ? result : "null");
+    } else {
+        cJSON_AddStringToObject(capture->slot, "result", result ? result : "null");
+    }
+    return 1;
+}
+
 void ipc_write_response(const char* id, const char* result, const char* error) {
+    if (ipc_capture_response(result, 0, error)) return;
+    
+    ipc_json_writer_t writer;
+    ipc_json_writer_begin(&writer);
+    ipc_json_writer_append(&writer, "{\"type\":\"response\",\"id\":");
+    ipc_json_writer_string(&writer, id);
     if (error) {
-        printf("{\"type\":\"response\",\"id\":\"%s\",\"error\":\"%s\"}\n", id, error);
+        ipc_json_writer_append(&writer, ",\"error\":");
+        ipc_json_writer_string(&writer, error);
     } else {
-        printf("{\"type\":\"response\",\"id\":\"%s\",\"result\":\"%s\"}\n", id, result ? result : "null");
+        ipc_json_writer_append(&writer, ",\"result\":");
+        ipc_json_writer_string(&writer, result ? result : "null");
     }
-    fflush(stdout);
+    ipc_json_writer_append_n(&writer, "}", 1);
+    ipc_json_writer_send(&writer);
 }
 
 void ipc_write_json_response(const char* id, const char* json_result, const char* error) {
+    if (ipc_capture_response(json_result, 1, error)) return;
+    
+    ipc_json_writer_t writer;
+    ipc_json_writer_begin(&writer);
+    ipc_json_writer_append(&writer, "{\"type\":\"response\",\"id\":");
+    ipc_json_writer_string(&writer, id);
     if (error) {
-        printf("{\"type\":\"response\",\"id\":\"%s\",\"error\":\"%s\"}\n", id, error);
+        ipc_json_writer_append(&writer, ",\"error\":");
+        ipc_json_writer_string(&writer, error);
     } else {
-        printf("{\"type\":\"response\",\"id\":\"%s\",\"result\":%s}\n", id, json_result ? json_result : "null");
+        ipc_json_writer_append(&writer, ",\"result\":");
+        ipc_json_writer_append(&writer, json_result ? json_result : "null");
     }
-    fflush(stdout);
+    ipc_json_writer_append_n(&writer, "}", 1);
+    ipc_json_writer_send(&writer);
 }
 
 void ipc_write_event(const char* event_type, const char* data) {
+    ipc_json_writer_t writer;
+    ipc_json_writer_begin(&writer);
+    ipc_json_writer_append(&writer, "{\"type\":");
+    ipc_json_writer_string(&writer, event_type);
     if (data) {
-        printf("{\"type\":\"%s\",\"data\":%s}\n", event_type, data);
-    } else {
-        printf("{\"type\":\"%s\"}\n", event_type);
+        ipc_json_writer_append(&writer, ",\"data\":");
+        ipc_json_writer_append(&writer, data);
+    }
+    ipc_json_writer_append_n(&writer, "}", 1);
+    ipc_json_writer_send(&writer);
+}
+
+void ipc_write_event_string(const char* event_type, const char* key, const char* value) {
+    ipc_json_writer_t writer;
+    ipc_json_writer_begin(&writer);
+    ipc_json_writer_append(&writer, "{\"type\":");
+    ipc_json_writer_string(&writer, event_type);
+    ipc_json_writer_append(&writer, ",\"data\":{");
+    ipc_json_writer_string(&writer, key);
+    ipc_json_writer_append_n(&writer, ":", 1);
+    ipc_json_writer_string(&writer, value);
+    ipc_json_writer_append(&writer, "}}");
+    ipc_json_writer_send(&writer);
+}
+
+// Timing
+long long ipc_now_ms(void) {
+#ifdef _WIN32
+    return (long long)GetTickCount64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+long long ipc_now_us(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (long long)(counter.QuadPart * 1000000 / frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+int ipc_cond_wait_ms(ipc_cond_t* cond, ipc_mutex_t* mutex, long long timeout_ms) {
+    if (timeout_ms < 0) {
+        ipc_cond_wait(cond, mutex);
+        return 1;
+    }
+#ifdef _WIN32
+    return SleepConditionVariableCS(cond, mutex, (DWORD)timeout_ms) ? 1 : 0;
+#else
+    // pthread_cond_timedwait takes an absolute CLOCK_REALTIME deadline
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += (time_t)(timeout_ms / 1000);
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    return pthread_cond_timedwait(cond, mutex, &deadline) == 0 ? 1 : 0;
+#endif
+}
+
+// Completion signalling
+void ipc_completion_init(ipc_completion_t* completion) {
+    completion->done = 0;
+    completion->abandoned = 0;
+    ipc_mutex_init(&completion->lock);
+    ipc_cond_init(&completion->cond);
+}
+
+void ipc_completion_destroy(ipc_completion_t* completion) {
+    ipc_cond_destroy(&completion->cond);
+    ipc_mutex_destroy(&completion->lock);
+}
+
+int ipc_completion_signal(ipc_completion_t* completion) {
+    ipc_mutex_lock(&completion->lock);
+    completion->done = 1;
+    int abandoned = completion->abandoned;
+    ipc_cond_signal(&completion->cond);
+    ipc_mutex_unlock(&completion->lock);
+    return abandoned;
+}
+
+int ipc_completion_wait(ipc_completion_t* completion, int timeout_ms) {
+    long long deadline = ipc_now_ms() + timeout_ms;
+    
+    ipc_mutex_lock(&completion->lock);
+    while (!completion->done) {
+        long long remaining = timeout_ms < 0 ? -1 : deadline - ipc_now_ms();
+        if (timeout_ms >= 0 && remaining <= 0) break;
+        ipc_cond_wait_ms(&completion->cond, &completion->lock, remaining);
+    }
+    int done = completion->done;
+    if (!done) completion->abandoned = 1;
+    ipc_mutex_unlock(&completion->lock);
+    
+    return done;
+}
+
+// Batches
+void ipc_run_batch(const ipc_command_t* batch, ipc_command_runner_t run, void* target) {
+    const cJSON* commands = ipc_command_get_param(batch, "commands");
+    int stop_on_error = ipc_command_get_bool(batch, "stop_on_error", 1);
+    int failed = 0;
+    
+    ipc_response_capture_t capture;
+    capture.results = cJSON_CreateArray();
+    capture.slot = NULL;
+    if (!capture.results) {
+        ipc_write_response(batch->id, NULL, "Out of memory");
+        return;
+    }
+    
+    ipc_response_capture_t* previous = t_capture;
+    t_capture = &capture;
+    
+    const cJSON* item = NULL;
+    cJSON_ArrayForEach(item, commands) {
+        capture.slot = cJSON_CreateObject();
+        if (!capture.slot) break;
+        cJSON_AddItemToArray(capture.results, capture.slot);
+        
+        if (failed && stop_on_error) {
+            ipc_write_response(batch->id, NULL, "Skipped after an earlier error");
+            continue;
+        }
+        
+        // Sub-commands borrow the batch's id, tree and arena
+        ipc_command_t sub;
+        const cJSON* method = cJSON_GetObjectItem(item, "method");
+        const cJSON* params = cJSON_GetObjectItem(item, "params");
+        sub.root = NULL;
+        sub.method = cJSON_IsString(method) ? cJSON_GetStringValue(method) : NULL;
+        sub.id = batch->id;
+        sub.params = cJSON_IsObject(params) ? params : NULL;
+        sub.deadline_ms = 0;
+        sub.target = batch->target;
+        sub.raw_key = NULL;
+        sub.raw_value = NULL;
+        sub.raw_length = 0;
+        sub.attachment = batch->attachment;
+        sub.attachment_length = batch->attachment_length;
+        sub.attachment_buffer = NULL;
+        sub.arena = batch->arena;
+        
+        if (!sub.method) {
+            ipc_write_response(batch->id, NULL, "Invalid command format");
+        } else if (strcmp(sub.method, batch->method) == 0) {
+            ipc_write_response(batch->id, NULL, "Nested batches are not supported");
+        } else {
+            run(target, &sub);
+        }
+        
+        if (cJSON_GetObjectItem(capture.slot, "error")) {
+            failed = 1;
+        } else if (!cJSON_GetObjectItem(capture.slot, "result")) {
+            cJSON_AddNullToObject(capture.slot, "result");
+        }
+    }
+    
+    t_capture = previous;
+    
+    char* results = cJSON_PrintUnformatted(capture.results);
+    cJSON_Delete(capture.results);
+    ipc_write_json_response(batch->id, results ? results : "[]", NULL);
+    cJSON_free(results);
+}
+
+// Method tables
+static unsigned int ipc_method_hash(const char* name, unsigned int seed) {
+    // FNV-1a, seeded so the table builder can search for a collision-free seed
+    unsigned int hash = 2166136261u ^ seed;
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
     }
-    fflush(stdout);
+    hash ^= hash >> 15;
+    return hash;
+}
+
+int ipc_method_table_init(ipc_method_table_t* table, ipc_method_t* methods, int count) {
+    table->methods = methods;
+    table->count = count;
+    table->seed = 0;
+    table->mask = 0;
+    table->slots = NULL;
+    
+    for (int i = 0; i < count; i++) {
+        for (int j = i + 1; j < count; j++) {
+            if (strcmp(methods[i].name, methods[j].name) == 0) {
+                fprintf(stderr, "[IPC] Duplicate method in table: %s\n", methods[i].name);
+                return 0;
+            }
+        }
+    }
+    
+    // Start with 4x the entries and grow until a seed maps every name to its own slot
+    unsigned int size = 8;
+    while (size < (unsigned int)count * 4) size <<= 1;
+    
+    for (; size <= (1u << 15); size <<= 1) {
+        short* slots = (short*)malloc(sizeof(short) * size);
+        if (!slots) return 0;
+        
+        for (unsigned int seed = 1; seed <= 4096; seed++) {
+            int collision = 0;
+            memset(slots, 0xFF, sizeof(short) * size);
+            
+            for (int i = 0; i < count && !collision; i++) {
+                unsigned int slot = ipc_method_hash(methods[i].name, seed) & (size - 1);
+                if (slots[slot] >= 0) collision = 1;
+                else slots[slot] = (short)i;
+            }
+            
+            if (!collision) {
+                table->seed = seed;
+                table->mask = size - 1;
+                table->slots = slots;
+                return 1;
+            }
+        }
+        free(slots);
+    }
+    
+    return 0;
+}
+
+void ipc_method_table_destroy(ipc_method_table_t* table) {
+    free(table->slots);
+    table->slots = NULL;
+}
+
+ipc_method_t* ipc_method_table_lookup(const ipc_method_table_t* table, const char* name) {
+    if (!table->slots || !name) return NULL;
+    
+    short index = table->slots[ipc_method_hash(name, table->seed) & table->mask];
+    if (index < 0) return NULL;
+    
+    // One comparison rejects names that merely share the slot
+    ipc_method_t* method = &table->methods[index];
+    return strcmp(method->name, name) == 0 ? method : NULL;
+}
+
+static int ipc_param_matches(const cJSON* item, ipc_param_type_t type) {
+    switch (type) {
+        case IPC_PARAM_STRING: return cJSON_IsString(item);
+        case IPC_PARAM_NUMBER: return cJSON_IsNumber(item);
+        case IPC_PARAM_BOOL:   return cJSON_IsBool(item) || cJSON_IsNumber(item);
+        case IPC_PARAM_OBJECT: return cJSON_IsObject(item);
+        case IPC_PARAM_ARRAY:  return cJSON_IsArray(item);
+        default:               return 1;
+    }
+}
+
+int ipc_method_validate(const ipc_method_t* method, const ipc_command_t* command, char* error, size_t error_len) {
+    if (!method->params) return 1;
+    
+    for (const ipc_param_spec_t* spec = method->params; spec->name; spec++) {
+        const cJSON* item = ipc_command_get_param(command, spec->name);
+        if (!item) {
+            if (spec->required) {
+                snprintf(error, error_len, "Missing required param: %s", spec->name);
+                return 0;
+            }
+            continue;
+        }
+        if (!ipc_param_matches(item, spec->type)) {
+            snprintf(error, error_len, "Invalid type for param: %s", spec->name);
+            return 0;
+        }
+    }
+    
+    return 1;
+}
+
+ipc_dispatch_result_t ipc_method_table_dispatch(ipc_method_table_t* table, void* target, const ipc_command_t* command, int* status) {
+    ipc_method_t* method = ipc_method_table_lookup(table, command->method);
+    if (!method) return IPC_DISPATCH_UNKNOWN_METHOD;
+    
+    char error[IPC_MAX_KEY_LENGTH + 64];
+    if (!ipc_method_validate(method, command, error, sizeof(error))) {
+        method->errors++;
+        ipc_write_response(command->id, NULL, error);
+        return IPC_DISPATCH_INVALID_PARAMS;
+    }
+    
+    long long start = ipc_now_us();
+    int result = method->handler(target, command);
+    long long elapsed = ipc_now_us() - start;
+    
+    method->calls++;
+    if (result != 0) method->errors++;
+    method->total_us += elapsed;
+    if (elapsed > method->max_us) method->max_us = elapsed;
+    
+    if (status) *status = result;
+    return IPC_DISPATCH_OK;
+}
+
+char* ipc_method_table_metrics_json(const ipc_method_table_t* table) {
+    cJSON* metrics = cJSON_CreateObject();
+    if (!metrics) return NULL;
+    
+    for (int i = 0; i < table->count; i++) {
+        const ipc_method_t* method = &table->methods[i];
+        cJSON* entry = cJSON_AddObjectToObject(metrics, method->name);
+        if (!entry) continue;
+        cJSON_AddNumberToObject(entry, "calls", (double)method->calls);
+        cJSON_AddNumberToObject(entry, "errors", (double)method->errors);
+        cJSON_AddNumberToObject(entry, "total_us", (double)method->total_us);
+        cJSON_AddNumberToObject(entry, "max_us", (double)method->max_us);
+    }
+    
+    char* json = cJSON_PrintUnformatted(metrics);
+    cJSON_Delete(metrics);
+    return json;
+}
+
+// Pipelined execution
+void ipc_pipeline_init(ipc_pipeline_t* pipeline, int window, int default_deadline_ms) {
+    ipc_mutex_init(&pipeline->lock);
+    ipc_cond_init(&pipeline->slot_free);
+    ipc_cond_init(&pipeline->changed);
+    pipeline->head = NULL;
+    pipeline->in_flight = 0;
+    pipeline->window = window > 0 ? window : 1;
+    pipeline->default_deadline_ms = default_deadline_ms > 0 ? default_deadline_ms : IPC_DEFAULT_DEADLINE_MS;
+    pipeline->shutdown = 0;
+}
+
+void ipc_pipeline_init_from_env(ipc_pipeline_t* pipeline) {
+    const char* window = getenv(IPC_PIPELINE_WINDOW_ENV);
+    const char* deadline = getenv(IPC_PIPELINE_DEADLINE_ENV);
+    
+    ipc_pipeline_init(pipeline,
+                      window ? atoi(window) : IPC_DEFAULT_PIPELINE_WINDOW,
+                      deadline ? atoi(deadline) : IPC_DEFAULT_DEADLINE_MS);
+}
+
+void ipc_pipeline_destroy(ipc_pipeline_t* pipeline) {
+    ipc_cond_destroy(&pipeline->changed);
+    ipc_cond_destroy(&pipeline->slot_free);
+    ipc_mutex_destroy(&pipeline->lock);
+}
+
+static void ipc_pipeline_unlink(ipc_pipeline_t* pipeline, ipc_pipeline_entry_t* entry) {
+    if (entry->prev) entry->prev->next = entry->next;
+    else pipeline->head = entry->next;
+    if (entry->next) entry->next->prev = entry->prev;
+    entry->prev = NULL;
+    entry->next = NULL;
+}
+
+int ipc_pipeline_submit(ipc_pipeline_t* pipeline, ipc_pipeline_entry_t* entry, const char* id, int deadline_ms) {
+    strncpy(entry->id, id ? id : "unknown", sizeof(entry->id) - 1);
+    entry->id[sizeof(entry->id) - 1] = '\0';
+    entry->state = IPC_PIPELINE_PENDING;
+    entry->prev = NULL;
+    
+    ipc_mutex_lock(&pipeline->lock);
+    while (pipeline->in_flight >= pipeline->window && !pipeline->shutdown) {
+        ipc_cond_wait(&pipeline->slot_free, &pipeline->lock);
+    }
+    if (pipeline->shutdown) {
+        ipc_mutex_unlock(&pipeline->lock);
+        return 0;
+    }
+    
+    // Deadline starts once the command actually enters the window
+    entry->deadline = ipc_now_ms() + (deadline_ms > 0 ? deadline_ms : pipeline->default_deadline_ms);
+    entry->next = pipeline->head;
+    if (pipeline->head) pipeline->head->prev = entry;
+    pipeline->head = entry;
+    pipeline->in_flight++;
+    
+    ipc_cond_signal(&pipeline->changed);
+    ipc_mutex_unlock(&pipeline->lock);
+    return 1;
+}
+
+int ipc_pipeline_begin(ipc_pipeline_t* pipeline, ipc_pipeline_entry_t* entry) {
+    ipc_mutex_lock(&pipeline->lock);
+    if (entry->state == IPC_PIPELINE_EXPIRED) {
+        // Its error was already reported; the slot is held until it gets here
+        ipc_pipeline_unlink(pipeline, entry);
+        pipeline->in_flight--;
+        ipc_cond_signal(&pipeline->slot_free);
+        ipc_mutex_unlock(&pipeline->lock);
+        return 0;
+    }
+    entry->state = IPC_PIPELINE_RUNNING;
+    ipc_mutex_unlock(&pipeline->lock);
+    return 1;
+}
+
+void ipc_pipeline_end(ipc_pipeline_t* pipeline, ipc_pipeline_entry_t* entry) {
+    ipc_mutex_lock(&pipeline->lock);
+    ipc_pipeline_unlink(pipeline, entry);
+    pipeline->in_flight--;
+    ipc_cond_signal(&pipeline->slot_free);
+    ipc_mutex_unlock(&pipeline->lock);
+}
+
+// Expire one due entry, copying its ID out since the entry may be freed once
+// the lock drops. next_wait receives the wait until the next pending deadline.
+static int ipc_pipeline_take_expired_locked(ipc_pipeline_t* pipeline, char* id, long long* next_wait) {
+    long long now = ipc_now_ms();
+    *next_wait = -1;
+    
+    for (ipc_pipeline_entry_t* entry = pipeline->head; entry; entry = entry->next) {
+        if (entry->state != IPC_PIPELINE_PENDING) continue;
+        
+        if (entry->deadline <= now) {
+            entry->state = IPC_PIPELINE_EXPIRED;
+            memcpy(id, entry->id, IPC_MAX_ID_LENGTH);
+            return 1;
+        }
+        if (*next_wait < 0 || entry->deadline - now < *next_wait) {
+            *next_wait = entry->deadline - now;
+        }
+    }
+    
+    return 0;
+}
+
+// Report every due entry, writing each error with the lock dropped
+static long long ipc_pipeline_expire_due_locked(ipc_pipeline_t* pipeline) {
+    char id[IPC_MAX_ID_LENGTH];
+    long long next_wait;
+    
+    while (ipc_pipeline_take_expired_locked(pipeline, id, &next_wait)) {
+        ipc_mutex_unlock(&pipeline->lock);
+        ipc_write_response(id, NULL, "Command deadline exceeded");
+        ipc_mutex_lock(&pipeline->lock);
+    }
+    
+    return next_wait;
+}
+
+long long ipc_pipeline_expire_due(ipc_pipeline_t* pipeline) {
+    ipc_mutex_lock(&pipeline->lock);
+    long long next_wait = ipc_pipeline_expire_due_locked(pipeline);
+    ipc_mutex_unlock(&pipeline->lock);
+    return next_wait;
+}
+
+void ipc_pipeline_shutdown(ipc_pipeline_t* pipeline) {
+    ipc_mutex_lock(&pipeline->lock);
+    pipeline->shutdown = 1;
+    ipc_cond_broadcast(&pipeline->slot_free);
+    ipc_cond_broadcast(&pipeline->changed);
+    ipc_mutex_unlock(&pipeline->lock);
+}
+
+THREAD_RETURN ipc_pipeline_watchdog_thread(THREAD_ARG arg) {
+    ipc_pipeline_t* pipeline = (ipc_pipeline_t*)arg;
+    
+    ipc_mutex_lock(&pipeline->lock);
+    while (!pipeline->shutdown) {
+        long long next_wait = ipc_pipeline_expire_due_locked(pipeline);
+        ipc_cond_wait_ms(&pipeline->changed, &pipeline->lock, next_wait);
+    }
+    ipc_mutex_unlock(&pipeline->lock);
+    
+    return 0;
 }
 
 ipc_command_dispatch_t* ipc_create_command_dispatch(void* target, const char* command, ipc_command_executor_t executor) {
-    ipc_command_dispatch_t* dispatch = (ipc_command_dispatch_t*)malloc(sizeof(ipc_command_dispatch_t));
+    size_t command_length = strlen(command);
+    ipc_command_dispatch_t* dispatch = (ipc_command_dispatch_t*)malloc(sizeof(ipc_command_dispatch_t) + command_length + 1);
     if (!dispatch) return NULL;
     
+    // The command text is stored right after the struct, sized to fit
     dispatch->target = target;
-    strncpy(dispatch->command, command, IPC_MAX_COMMAND_LENGTH - 1);
-    dispatch->command[IPC_MAX_COMMAND_LENGTH - 1] = '\0';
-    dispatch->response[0] = '\0';
+    dispatch->command = (char*)(dispatch + 1);
+    memcpy(dispatch->command, command, command_length + 1);
     dispatch->execute_callback = executor;
-    
-    int* response_ready = (int*)malloc(sizeof(int));
-    *response_ready = 0;
-    dispatch->response_ready = response_ready;
+    ipc_completion_init(&dispatch->completion);
     
     return dispatch;
 }
 
+void ipc_complete_dispatch(ipc_command_dispatch_t* dispatch) {
+    if (!dispatch) return;
+    
+    // The waiter timed out and left the dispatch to us
+    if (ipc_completion_signal(&dispatch->completion)) {
+        ipc_completion_destroy(&dispatch->completion);
+        free(dispatch);
+    }
+}
+
 int ipc_execute_dispatch_sync(ipc_command_dispatch_t* dispatch, int timeout_ms) {
     if (!dispatch || !dispatch->execute_callback) return 0;
     
     dispatch->execute_callback(dispatch->target, dispatch);
     
-    int timeout_count = 0;
-    int sleep_interval = 10; // 10ms intervals
-    int max_iterations = timeout_ms / sleep_interval;
+    int completed = ipc_completion_wait(&dispatch->completion, timeout_ms);
     
-    while (!(*dispatch->response_ready) && timeout_count < max_iterations) {
-        thread_sleep(sleep_interval);
-        timeout_count++;
+    // Clean up (on timeout the executor frees it in ipc_complete_dispatch)
+    if (completed) {
+        ipc_completion_destroy(&dispatch->completion);
+        free(dispatch);
     }
     
-    int completed = *dispatch->response_ready;
-    
-    // Clean up
-    free(dispatch->response_ready);
-    free(dispatch);
-    
     return completed;
 }
 
@@ -226,21 +1702,19 @@ void ipc_set_command_processor(void (*processor)(const char* command, void* cont
 
 THREAD_RETURN ipc_stdin_monitor_thread(THREAD_ARG arg) {
     ipc_base_context_t* context = (ipc_base_context_t*)arg;
-    char command_buffer[IPC_MAX_COMMAND_LENGTH];
     
     fprintf(stderr, "[IPC] Command monitor thread started (reading from stdin)\n");
     
+    ipc_reader_t reader;
+    ipc_reader_init(&reader);
+    
     while (!context->should_exit) {
-        // Read command from stdin
-        if (fgets(command_buffer, sizeof(command_buffer), stdin) != NULL) {
-            // Remove newline if present
-            size_t len = strlen(command_buffer);
-            if (len > 0 && command_buffer[len-1] == '\n') {
-                command_buffer[len-1] = '\0';
-            }
-            
-            if (strlen(command_buffer) > 0) {
-                fprintf(stderr, "[IPC] New command detected: %s\n", command_buffer);
+        // Read command from stdin (a line or a frame, of any size) into a reused buffer
+        size_t length = 0;
+        const char* command_buffer = ipc_reader_next(&reader, stdin, &length);
+        if (command_buffer != NULL) {
+            if (length > 0) {
+                fprintf(stderr, "[IPC] New command detected (%lu bytes)\n", (unsigned long)length);
                 
                 if (g_command_processor) {
                     g_command_processor(command_buffer, context);
@@ -254,6 +1728,7 @@ THREAD_RETURN ipc_stdin_monitor_thread(THREAD_ARG arg) {
         }
     }
     
+    ipc_reader_destroy(&reader);
     fprintf(stderr, "[IPC] Command monitor thread exiting\n");
     return 0;
 }
@@ -16,6 +16,7 @@ extern "C" {
 #include <stdlib.h>
 #include <string.h>
 #include <stddef.h>
+#include <stdarg.h>
 #include "cJSON.h"
 
 // Platform-specific threading
@@ -26,6 +27,17 @@ extern "C" {
 #define THREAD_ARG LPVOID
 #define ipc_thread_create(func, arg) _beginthreadex(NULL, 0, (unsigned int (__stdcall *)(void *))func, arg, 0, NULL)
 #define thread_sleep(ms) Sleep(ms)
+typedef CRITICAL_SECTION ipc_mutex_t;
+typedef CONDITION_VARIABLE ipc_cond_t;
+#define ipc_mutex_init(m) InitializeCriticalSection(m)
+#define ipc_mutex_destroy(m) DeleteCriticalSection(m)
+#define ipc_mutex_lock(m) EnterCriticalSection(m)
+#define ipc_mutex_unlock(m) LeaveCriticalSection(m)
+#define ipc_cond_init(c) InitializeConditionVariable(c)
+#define ipc_cond_destroy(c) ((void)(c))
+#define ipc_cond_signal(c) WakeConditionVariable(c)
+#define ipc_cond_broadcast(c) WakeAllConditionVariable(c)
+#define ipc_cond_wait(c, m) SleepConditionVariableCS(c, m, INFINITE)
 #else
 #include <pthread.h>
 #include <unistd.h>
@@ -33,14 +45,61 @@ extern "C" {
 #define THREAD_ARG void*
 #define ipc_thread_create(func, arg) do { pthread_t t; pthread_create(&t, NULL, func, arg); pthread_detach(t); } while(0)
 #define thread_sleep(ms) usleep((ms) * 1000)
+typedef pthread_mutex_t ipc_mutex_t;
+typedef pthread_cond_t ipc_cond_t;
+#define ipc_mutex_init(m) pthread_mutex_init(m, NULL)
+#define ipc_mutex_destroy(m) pthread_mutex_destroy(m)
+#define ipc_mutex_lock(m) pthread_mutex_lock(m)
+#define ipc_mutex_unlock(m) pthread_mutex_unlock(m)
+#define ipc_cond_init(c) pthread_cond_init(c, NULL)
+#define ipc_cond_destroy(c) pthread_cond_destroy(c)
+#define ipc_cond_signal(c) pthread_cond_signal(c)
+#define ipc_cond_broadcast(c) pthread_cond_broadcast(c)
+#define ipc_cond_wait(c, m) pthread_cond_wait(c, m)
 #endif
 
+// Completion signalling (condition variable + flag)
+typedef struct {
+    ipc_mutex_t lock;
+    ipc_cond_t cond;
+    int done;
+    int abandoned;
+} ipc_completion_t;
+
 // Common constants
 #define IPC_MAX_COMMAND_LENGTH 32768
 #define IPC_MAX_METHOD_LENGTH 256
 #define IPC_MAX_ID_LENGTH 256
 #define IPC_MAX_KEY_LENGTH 256
 
+// Pipelined execution defaults (overridable through the environment)
+#define IPC_PIPELINE_WINDOW_ENV "TRONBUN_IPC_MAX_INFLIGHT"
+#define IPC_PIPELINE_DEADLINE_ENV "TRONBUN_IPC_DEADLINE_MS"
+#define IPC_DEFAULT_PIPELINE_WINDOW 1
+#define IPC_DEFAULT_DEADLINE_MS 1000
+
+// Per-command arenas and reusable read buffers: small first block, and
+// anything above the retain limit is handed back after an oversized message
+#define IPC_ARENA_BLOCK_SIZE 4096
+#define IPC_ARENA_RETAIN_LIMIT (256u * 1024u)
+#define IPC_READER_RETAIN_LIMIT (256u * 1024u)
+#define IPC_COMMAND_POOL_MAX_FREE 64
+
+// Length-prefixed framing: 4-byte big-endian payload length, then the JSON payload
+#define IPC_FRAME_HEADER_LENGTH 4
+#define IPC_MAX_FRAME_LENGTH (1024u * 1024u * 1024u)
+
+// Binary frames set the top bit of the length; their payload is a 4-byte
+// big-endian JSON length, the JSON, then raw attachment bytes
+#define IPC_FRAME_BINARY_FLAG 0x80000000u
+#define IPC_FRAMING_ENV "TRONBUN_IPC_FRAMING"
+
+// IPC transport framing modes
+typedef enum {
+    IPC_FRAMING_LINE,   // newline-delimited JSON (default)
+    IPC_FRAMING_LENGTH  // length-prefixed JSON frames, no size ceiling
+} ipc_framing_t;
+
 // IPC response types
 typedef enum {
     IPC_RESPONSE_TYPE_RESPONSE,
@@ -48,6 +107,110 @@ typedef enum {
     IPC_RESPONSE_TYPE_EVENT
 } ipc_response_type_t;
 
+// Bump allocator backing one command (parsed tree and handler scratch)
+typedef struct ipc_arena_block {
+    struct ipc_arena_block* next;
+    size_t capacity;
+    size_t used;
+} ipc_arena_block_t;
+
+typedef struct ipc_arena {
+    ipc_arena_block_t* head;  // Block currently allocated from
+} ipc_arena_t;
+
+// Outgoing message under construction: header space, payload, then newline
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+    int failed;
+    char inline_buffer[1024];
+} ipc_json_writer_t;
+
+// Reusable input buffer for ipc_reader_next
+typedef struct {
+    char* buffer;
+    size_t capacity;
+    size_t attachment_offset;  // Attachment of the last binary frame, within buffer
+    size_t attachment_length;  // 0 after a plain message
+} ipc_reader_t;
+
+// Lifecycle of a pipelined command
+typedef enum {
+    IPC_PIPELINE_PENDING,  // Queued for the main thread
+    IPC_PIPELINE_RUNNING,  // Handler has started
+    IPC_PIPELINE_EXPIRED   // Deadline passed before it started; error reported, slot still held
+} ipc_pipeline_state_t;
+
+// In-flight command record, embedded in the app's dispatch structure
+typedef struct ipc_pipeline_entry {
+    struct ipc_pipeline_entry* prev;
+    struct ipc_pipeline_entry* next;
+    char id[IPC_MAX_ID_LENGTH];
+    long long deadline;  // ipc_now_ms() value the command must start by
+    ipc_pipeline_state_t state;
+} ipc_pipeline_entry_t;
+
+// Bounded window of commands submitted but not yet finished
+typedef struct {
+    ipc_mutex_t lock;
+    ipc_cond_t slot_free;  // Reader waits here when the window is full
+    ipc_cond_t changed;    // Watchdog waits here for new entries or shutdown
+    ipc_pipeline_entry_t* head;
+    int in_flight;
+    int window;
+    int default_deadline_ms;
+    int shutdown;
+} ipc_pipeline_t;
+
+// Parameter types for method schemas
+typedef enum {
+    IPC_PARAM_ANY,
+    IPC_PARAM_STRING,
+    IPC_PARAM_NUMBER,
+    IPC_PARAM_BOOL,    // JSON boolean or number
+    IPC_PARAM_OBJECT,
+    IPC_PARAM_ARRAY
+} ipc_param_type_t;
+
+// One entry of a method's param schema (arrays end with a NULL name)
+typedef struct {
+    const char* name;
+    ipc_param_type_t type;
+    int required;
+} ipc_param_spec_t;
+
+// Method handler: returns 0 on success or an app-specific error status
+struct ipc_command;
+typedef int (*ipc_method_handler_t)(void* target, const struct ipc_command* command);
+
+// Method table entry: name, handler, param schema and per-method metrics
+typedef struct {
+    const char* name;
+    ipc_method_handler_t handler;
+    const ipc_param_spec_t* params;  // NULL if the method takes no params
+    unsigned long calls;
+    unsigned long errors;
+    long long total_us;
+    long long max_us;
+} ipc_method_t;
+
+// Perfect hash from method name to table entry, built once at startup
+typedef struct {
+    ipc_method_t* methods;
+    int count;
+    unsigned int seed;
+    unsigned int mask;
+    short* slots;  // Index into methods, or -1
+} ipc_method_table_t;
+
+// Method dispatch outcomes
+typedef enum {
+    IPC_DISPATCH_OK,
+    IPC_DISPATCH_UNKNOWN_METHOD,
+    IPC_DISPATCH_INVALID_PARAMS
+} ipc_dispatch_result_t;
+
 // Base context structure for IPC-enabled applications
 typedef struct {
     int should_exit;
@@ -57,9 +220,8 @@ typedef struct {
 // Command dispatch structure for cross-thread communication
 typedef struct {
     void* target;  // Target object (webview, tray, etc.)
-    char command[IPC_MAX_COMMAND_LENGTH];
-    char response[IPC_MAX_COMMAND_LENGTH];
-    int* response_ready;
+    char* command; // Command text, allocated together with the struct
+    ipc_completion_t completion;  // Signalled by the executor via ipc_complete_dispatch
     void (*execute_callback)(void* target, void* dispatch_data);
 } ipc_command_dispatch_t;
 
@@ -112,6 +274,309 @@ void ipc_extract_param_float(const char* params, const char* key, float* value);
  */
 void ipc_extract_param_json(const char* params, const char* key, char* value, size_t max_len);
 
+// Parsed command API
+/**
+ * A command parsed once into a cJSON tree. Handlers read params through the
+ * typed accessors below instead of re-parsing a params string per key.
+ * method and id point into the tree and stay valid until ipc_command_release.
+ */
+typedef struct ipc_command {
+    cJSON* root;
+    const char* method;
+    const char* id;
+    const cJSON* params;  // params object, or NULL if absent
+    int deadline_ms;      // Optional per-command deadline, 0 if absent
+    int target;           // Host object handle the command addresses, -1 if absent
+    ipc_arena_t* arena;   // Owns the tree when set (see ipc_command_parse_in)
+    const char* raw_key;  // Param kept as raw JSON text (its tree value is null)
+    const char* raw_value;
+    size_t raw_length;
+    const unsigned char* attachment;  // Raw bytes of a binary frame, or NULL
+    size_t attachment_length;
+    void* attachment_buffer;          // Frees attachment on release
+} ipc_command_t;
+
+// Reusable command object: parsed command, its arena and pipeline record
+typedef struct ipc_pooled_command {
+    ipc_pipeline_entry_t entry;  // In-flight record when pipelined
+    ipc_command_t command;
+    ipc_arena_t arena;
+    void* context;               // Owner context (webview, tray, ...)
+    struct ipc_command_pool* pool;
+    struct ipc_pooled_command* next_free;
+} ipc_pooled_command_t;
+
+// Collects sub-command responses of a batch instead of writing them to stdout
+typedef struct {
+    cJSON* results;  // One {"result":...} or {"error":...} object per sub-command
+    cJSON* slot;     // Entry for the sub-command currently running
+} ipc_response_capture_t;
+
+// Runs one (sub-)command and writes its response
+typedef void (*ipc_command_runner_t)(void* target, const ipc_command_t* command);
+
+// Freelist of command objects shared by the reader and executor threads
+typedef struct ipc_command_pool {
+    ipc_mutex_t lock;
+    ipc_pooled_command_t* free_list;
+    int free_count;
+    int max_free;
+    unsigned long created;  // Command objects allocated so far
+    const char* passthrough_method;  // Method whose param is forwarded unparsed
+    const char* passthrough_key;
+} ipc_command_pool_t;
+
+/**
+ * Parse a JSON command line into a command object
+ * @param json JSON command string
+ * @param cmd Output command object (always call ipc_command_release afterwards)
+ * @return 1 on success, 0 on failure (cmd->id is still set, to "unknown" if missing)
+ */
+int ipc_command_parse(const char* json, ipc_command_t* cmd);
+
+/**
+ * Parse a JSON command with its tree allocated from an arena
+ * @param json JSON command string
+ * @param cmd Output command object (always call ipc_command_release afterwards)
+ * @param arena Arena owning the tree until it is reset (NULL for the heap)
+ * @return 1 on success, 0 on failure (cmd->id is still set, to "unknown" if missing)
+ */
+int ipc_command_parse_in(const char* json, ipc_command_t* cmd, ipc_arena_t* arena);
+
+/**
+ * Release the parsed tree owned by a command object
+ * @param cmd Command object
+ */
+void ipc_command_release(ipc_command_t* cmd);
+
+/**
+ * Get a raw parameter node
+ * @param cmd Command object
+ * @param key Parameter key
+ * @return cJSON node or NULL if missing
+ */
+const cJSON* ipc_command_get_param(const ipc_command_t* cmd, const char* key);
+
+/**
+ * Get the raw JSON text of a passthrough param, exactly as it arrived
+ * @param cmd Command object
+ * @param key Parameter key
+ * @param length Output for the text length (may be NULL)
+ * @return NUL-terminated JSON text, or NULL if the param was parsed into the tree
+ */
+const char* ipc_command_get_raw_param(const ipc_command_t* cmd, const char* key, size_t* length);
+
+/**
+ * Find the raw text of a member of a JSON object without parsing it
+ * @param json JSON object text
+ * @param length Length of the text
+ * @param key Member name
+ * @param value Output for the start of the member's value
+ * @param value_length Output for the length of the value
+ * @return 1 if found, 0 if missing or the text is malformed
+ */
+int ipc_json_find_member(const char* json, size_t length, const char* key, const char** value, size_t* value_length);
+
+/**
+ * Find the raw text of an element of a JSON array without parsing it
+ * @param json JSON array text
+ * @param length Length of the text
+ * @param index Zero-based element index
+ * @param value Output for the start of the element
+ * @param value_length Output for the length of the element
+ * @return 1 if found, 0 if out of range or the text is malformed
+ */
+int ipc_json_find_element(const char* json, size_t length, int index, const char** value, size_t* value_length);
+
+/**
+ * Get a string parameter (no copy)
+ * @param cmd Command object
+ * @param key Parameter key
+ * @param default_value Value returned when the key is missing or not a string
+ * @return Pointer into the parsed tree, valid until ipc_command_release
+ */
+const char* ipc_command_get_string(const ipc_command_t* cmd, const char* key, const char* default_value);
+
+/**
+ * Get an integer parameter
+ * @param cmd Command object
+ * @param key Parameter key
+ * @param default_value Value returned when the key is missing or not a number
+ * @return Parameter value
+ */
+int ipc_command_get_int(const ipc_command_t* cmd, const char* key, int default_value);
+
+/**
+ * Get a float parameter
+ * @param cmd Command object
+ * @param key Parameter key
+ * @param default_value Value returned when the key is missing or not a number
+ * @return Parameter value
+ */
+float ipc_command_get_float(const ipc_command_t* cmd, const char* key, float default_value);
+
+/**
+ * Get a boolean parameter (accepts JSON booleans and numbers)
+ * @param cmd Command object
+ * @param key Parameter key
+ * @param default_value Value returned when the key is missing
+ * @return 1 or 0
+ */
+int ipc_command_get_bool(const ipc_command_t* cmd, const char* key, int default_value);
+
+/**
+ * Decode a base64 string parameter into the command's arena
+ * @param cmd Command object (must own an arena)
+ * @param key Parameter key
+ * @param length Output for the decoded length
+ * @return Decoded bytes valid until the command is released, or NULL if missing or invalid
+ */
+const unsigned char* ipc_command_get_base64(const ipc_command_t* cmd, const char* key, size_t* length);
+
+/**
+ * Decode base64 (standard or URL-safe alphabet, padding optional)
+ * @param input Encoded text
+ * @param length Length of the text
+ * @param output Buffer of at least (length / 4 + 1) * 3 bytes
+ * @return Decoded length, or (size_t)-1 if the text is not valid base64
+ */
+size_t ipc_base64_decode(const char* input, size_t length, unsigned char* output);
+
+/**
+ * Route cJSON's allocations through command arenas. cJSON's allocator is
+ * process-wide, so this replaces it for every user of cJSON in the process:
+ * call it once at startup, before any thread parses or builds JSON, and
+ * before parsing into an arena (ipc_command_parse_in, ipc_command_pool_parse).
+ * Outside such a parse, cJSON uses malloc and free as usual. Trees parsed
+ * into an arena must never be passed to cJSON_Delete; ipc_command_release
+ * drops them and resetting the arena frees them. Calling it again is a no-op.
+ */
+void ipc_init(void);
+
+// Transport functions
+/**
+ * Select the transport framing requested by the parent process
+ * (TRONBUN_IPC_FRAMING=length) and switch stdin/stdout to it
+ * @return Framing mode now in effect
+ */
+ipc_framing_t ipc_framing_init_from_env(void);
+
+/**
+ * Set the transport framing used by the read and write functions
+ * @param framing Framing mode
+ */
+void ipc_set_framing(ipc_framing_t framing);
+
+/**
+ * Get the transport framing currently in effect
+ * @return Framing mode
+ */
+ipc_framing_t ipc_get_framing(void);
+
+/**
+ * Read one message into a reusable buffer
+ * @param reader Reader owning the buffer
+ * @param stream Input stream (usually stdin)
+ * @param length Output for the payload length (may be NULL)
+ * @return NUL-terminated payload valid until the next call, or NULL on EOF/error
+ */
+const char* ipc_reader_next(ipc_reader_t* reader, FILE* stream, size_t* length);
+
+/**
+ * Initialize a reader with no buffer
+ * @param reader Reader to initialize
+ */
+void ipc_reader_init(ipc_reader_t* reader);
+
+/**
+ * Free a reader's buffer
+ * @param reader Reader to destroy
+ */
+void ipc_reader_destroy(ipc_reader_t* reader);
+
+/**
+ * Move the attachment of the last message read into a parsed command. The
+ * reader gives up its buffer, so the bytes are not copied; the next read
+ * allocates a new one. Call after parsing, from the reading thread.
+ * @param reader Reader that read the command
+ * @param cmd Parsed command; frees the attachment on release
+ * @return 1 if an attachment was moved, 0 if the message had none
+ */
+int ipc_reader_detach_attachment(ipc_reader_t* reader, ipc_command_t* cmd);
+
+/**
+ * Read one message (a line or a frame) of any size
+ * @param stream Input stream (usually stdin)
+ * @param length Output for the payload length (may be NULL)
+ * @return Heap-allocated NUL-terminated payload (caller frees), or NULL on EOF/error
+ */
+char* ipc_read_message(FILE* stream, size_t* length);
+
+/**
+ * Start building one outgoing message in a writer (no allocation below 1 KB)
+ * @param writer Writer, usually on the stack
+ */
+void ipc_json_writer_begin(ipc_json_writer_t* writer);
+
+/**
+ * Append JSON text as-is
+ * @param writer Writer
+ * @param json NUL-terminated JSON text
+ */
+void ipc_json_writer_append(ipc_json_writer_t* writer, const char* json);
+
+/**
+ * Append JSON text of known length as-is
+ * @param writer Writer
+ * @param json JSON text
+ * @param length Length in bytes
+ */
+void ipc_json_writer_append_n(ipc_json_writer_t* writer, const char* json, size_t length);
+
+/**
+ * Append a quoted, escaped JSON string (clean runs are copied 8 bytes at a time)
+ * @param writer Writer
+ * @param text UTF-8 text, or NULL for null
+ */
+void ipc_json_writer_string(ipc_json_writer_t* writer, const char* text);
+
+/**
+ * Frame the message, write it to stdout with a single write(2) and release the writer
+ * @param writer Writer
+ * @return 1 on success, 0 on failure
+ */
+int ipc_json_writer_send(ipc_json_writer_t* writer);
+
+/**
+ * Send the message as a binary frame with raw bytes attached, then release
+ * the writer. Needs length framing; the JSON and the bytes are written
+ * back to back under the write lock, without encoding or copying the bytes.
+ * @param writer Writer
+ * @param data Attachment bytes
+ * @param length Attachment length
+ * @return 1 on success, 0 on failure or under line framing
+ */
+int ipc_json_writer_send_binary(ipc_json_writer_t* writer, const void* data, size_t length);
+
+/**
+ * Write one complete message to stdout using the current framing
+ * @param message JSON payload (without trailing newline)
+ * @param length Payload length in bytes
+ */
+void ipc_write_message(const char* message, size_t length);
+
+/**
+ * Format and write one complete message to stdout using the current framing.
+ * Arguments are not escaped; prefer ipc_json_writer_t for caller strings.
+ * @param format printf-style format for the JSON payload
+ */
+void ipc_write_messagef(const char* format, ...);
+
+/**
+ * Announce the framing in effect to the parent process (first message sent)
+ */
+void ipc_write_ready(void);
+
 // Response writing functions
 /**
  * Write a JSON response to stdout
@@ -136,16 +601,290 @@ void ipc_write_json_response(const char* id, const char* json_result, const char
  */
 void ipc_write_event(const char* event_type, const char* data);
 
+/**
+ * Write an event whose data is a single string field, escaped
+ * @param event_type Event type string
+ * @param key Field name
+ * @param value Field value
+ */
+void ipc_write_event_string(const char* event_type, const char* key, const char* value);
+
+// Timing utilities
+/**
+ * Monotonic clock in milliseconds
+ * @return Milliseconds since an arbitrary fixed point
+ */
+long long ipc_now_ms(void);
+
+/**
+ * Monotonic clock in microseconds
+ * @return Microseconds since an arbitrary fixed point
+ */
+long long ipc_now_us(void);
+
+/**
+ * Wait on a condition variable for at most timeout_ms (mutex must be held)
+ * @param cond Condition variable
+ * @param mutex Locked mutex
+ * @param timeout_ms Timeout in milliseconds (negative waits forever)
+ * @return 1 if woken, 0 if the timeout expired
+ */
+int ipc_cond_wait_ms(ipc_cond_t* cond, ipc_mutex_t* mutex, long long timeout_ms);
+
+// Completion utilities
+/**
+ * Initialize a completion
+ * @param completion Completion to initialize
+ */
+void ipc_completion_init(ipc_completion_t* completion);
+
+/**
+ * Destroy a completion
+ * @param completion Completion to destroy
+ */
+void ipc_completion_destroy(ipc_completion_t* completion);
+
+/**
+ * Signal that the work guarded by a completion has finished and wake the waiter
+ * @param completion Completion to signal
+ * @return 1 if the waiter already gave up (caller now owns cleanup), 0 otherwise
+ */
+int ipc_completion_signal(ipc_completion_t* completion);
+
+/**
+ * Block until a completion is signalled or the timeout expires.
+ * On timeout the completion is marked abandoned, and ownership of the
+ * guarded object passes to whoever signals it.
+ * @param completion Completion to wait on
+ * @param timeout_ms Timeout in milliseconds (negative waits forever)
+ * @return 1 if completed, 0 if timed out
+ */
+int ipc_completion_wait(ipc_completion_t* completion, int timeout_ms);
+
+// Arena and command pool utilities
+/**
+ * Initialize an empty arena
+ * @param arena Arena to initialize
+ */
+void ipc_arena_init(ipc_arena_t* arena);
+
+/**
+ * Allocate from an arena (16-byte aligned, freed by ipc_arena_reset)
+ * @param arena Arena
+ * @param size Number of bytes
+ * @return Pointer to the memory, or NULL when out of memory
+ */
+void* ipc_arena_alloc(ipc_arena_t* arena, size_t size);
+
+/**
+ * Free everything allocated from an arena, keeping one block for reuse
+ * @param arena Arena
+ */
+void ipc_arena_reset(ipc_arena_t* arena);
+
+/**
+ * Free all blocks of an arena
+ * @param arena Arena
+ */
+void ipc_arena_destroy(ipc_arena_t* arena);
+
+/**
+ * Initialize a command pool (ipc_init must have been called)
+ * @param pool Pool to initialize
+ * @param max_free Command objects kept on the freelist
+ */
+void ipc_command_pool_init(ipc_command_pool_t* pool, int max_free);
+
+/**
+ * Free every command object on the freelist
+ * @param pool Pool to destroy
+ */
+void ipc_command_pool_destroy(ipc_command_pool_t* pool);
+
+/**
+ * Take a command object from the freelist, allocating only when it is empty
+ * @param pool Pool
+ * @param context Owner context stored in the object
+ * @return Command object, or NULL when out of memory
+ */
+ipc_pooled_command_t* ipc_command_pool_acquire(ipc_command_pool_t* pool, void* context);
+
+/**
+ * Parse a JSON command into a pooled object's arena
+ * @param cmd Pooled command object
+ * @param json JSON command string
+ * @return 1 on success, 0 on failure (cmd->command.id is still set)
+ */
+int ipc_command_pool_parse(ipc_pooled_command_t* cmd, const char* json);
+
+/**
+ * Forward one param of one method as raw text: ipc_command_pool_parse keeps
+ * its bytes untouched (see ipc_command_get_raw_param) and never builds a tree for it
+ * @param pool Pool
+ * @param method Method name (static string)
+ * @param key Param name (static string)
+ */
+void ipc_command_pool_set_passthrough(ipc_command_pool_t* pool, const char* method, const char* key);
+
+/**
+ * Release a command, reset its arena and return it to the freelist
+ * @param cmd Pooled command object
+ */
+void ipc_command_pool_release(ipc_pooled_command_t* cmd);
+
+// Batch utilities
+/**
+ * Run the sub-commands of a batch in order and write one response whose
+ * result is an array of {"result":...} / {"error":...} objects.
+ * Params: commands (array of {method, params}), stop_on_error (default true).
+ * After a failure with stop_on_error, the remaining entries are skipped.
+ * @param batch Batch command
+ * @param run Runner used for each sub-command (responses are captured)
+ * @param target Target passed to the runner
+ */
+void ipc_run_batch(const ipc_command_t* batch, ipc_command_runner_t run, void* target);
+
+// Method table utilities
+/**
+ * Build the perfect hash for a method table
+ * @param table Table to initialize
+ * @param methods Method entries (kept by reference, metrics are updated in place)
+ * @param count Number of entries
+ * @return 1 on success, 0 on failure (duplicate names or out of memory)
+ */
+int ipc_method_table_init(ipc_method_table_t* table, ipc_method_t* methods, int count);
+
+/**
+ * Free the hash slots of a method table
+ * @param table Table to destroy
+ */
+void ipc_method_table_destroy(ipc_method_table_t* table);
+
+/**
+ * Look up a method by name in constant time
+ * @param table Method table
+ * @param name Method name
+ * @return Method entry or NULL if unknown
+ */
+ipc_method_t* ipc_method_table_lookup(const ipc_method_table_t* table, const char* name);
+
+/**
+ * Validate a command's params against a method schema
+ * @param method Method entry
+ * @param command Parsed command
+ * @param error Output buffer for the error message
+ * @param error_len Size of the error buffer
+ * @return 1 if valid, 0 otherwise
+ */
+int ipc_method_validate(const ipc_method_t* method, const ipc_command_t* command, char* error, size_t error_len);
+
+/**
+ * Look up, validate and run a command, recording per-method metrics.
+ * Invalid params are answered with an error response here; unknown
+ * methods are left to the caller.
+ * @param table Method table
+ * @param target Target object passed to the handler
+ * @param command Parsed command
+ * @param status Output for the handler's return value (may be NULL)
+ * @return Dispatch outcome
+ */
+ipc_dispatch_result_t ipc_method_table_dispatch(ipc_method_table_t* table, void* target, const ipc_command_t* command, int* status);
+
+/**
+ * Serialize per-method metrics as a JSON object keyed by method name
+ * @param table Method table
+ * @return Heap-allocated JSON string (caller frees), or NULL
+ */
+char* ipc_method_table_metrics_json(const ipc_method_table_t* table);
+
+// Pipelined execution utilities
+/**
+ * Initialize a command pipeline
+ * @param pipeline Pipeline to initialize
+ * @param window Maximum number of commands in flight (at least 1)
+ * @param default_deadline_ms Deadline for commands that don't carry their own
+ */
+void ipc_pipeline_init(ipc_pipeline_t* pipeline, int window, int default_deadline_ms);
+
+/**
+ * Initialize a command pipeline from TRONBUN_IPC_MAX_INFLIGHT and
+ * TRONBUN_IPC_DEADLINE_MS (defaults: serial execution, 1 s deadline)
+ * @param pipeline Pipeline to initialize
+ */
+void ipc_pipeline_init_from_env(ipc_pipeline_t* pipeline);
+
+/**
+ * Destroy a command pipeline (no thread may still be using it)
+ * @param pipeline Pipeline to destroy
+ */
+void ipc_pipeline_destroy(ipc_pipeline_t* pipeline);
+
+/**
+ * Register a command, blocking while the in-flight window is full
+ * @param pipeline Pipeline
+ * @param entry Entry embedded in the command's dispatch structure
+ * @param id Command ID reported if the deadline passes
+ * @param deadline_ms Deadline in milliseconds (0 uses the pipeline default)
+ * @return 1 if registered, 0 if the pipeline is shutting down
+ */
+int ipc_pipeline_submit(ipc_pipeline_t* pipeline, ipc_pipeline_entry_t* entry, const char* id, int deadline_ms);
+
+/**
+ * Mark a command as started (called on the executing thread)
+ * @param pipeline Pipeline
+ * @param entry Command entry
+ * @return 1 if the command should run, 0 if it already expired
+ *         (the entry is then unregistered, its slot freed, and the caller frees it)
+ */
+int ipc_pipeline_begin(ipc_pipeline_t* pipeline, ipc_pipeline_entry_t* entry);
+
+/**
+ * Unregister a finished command and free its window slot
+ * @param pipeline Pipeline
+ * @param entry Command entry
+ */
+void ipc_pipeline_end(ipc_pipeline_t* pipeline, ipc_pipeline_entry_t* entry);
+
+/**
+ * Expire pending commands whose deadline has passed, writing a
+ * "Command deadline exceeded" error under each command's own ID.
+ * Expired commands keep their window slot until ipc_pipeline_begin
+ * drops them, so the queue behind a stalled main thread stays bounded.
+ * @param pipeline Pipeline
+ * @return Milliseconds until the next pending deadline, or -1 if none
+ */
+long long ipc_pipeline_expire_due(ipc_pipeline_t* pipeline);
+
+/**
+ * Wake all waiters and refuse further submissions
+ * @param pipeline Pipeline
+ */
+void ipc_pipeline_shutdown(ipc_pipeline_t* pipeline);
+
+/**
+ * Watchdog thread enforcing pipeline deadlines until shutdown
+ * @param arg Pointer to an ipc_pipeline_t
+ * @return Thread return value
+ */
+THREAD_RETURN ipc_pipeline_watchdog_thread(THREAD_ARG arg);
+
 // Command dispatching utilities
 /**
  * Create a command dispatch structure for cross-thread execution
  * @param target Target object (webview, tray, etc.)
  * @param command JSON command string
  * @param executor Callback function to execute the command
- * @return Allocated dispatch structure (must be freed by executor)
+ * @return Allocated dispatch structure (released via ipc_execute_dispatch_sync)
  */
 ipc_command_dispatch_t* ipc_create_command_dispatch(void* target, const char* command, ipc_command_executor_t executor);
 
+/**
+ * Mark a dispatched command as finished (called by the executor)
+ * Frees the dispatch if the waiting thread already timed out on it.
+ * @param dispatch Command dispatch structure
+ */
+void ipc_complete_dispatch(ipc_command_dispatch_t* dispatch);
+
 /**
  * Execute a command dispatch synchronously with timeout
  * @param dispatch Command dispatch structure
@@ -0,0 +1,456 @@
+#include "tray_methods.h"
+
+#define MAX_MENU_ITEMS 100
+
+// Handler scratch memory: the command's arena, freed with the command, or the
+// heap for commands parsed without one (release with command_scratch_free)
+static void* command_scratch_alloc(const ipc_command_t* command, size_t size) {
+    return command->arena ? ipc_arena_alloc(command->arena, size) : malloc(size);
+}
+
+static void command_scratch_free(const ipc_command_t* command, void* data) {
+    if (!command->arena) free(data);
+}
+
+// Parse one menu item object; returns 0 if it is not an object
+static int parse_menu_item(const cJSON* menu_item, platform_menu_item_t* out) {
+    if (!menu_item || !cJSON_IsObject(menu_item)) return 0;
+    
+    // Initialize item
+    memset(out, 0, sizeof(platform_menu_item_t));
+    
+    // Extract id (required)
+    cJSON *id = cJSON_GetObjectItem(menu_item, "id");
+    if (id && cJSON_IsString(id)) {
+        strncpy(out->id, cJSON_GetStringValue(id), sizeof(out->id) - 1);
+        out->id[sizeof(out->id) - 1] = '\0';
+    }
+    
+    // Extract label (required)
+    cJSON *label = cJSON_GetObjectItem(menu_item, "label");
+    if (label && cJSON_IsString(label)) {
+        strncpy(out->label, cJSON_GetStringValue(label), sizeof(out->label) - 1);
+        out->label[sizeof(out->label) - 1] = '\0';
+    }
+    
+    // Extract type (default: normal)
+    cJSON *type = cJSON_GetObjectItem(menu_item, "type");
+    if (type && cJSON_IsString(type)) {
+        const char* type_str = cJSON_GetStringValue(type);
+        if (strcmp(type_str, "separator") == 0) {
+            out->type = 1;
+        } else if (strcmp(type_str, "checkbox") == 0) {
+            out->type = 2;
+        } else {
+            out->type = 0; // normal
+        }
+    } else {
+        out->type = 0; // normal
+    }
+    
+    // Extract enabled (default: true)
+    cJSON *enabled = cJSON_GetObjectItem(menu_item, "enabled");
+    if (enabled && cJSON_IsBool(enabled)) {
+        out->enabled = cJSON_IsTrue(enabled) ? 1 : 0;
+    } else {
+        out->enabled = 1; // default true
+    }
+    
+    // Extract checked (default: false)
+    cJSON *checked = cJSON_GetObjectItem(menu_item, "checked");
+    if (checked && cJSON_IsBool(checked)) {
+        out->checked = cJSON_IsTrue(checked) ? 1 : 0;
+    } else {
+        out->checked = 0; // default false
+    }
+    
+    // Extract accelerator (optional)
+    cJSON *accelerator = cJSON_GetObjectItem(menu_item, "accelerator");
+    if (accelerator && cJSON_IsString(accelerator)) {
+        strncpy(out->accelerator, cJSON_GetStringValue(accelerator), sizeof(out->accelerator) - 1);
+        out->accelerator[sizeof(out->accelerator) - 1] = '\0';
+    }
+    
+    return 1;
+}
+
+// Parse menu items from the JSON array of an already parsed command
+static int parse_menu_items(const cJSON* menu_array, platform_menu_item_t* menu_items, int max_items) {
+    if (!menu_array || !cJSON_IsArray(menu_array)) {
+        return 0;
+    }
+    
+    int count = 0;
+    const cJSON* menu_item = NULL;
+    cJSON_ArrayForEach(menu_item, menu_array) {
+        if (count >= max_items) break;
+        if (parse_menu_item(menu_item, &menu_items[count])) {
+            count++;
+        }
+    }
+    
+    return count;
+}
+
+// Begin an event line; hosted trays name themselves so the host can route it
+static void tray_begin_event(ipc_json_writer_t* writer, const tray_context_t* context, const char* type) {
+    ipc_json_writer_begin(writer);
+    ipc_json_writer_append(writer, "{\"type\":");
+    ipc_json_writer_string(writer, type);
+    if (context->handle >= 0) {
+        char target[32];
+        snprintf(target, sizeof(target), ",\"target\":%d", context->handle);
+        ipc_json_writer_append(writer, target);
+    }
+    ipc_json_writer_append(writer, ",\"data\":{");
+}
+
+// Tray click callback
+static void tray_click_callback(void* userdata) {
+    (void)userdata; // Suppress unused parameter warning
+    fprintf(stderr, "[Tray] Tray icon clicked\n");
+    
+    // Note: Left-click now directly shows the menu in platform-specific code
+    // No need to send events to TypeScript since users can't add click handlers
+}
+
+// Menu click callback
+static void menu_click_callback(const char* menu_id, void* userdata) {
+    tray_context_t* context = (tray_context_t*)userdata;
+    fprintf(stderr, "[Tray] Menu item clicked: %s\n", menu_id);
+    
+    // Send menu click event to TypeScript
+    ipc_json_writer_t writer;
+    tray_begin_event(&writer, context, "menu_click");
+    ipc_json_writer_append(&writer, "\"menuId\":");
+    ipc_json_writer_string(&writer, menu_id);
+    ipc_json_writer_append(&writer, "}}");
+    ipc_json_writer_send(&writer);
+}
+
+// Notification outcome callback (may run on the notification worker thread)
+static void notification_callback(const char* notification_id, platform_notification_status_t status,
+                                  const char* error, void* userdata) {
+    tray_context_t* context = (tray_context_t*)userdata;
+    static const char* const status_names[] = {"shown", "failed", "replaced"};
+    
+    ipc_json_writer_t writer;
+    tray_begin_event(&writer, context, "notification");
+    ipc_json_writer_append(&writer, "\"id\":");
+    ipc_json_writer_string(&writer, notification_id);
+    ipc_json_writer_append(&writer, ",\"status\":");
+    ipc_json_writer_string(&writer, status_names[status]);
+    if (error) {
+        ipc_json_writer_append(&writer, ",\"error\":");
+        ipc_json_writer_string(&writer, error);
+    }
+    ipc_json_writer_append(&writer, "}}");
+    ipc_json_writer_send(&writer);
+}
+
+// Take one notification token; returns 0 when the rate limit is exhausted
+static int take_notification_token(notification_limit_t* limit) {
+    if (limit->burst <= 0) return 1;
+    
+    long long now = ipc_now_ms();
+    long long refill = (now - limit->refilled_ms) / limit->interval_ms;
+    if (refill > 0) {
+        limit->tokens = refill >= limit->burst ? limit->burst : limit->tokens + (int)refill;
+        if (limit->tokens > limit->burst) limit->tokens = limit->burst;
+        limit->refilled_ms += refill * limit->interval_ms;
+    }
+    
+    if (limit->tokens == 0) return 0;
+    limit->tokens--;
+    return 1;
+}
+
+// Tray method handlers
+static int method_tray_set_icon(void* target, const ipc_command_t* command) {
+    tray_context_t* context = (tray_context_t*)target;
+    const char* icon_path = ipc_command_get_string(command, "icon", "");
+    int result = platform_tray_set_icon(context->tray, icon_path);
+    if (result != 0) {
+        fprintf(stderr, "[Tray] Failed to load icon from path: %s, using default\n", icon_path);
+    }
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static int method_tray_set_icon_data(void* target, const ipc_command_t* command) {
+    tray_context_t* context = (tray_context_t*)target;
+    size_t length = 0;
+    const unsigned char* data = ipc_command_get_base64(command, "data", &length);
+    if (!data || length == 0) {
+        ipc_write_response(command->id, NULL, "Invalid base64 icon data");
+        return -1;
+    }
+    
+    int result = platform_tray_set_icon_data(context->tray, data, length);
+    if (result != 0) {
+        ipc_write_response(command->id, NULL, "Failed to decode icon data");
+        return result;
+    }
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static int method_tray_set_animation(void* target, const ipc_command_t* command) {
+    tray_context_t* context = (tray_context_t*)target;
+    const cJSON* frames = ipc_command_get_param(command, "frames");
+    int count = cJSON_GetArraySize(frames);
+    int interval_ms = ipc_command_get_int(command, "interval_ms", 100);
+    
+    // Frame list is scratch memory; the platform decodes the frames before returning
+    const char** frame_paths = count > 0
+        ? (const char**)command_scratch_alloc(command, sizeof(const char*) * (size_t)count)
+        : NULL;
+    int frame_count = 0;
+    const cJSON* frame = NULL;
+    cJSON_ArrayForEach(frame, frames) {
+        if (!frame_paths || !cJSON_IsString(frame)) break;
+        frame_paths[frame_count++] = cJSON_GetStringValue(frame);
+    }
+    
+    if (frame_count == 0 || frame_count != count || interval_ms <= 0) {
+        command_scratch_free(command, frame_paths);
+        ipc_write_response(command->id, NULL, "Animation needs frame paths and a positive interval_ms");
+        return -1;
+    }
+    
+    int result = platform_tray_set_animation(context->tray, frame_paths, frame_count, interval_ms);
+    command_scratch_free(command, frame_paths);
+    if (result != 0) {
+        ipc_write_response(command->id, NULL, "Failed to load animation frames");
+        return result;
+    }
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static int method_tray_stop_animation(void* target, const ipc_command_t* command) {
+    tray_context_t* context = (tray_context_t*)target;
+    platform_tray_stop_animation(context->tray);
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static int method_tray_set_tooltip(void* target, const ipc_command_t* command) {
+    tray_context_t* context = (tray_context_t*)target;
+    int result = platform_tray_set_tooltip(context->tray, ipc_command_get_string(command, "tooltip", ""));
+    ipc_write_response(command->id, result == 0 ? "true" : "false", NULL);
+    return result;
+}
+
+static int method_tray_set_menu(void* target, const ipc_command_t* command) {
+    tray_context_t* context = (tray_context_t*)target;
+    const cJSON* menu = ipc_command_get_param(command, "menu");
+    int max_items = cJSON_GetArraySize(menu);
+    if (max_items > MAX_MENU_ITEMS) max_items = MAX_MENU_ITEMS;
+    
+    // Sized to the menu
+    platform_menu_item_t* menu_items = max_items > 0
+        ? (platform_menu_item_t*)command_scratch_alloc(command, sizeof(platform_menu_item_t) * (size_t)max_items)
+        : NULL;
+    int menu_count = menu_items ? parse_menu_items(menu, menu_items, max_items) : 0;
+    
+    if (menu_count == 0) {
+        command_scratch_free(command, menu_items);
+        ipc_write_response(command->id, NULL, "Invalid menu format");
+        return -1;
+    }
+    
+    int result = platform_tray_set_menu(context->tray, menu_items, menu_count);
+    command_scratch_free(command, menu_items);
+    ipc_write_response(command->id, result == 0 ? "true" : "false", NULL);
+    return result;
+}
+
+static int method_tray_update_item(void* target, const ipc_command_t* command) {
+    tray_context_t* context = (tray_context_t*)target;
+    platform_menu_item_t item;
+    if (!parse_menu_item(ipc_command_get_param(command, "item"), &item) || item.id[0] == '\0') {
+        ipc_write_response(command->id, NULL, "Invalid menu item format");
+        return -1;
+    }
+    
+    int result = platform_tray_update_item(context->tray, &item);
+    if (result != 0) {
+        ipc_write_response(command->id, NULL, "Unknown menu item id");
+        return result;
+    }
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static int method_tray_insert_item(void* target, const ipc_command_t* command) {
+    tray_context_t* context = (tray_context_t*)target;
+    platform_menu_item_t item;
+    if (!parse_menu_item(ipc_command_get_param(command, "item"), &item) || item.id[0] == '\0') {
+        ipc_write_response(command->id, NULL, "Invalid menu item format");
+        return -1;
+    }
+    
+    int position = ipc_command_get_int(command, "position", -1);
+    int result = platform_tray_insert_item(context->tray, &item, position);
+    ipc_write_response(command->id, result == 0 ? "true" : "false", NULL);
+    return result;
+}
+
+static int method_tray_remove_item(void* target, const ipc_command_t* command) {
+    tray_context_t* context = (tray_context_t*)target;
+    int result = platform_tray_remove_item(context->tray, ipc_command_get_string(command, "id", ""));
+    if (result != 0) {
+        ipc_write_response(command->id, NULL, "Unknown menu item id");
+        return result;
+    }
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+// Queues the notification; the outcome arrives later as a "notification" event
+static int method_tray_show_notification(void* target, const ipc_command_t* command) {
+    tray_context_t* context = (tray_context_t*)target;
+    if (!take_notification_token(&context->notification_limit)) {
+        ipc_write_response(command->id, NULL, "Notification rate limit exceeded");
+        return -1;
+    }
+    
+    const char* title = ipc_command_get_string(command, "title", "");
+    const char* body = ipc_command_get_string(command, "body", "");
+    const char* tag = ipc_command_get_string(command, "tag", NULL);
+    const char* notification_id = ipc_command_get_string(command, "notification_id", command->id);
+    int result = platform_tray_post_notification(context->tray, notification_id, tag, title, body);
+    ipc_write_response(command->id, result == 0 ? "true" : "false", NULL);
+    return result;
+}
+
+static int method_tray_configure_notifications(void* target, const ipc_command_t* command) {
+    tray_context_t* context = (tray_context_t*)target;
+    int burst = ipc_command_get_int(command, "burst", 0);
+    int interval_ms = ipc_command_get_int(command, "interval_ms", 1000);
+    if (burst < 0 || interval_ms <= 0) {
+        ipc_write_response(command->id, NULL, "burst must be >= 0 and interval_ms > 0");
+        return -1;
+    }
+    
+    context->notification_limit.burst = burst;
+    context->notification_limit.interval_ms = interval_ms;
+    context->notification_limit.tokens = burst;
+    context->notification_limit.refilled_ms = ipc_now_ms();
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static int method_tray_destroy(void* target, const ipc_command_t* command) {
+    tray_context_t* context = (tray_context_t*)target;
+    platform_tray_destroy(context->tray);
+    context->tray = NULL;
+    context->base.should_exit = 1;  // The owner stops its loop or frees the tray
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static int method_tray_get_metrics(void* target, const ipc_command_t* command);
+static int method_tray_batch(void* target, const ipc_command_t* command);
+
+// Param schemas
+static const ipc_param_spec_t tray_icon_params[] = {{"icon", IPC_PARAM_STRING, 1}, {NULL, IPC_PARAM_ANY, 0}};
+static const ipc_param_spec_t tray_icon_data_params[] = {{"data", IPC_PARAM_STRING, 1}, {NULL, IPC_PARAM_ANY, 0}};
+static const ipc_param_spec_t tray_animation_params[] = {
+    {"frames", IPC_PARAM_ARRAY, 1}, {"interval_ms", IPC_PARAM_NUMBER, 0},
+    {NULL, IPC_PARAM_ANY, 0}
+};
+static const ipc_param_spec_t tray_tooltip_params[] = {{"tooltip", IPC_PARAM_STRING, 0}, {NULL, IPC_PARAM_ANY, 0}};
+static const ipc_param_spec_t tray_menu_params[] = {{"menu", IPC_PARAM_ARRAY, 1}, {NULL, IPC_PARAM_ANY, 0}};
+static const ipc_param_spec_t tray_batch_params[] = {
+    {"commands", IPC_PARAM_ARRAY, 1}, {"stop_on_error", IPC_PARAM_BOOL, 0},
+    {NULL, IPC_PARAM_ANY, 0}
+};
+static const ipc_param_spec_t tray_item_params[] = {{"item", IPC_PARAM_OBJECT, 1}, {NULL, IPC_PARAM_ANY, 0}};
+static const ipc_param_spec_t tray_insert_item_params[] = {
+    {"item", IPC_PARAM_OBJECT, 1}, {"position", IPC_PARAM_NUMBER, 0},
+    {NULL, IPC_PARAM_ANY, 0}
+};
+static const ipc_param_spec_t tray_remove_item_params[] = {{"id", IPC_PARAM_STRING, 1}, {NULL, IPC_PARAM_ANY, 0}};
+static const ipc_param_spec_t tray_notification_params[] = {
+    {"title", IPC_PARAM_STRING, 0}, {"body", IPC_PARAM_STRING, 0},
+    {"tag", IPC_PARAM_STRING, 0}, {"notification_id", IPC_PARAM_STRING, 0},
+    {NULL, IPC_PARAM_ANY, 0}
+};
+static const ipc_param_spec_t tray_notification_limit_params[] = {
+    {"burst", IPC_PARAM_NUMBER, 0}, {"interval_ms", IPC_PARAM_NUMBER, 0},
+    {NULL, IPC_PARAM_ANY, 0}
+};
+
+// Every tray method is registered here, and only here
+static ipc_method_t g_tray_methods[] = {
+    {"tray_set_icon",          method_tray_set_icon,          tray_icon_params,         0, 0, 0, 0},
+    {"tray_set_icon_data",     method_tray_set_icon_data,     tray_icon_data_params,    0, 0, 0, 0},
+    {"tray_set_animation",     method_tray_set_animation,     tray_animation_params,    0, 0, 0, 0},
+    {"tray_stop_animation",    method_tray_stop_animation,    NULL,                     0, 0, 0, 0},
+    {"tray_set_tooltip",       method_tray_set_tooltip,       tray_tooltip_params,      0, 0, 0, 0},
+    {"tray_set_menu",          method_tray_set_menu,          tray_menu_params,         0, 0, 0, 0},
+    {"tray_update_item",       method_tray_update_item,       tray_item_params,         0, 0, 0, 0},
+    {"tray_insert_item",       method_tray_insert_item,       tray_insert_item_params,  0, 0, 0, 0},
+    {"tray_remove_item",       method_tray_remove_item,       tray_remove_item_params,  0, 0, 0, 0},
+    {"tray_show_notification", method_tray_show_notification, tray_notification_params, 0, 0, 0, 0},
+    {"tray_configure_notifications", method_tray_configure_notifications, tray_notification_limit_params, 0, 0, 0, 0},
+    {"tray_destroy",           method_tray_destroy,           NULL,                     0, 0, 0, 0},
+    {"tray_get_metrics",       method_tray_get_metrics,       NULL,                     0, 0, 0, 0},
+    {"batch",                  method_tray_batch,             tray_batch_params,        0, 0, 0, 0},
+};
+
+static ipc_method_table_t g_tray_method_table;
+
+static int method_tray_get_metrics(void* target, const ipc_command_t* command) {
+    (void)target;
+    char* metrics = ipc_method_table_metrics_json(&g_tray_method_table);
+    ipc_write_json_response(command->id, metrics ? metrics : "{}", NULL);
+    free(metrics);
+    return 0;
+}
+
+// Run one command through the method table
+void tray_run_method(void* target, const ipc_command_t* command) {
+    if (ipc_method_table_dispatch(&g_tray_method_table, target, command, NULL) == IPC_DISPATCH_UNKNOWN_METHOD) {
+        ipc_write_response(command->id, NULL, "Unknown tray method");
+    }
+}
+
+// Menu diffs arrive as one batch of item commands
+static int method_tray_batch(void* target, const ipc_command_t* command) {
+    ipc_run_batch(command, tray_run_method, target);
+    return 0;
+}
+
+int tray_methods_init(void) {
+    return ipc_method_table_init(&g_tray_method_table, g_tray_methods,
+                                 (int)(sizeof(g_tray_methods) / sizeof(g_tray_methods[0])));
+}
+
+tray_context_t* tray_context_create(int handle, const char* icon_path, const char* tooltip) {
+    tray_context_t* context = (tray_context_t*)calloc(1, sizeof(tray_context_t));
+    if (!context) return NULL;
+    context->handle = handle;
+    context->notification_limit.interval_ms = 1000;
+    
+    context->tray = platform_tray_create(icon_path, tooltip);
+    if (!context->tray) {
+        free(context);
+        return NULL;
+    }
+    
+    platform_tray_set_click_callback(context->tray, tray_click_callback, context);
+    platform_tray_set_menu_callback(context->tray, menu_click_callback, context);
+    platform_tray_set_notification_callback(context->tray, notification_callback, context);
+    return context;
+}
+
+void tray_context_free(tray_context_t* context) {
+    if (!context) return;
+    if (context->tray) {
+        platform_tray_destroy(context->tray);
+    }
+    free(context);
+}
@@ -0,0 +1,64 @@
+/*
+ * Tray IPC methods
+ *
+ * Method table and per-tray state shared by the standalone tray process
+ * and the multiplexed host, which owns several trays next to its webviews.
+ */
+
+#pragma once
+
+#include "ipc_common.h"
+#include "../platform/platform_tray.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Token bucket for notifications: up to burst at once, then one per interval_ms
+typedef struct {
+    int burst;        // 0 disables the limit
+    int interval_ms;
+    int tokens;
+    long long refilled_ms;
+} notification_limit_t;
+
+typedef struct {
+    ipc_base_context_t base;  // base.should_exit is set once tray_destroy ran
+    platform_tray_t* tray;
+    int handle;               // Host object handle, -1 in the standalone tray process
+    notification_limit_t notification_limit;
+} tray_context_t;
+
+/**
+ * Build the tray method table; call once before running any command
+ * @return 1 on success, 0 on failure
+ */
+int tray_methods_init(void);
+
+/**
+ * Create a tray icon with its callbacks wired to IPC events.
+ * Events carry "target" when handle is not -1.
+ * @param handle Host object handle, or -1
+ * @param icon_path Path to the icon file (NULL for the default icon)
+ * @param tooltip Initial tooltip text (can be NULL)
+ * @return Context or NULL on failure
+ */
+tray_context_t* tray_context_create(int handle, const char* icon_path, const char* tooltip);
+
+/**
+ * Destroy the tray icon, if still present, and free the context
+ * @param context Tray context
+ */
+void tray_context_free(tray_context_t* context);
+
+/**
+ * Run one command against a tray on the event loop thread.
+ * Unknown methods are answered with an error.
+ * @param target Tray context
+ * @param command Parsed command
+ */
+void tray_run_method(void* target, const ipc_command_t* command);
+
+#ifdef __cplusplus
+}
+#endif
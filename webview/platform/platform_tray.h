@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -24,6 +26,17 @@ typedef struct {
 
 typedef void (*platform_tray_click_callback_t)(void* userdata);
 typedef void (*platform_menu_click_callback_t)(const char* menu_id, void* userdata);
+typedef void (*platform_tray_task_t)(void* data);
+
+// Outcome of a posted notification
+typedef enum {
+    PLATFORM_NOTIFICATION_SHOWN = 0,
+    PLATFORM_NOTIFICATION_FAILED = 1,
+    PLATFORM_NOTIFICATION_REPLACED = 2  // a newer notification with the same tag superseded it
+} platform_notification_status_t;
+
+typedef void (*platform_notification_callback_t)(const char* notification_id, platform_notification_status_t status,
+                                                 const char* error, void* userdata);
 
 /**
  * Create a new tray icon
@@ -47,6 +60,32 @@ void platform_tray_destroy(platform_tray_t* tray);
  */
 int platform_tray_set_icon(platform_tray_t* tray, const char* icon_path);
 
+/**
+ * Set the tray icon from encoded image bytes (PNG)
+ * @param tray Tray handle
+ * @param data Image bytes
+ * @param length Number of bytes
+ * @return 0 on success, -1 if the image cannot be decoded
+ */
+int platform_tray_set_icon_data(platform_tray_t* tray, const unsigned char* data, size_t length);
+
+/**
+ * Cycle the tray icon through frames on a native timer until stopped.
+ * All frames are decoded before the animation starts; setting an icon stops it.
+ * @param tray Tray handle
+ * @param frame_paths Paths of the frame images
+ * @param count Number of frames
+ * @param interval_ms Time each frame is shown
+ * @return 0 on success, -1 if a frame cannot be loaded
+ */
+int platform_tray_set_animation(platform_tray_t* tray, const char* const* frame_paths, int count, int interval_ms);
+
+/**
+ * Stop the running animation and restore the icon shown before it
+ * @param tray Tray handle
+ */
+void platform_tray_stop_animation(platform_tray_t* tray);
+
 /**
  * Set the tray tooltip
  * @param tray Tray handle
@@ -64,6 +103,31 @@ int platform_tray_set_tooltip(platform_tray_t* tray, const char* tooltip);
  */
 int platform_tray_set_menu(platform_tray_t* tray, const platform_menu_item_t* menu_items, int count);
 
+/**
+ * Update one menu item in place; a type change replaces it at the same position
+ * @param tray Tray handle
+ * @param item New item state, looked up by item->id
+ * @return 0 on success, -1 if no item has that id
+ */
+int platform_tray_update_item(platform_tray_t* tray, const platform_menu_item_t* item);
+
+/**
+ * Insert one menu item, creating the menu if there is none
+ * @param tray Tray handle
+ * @param item Item to insert (its id must not already be in the menu)
+ * @param position Index to insert at, or -1 to append
+ * @return 0 on success, -1 on failure
+ */
+int platform_tray_insert_item(platform_tray_t* tray, const platform_menu_item_t* item, int position);
+
+/**
+ * Remove one menu item
+ * @param tray Tray handle
+ * @param id Menu item id
+ * @return 0 on success, -1 if no item has that id
+ */
+int platform_tray_remove_item(platform_tray_t* tray, const char* id);
+
 /**
  * Set click callback for tray icon
  * @param tray Tray handle
@@ -90,11 +154,55 @@ void platform_tray_set_menu_callback(platform_tray_t* tray, platform_menu_click_
 int platform_tray_show_notification(platform_tray_t* tray, const char* title, const char* body);
 
 /**
- * Run the platform-specific event loop for the tray
- * @param context IPC context for exit condition
+ * Set the callback that reports the outcome of posted notifications.
+ * It may run on a worker thread.
+ * @param tray Tray handle
+ * @param callback Callback function
+ * @param userdata User data passed to callback
+ */
+void platform_tray_set_notification_callback(platform_tray_t* tray, platform_notification_callback_t callback, void* userdata);
+
+/**
+ * Queue a notification without blocking; the outcome goes to the notification callback.
+ * Notifications sharing a tag replace each other, and queued ones are coalesced.
+ * @param tray Tray handle
+ * @param notification_id Id passed back to the callback
+ * @param tag Replacement tag, or NULL/empty for a standalone notification
+ * @param title Notification title
+ * @param body Notification body
+ * @return 0 if queued, -1 on failure
+ */
+int platform_tray_post_notification(platform_tray_t* tray, const char* notification_id, const char* tag,
+                                    const char* title, const char* body);
+
+/**
+ * Run the platform-specific event loop for the tray.
+ * Blocks in the native loop until platform_tray_quit_event_loop is called.
+ * @param context IPC context (unused, kept for API compatibility)
  */
 void platform_tray_run_event_loop(void* context);
 
+/**
+ * Prepare the calling thread's event loop without creating a tray, so a
+ * process that hosts windows as well can dispatch to it before any tray exists.
+ * platform_tray_create does this implicitly.
+ * @return 0 on success, -1 if the windowing system is unavailable
+ */
+int platform_tray_init_event_loop(void);
+
+/**
+ * Run a task on the event loop thread, in submission order
+ * Safe to call from any thread once the tray has been created.
+ * @param task Function to run
+ * @param data Argument passed to the task
+ */
+void platform_tray_dispatch(platform_tray_task_t task, void* data);
+
+/**
+ * Make platform_tray_run_event_loop return (safe to call from any thread)
+ */
+void platform_tray_quit_event_loop(void);
+
 /**
  * Check if tray icons are supported on this platform
  * @return 1 if supported, 0 if not
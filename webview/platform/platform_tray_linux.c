@@ -5,6 +5,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <glib/gstdio.h>
+
+// Decoded icons kept per tray; status apps cycle through a handful
+#define TRAY_ICON_CACHE_MAX 32
 
 typedef struct menu_item_data {
     char id[256];
@@ -12,15 +16,133 @@ typedef struct menu_item_data {
     void* userdata;
 } menu_item_data_t;
 
+// Notification state shared with the worker thread. The tray and every queued
+// job hold a reference, so a show still in flight when the tray is destroyed
+// finishes on its own and the last job frees the state.
+typedef struct {
+    gint refs;
+    GHashTable* notifications;    // tag -> NotifyNotification* (worker thread only)
+    GHashTable* latest;           // tag -> newest queued generation (under lock)
+    GPtrArray* pending;           // notification_job_t* not yet finished (under lock)
+    GMutex lock;
+    guint generation;
+    gboolean closing;             // Set on destroy: the tray reported every pending job (under lock)
+    platform_notification_callback_t callback;  // Called under lock
+    void* userdata;
+} notify_state_t;
+
 struct platform_tray {
     GtkStatusIcon* status_icon;
     GtkWidget* menu;
     platform_tray_click_callback_t click_callback;
     platform_menu_click_callback_t menu_callback;
     void* userdata;
-    GSList* menu_item_data_list;
+    GHashTable* menu_items; // id -> GtkWidget* (borrowed, owned by menu)
+    GHashTable* icon_cache; // path or content key -> icon_cache_entry_t*
+    GdkPixbuf* static_icon; // icon shown when not animating (NULL = themed default)
+    GPtrArray* animation_frames; // GdkPixbuf* frames, NULL when not animating
+    guint animation_source;
+    guint animation_index;
+    
+    // Notifications are shown on one worker thread so D-Bus never blocks the loop
+    GThreadPool* notify_pool;
+    notify_state_t* notify;
 };
 
+// One queued notification
+typedef struct {
+    char* id;
+    char* tag;
+    char* title;
+    char* body;
+    guint generation;
+    gboolean reported;  // Its event went out (under the state lock)
+} notification_job_t;
+
+// A decoded icon and the file state it was decoded from
+typedef struct {
+    GdkPixbuf* pixbuf;
+    gint64 mtime;
+    gint64 size;
+} icon_cache_entry_t;
+
+static void icon_cache_entry_free(gpointer data) {
+    icon_cache_entry_t* entry = (icon_cache_entry_t*)data;
+    g_object_unref(entry->pixbuf);
+    g_free(entry);
+}
+
+static void icon_cache_insert(platform_tray_t* tray, const char* key, GdkPixbuf* pixbuf, gint64 mtime, gint64 size) {
+    // Past the limit the working set has changed; start over rather than track age
+    if (g_hash_table_size(tray->icon_cache) >= TRAY_ICON_CACHE_MAX) {
+        g_hash_table_remove_all(tray->icon_cache);
+    }
+    
+    icon_cache_entry_t* entry = g_new(icon_cache_entry_t, 1);
+    entry->pixbuf = g_object_ref(pixbuf);
+    entry->mtime = mtime;
+    entry->size = size;
+    g_hash_table_replace(tray->icon_cache, g_strdup(key), entry);
+}
+
+// Decoded icon for a file, re-read only when its mtime or size changes (borrowed)
+static GdkPixbuf* icon_cache_load_file(platform_tray_t* tray, const char* path) {
+    GStatBuf st;
+    if (g_stat(path, &st) != 0) return NULL;
+    
+    icon_cache_entry_t* entry = (icon_cache_entry_t*)g_hash_table_lookup(tray->icon_cache, path);
+    if (entry && entry->mtime == (gint64)st.st_mtime && entry->size == (gint64)st.st_size) {
+        return entry->pixbuf;
+    }
+    
+    GError* error = NULL;
+    GdkPixbuf* pixbuf = gdk_pixbuf_new_from_file(path, &error);
+    if (!pixbuf) {
+        fprintf(stderr, "Failed to decode icon %s: %s\n", path, error ? error->message : "unknown error");
+        if (error) g_error_free(error);
+        return NULL;
+    }
+    
+    icon_cache_insert(tray, path, pixbuf, (gint64)st.st_mtime, (gint64)st.st_size);
+    g_object_unref(pixbuf);
+    return pixbuf;
+}
+
+// Decoded icon for in-memory image bytes, keyed by a hash of the content (borrowed)
+static GdkPixbuf* icon_cache_load_data(platform_tray_t* tray, const unsigned char* data, size_t length) {
+    guint64 hash = 14695981039346656037ULL; // FNV-1a
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ data[i]) * 1099511628211ULL;
+    }
+    char key[64];
+    snprintf(key, sizeof(key), "data:%016" G_GINT64_MODIFIER "x:%" G_GSIZE_FORMAT, hash, (gsize)length);
+    
+    icon_cache_entry_t* entry = (icon_cache_entry_t*)g_hash_table_lookup(tray->icon_cache, key);
+    if (entry && entry->size == (gint64)length) {
+        return entry->pixbuf;
+    }
+    
+    GError* error = NULL;
+    GdkPixbufLoader* loader = gdk_pixbuf_loader_new();
+    if (!gdk_pixbuf_loader_write(loader, data, length, &error) || !gdk_pixbuf_loader_close(loader, &error)) {
+        fprintf(stderr, "Failed to decode icon data: %s\n", error ? error->message : "unknown error");
+        if (error) g_error_free(error);
+        g_object_unref(loader);
+        return NULL;
+    }
+    
+    // The cache keeps its own reference once the loader is gone
+    GdkPixbuf* pixbuf = gdk_pixbuf_loader_get_pixbuf(loader);
+    if (pixbuf) {
+        icon_cache_insert(tray, key, pixbuf, 0, (gint64)length);
+    }
+    g_object_unref(loader);
+    return pixbuf;
+}
+
+// Key of the menu_item_data_t attached to (and freed with) each item widget
+#define MENU_ITEM_DATA_KEY "tronbun-menu-item"
+
 static void on_tray_icon_activate(GtkStatusIcon* status_icon, gpointer user_data) {
     // Left-click now shows the menu instead of calling custom handlers
     platform_tray_t* tray = (platform_tray_t*)user_data;
@@ -45,28 +167,154 @@ static void on_menu_item_activate(GtkMenuItem* menu_item, gpointer user_data) {
     }
 }
 
+static int menu_item_widget_type(GtkWidget* widget) {
+    if (GTK_IS_SEPARATOR_MENU_ITEM(widget)) return 1;
+    if (GTK_IS_CHECK_MENU_ITEM(widget)) return 2;
+    return 0;
+}
+
+// Build the widget for one item and register it under its id
+static GtkWidget* create_menu_item_widget(platform_tray_t* tray, const platform_menu_item_t* menu_item) {
+    GtkWidget* gtk_menu_item;
+    
+    if (menu_item->type == 1) { // separator
+        gtk_menu_item = gtk_separator_menu_item_new();
+    } else if (menu_item->type == 2) { // checkbox
+        gtk_menu_item = gtk_check_menu_item_new_with_label(menu_item->label);
+        gtk_check_menu_item_set_active(GTK_CHECK_MENU_ITEM(gtk_menu_item), menu_item->checked);
+    } else { // normal item
+        gtk_menu_item = gtk_menu_item_new_with_label(menu_item->label);
+    }
+    
+    gtk_widget_set_sensitive(gtk_menu_item, menu_item->enabled);
+    
+    if (menu_item->type != 1) { // not separator
+        // Item data lives as long as the widget
+        menu_item_data_t* data = (menu_item_data_t*)malloc(sizeof(menu_item_data_t));
+        strncpy(data->id, menu_item->id, sizeof(data->id) - 1);
+        data->id[sizeof(data->id) - 1] = '\0';
+        data->callback = tray->menu_callback;
+        data->userdata = tray->userdata;
+        g_object_set_data_full(G_OBJECT(gtk_menu_item), MENU_ITEM_DATA_KEY, data, free);
+        
+        g_signal_connect(G_OBJECT(gtk_menu_item), "activate", 
+                       G_CALLBACK(on_menu_item_activate), data);
+    }
+    
+    if (menu_item->id[0] != '\0') {
+        g_hash_table_replace(tray->menu_items, g_strdup(menu_item->id), gtk_menu_item);
+    }
+    
+    gtk_widget_show(gtk_menu_item);
+    return gtk_menu_item;
+}
+
+static void stop_animation(platform_tray_t* tray) {
+    if (tray->animation_source) {
+        g_source_remove(tray->animation_source);
+        tray->animation_source = 0;
+    }
+    if (tray->animation_frames) {
+        g_ptr_array_free(tray->animation_frames, TRUE);
+        tray->animation_frames = NULL;
+    }
+}
+
+// Show a still icon (NULL = themed default), ending any animation
+static void show_static_icon(platform_tray_t* tray, GdkPixbuf* icon) {
+    stop_animation(tray);
+    
+    if (icon) g_object_ref(icon);
+    if (tray->static_icon) g_object_unref(tray->static_icon);
+    tray->static_icon = icon;
+    
+    if (icon) {
+        gtk_status_icon_set_from_pixbuf(tray->status_icon, icon);
+    } else {
+        gtk_status_icon_set_from_icon_name(tray->status_icon, "application-default-icon");
+    }
+}
+
+static gboolean on_animation_tick(gpointer user_data) {
+    platform_tray_t* tray = (platform_tray_t*)user_data;
+    tray->animation_index = (tray->animation_index + 1) % tray->animation_frames->len;
+    gtk_status_icon_set_from_pixbuf(tray->status_icon,
+                                    (GdkPixbuf*)g_ptr_array_index(tray->animation_frames, tray->animation_index));
+    return G_SOURCE_CONTINUE;
+}
+
+// libnotify is process-global, while a native host holds several trays:
+// it is set up by the first live tray and torn down after the last one, so
+// destroying one of two hosted trays leaves the other able to notify.
+// Each notification state holds a use, and the last one may be dropped on
+// the worker thread, hence the lock.
+G_LOCK_DEFINE_STATIC(notify_users);
+static guint g_notify_users;
+
+static void notify_acquire(void) {
+    G_LOCK(notify_users);
+    g_notify_users++;
+    if (!notify_is_initted() && !notify_init("Tronbun")) {
+        fprintf(stderr, "Failed to initialize libnotify\n");
+    }
+    G_UNLOCK(notify_users);
+}
+
+static void notify_release(void) {
+    G_LOCK(notify_users);
+    if (g_notify_users > 0 && --g_notify_users == 0 && notify_is_initted()) {
+        notify_uninit();
+    }
+    G_UNLOCK(notify_users);
+}
+
+static notify_state_t* notify_state_new(void) {
+    notify_state_t* state = g_new0(notify_state_t, 1);
+    state->refs = 1;
+    state->notifications = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_object_unref);
+    state->latest = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    state->pending = g_ptr_array_new();
+    g_mutex_init(&state->lock);
+    notify_acquire();
+    return state;
+}
+
+static void notify_state_unref(notify_state_t* state) {
+    if (!g_atomic_int_dec_and_test(&state->refs)) return;
+    g_hash_table_destroy(state->notifications);
+    g_hash_table_destroy(state->latest);
+    g_ptr_array_free(state->pending, TRUE);
+    g_mutex_clear(&state->lock);
+    g_free(state);
+    notify_release();
+}
+
 platform_tray_t* platform_tray_create(const char* icon_path, const char* tooltip) {
     if (!gtk_init_check(0, NULL)) {
         fprintf(stderr, "Failed to initialize GTK\n");
         return NULL;
     }
     
-    // Initialize libnotify for notifications
-    if (!notify_init("Tronbun")) {
-        fprintf(stderr, "Failed to initialize libnotify\n");
-    }
-    
     platform_tray_t* tray = (platform_tray_t*)calloc(1, sizeof(platform_tray_t));
     if (!tray) return NULL;
+    tray->notify = notify_state_new();
+    tray->menu_items = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    tray->icon_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, icon_cache_entry_free);
     
     // Create status icon
-    if (icon_path) {
-        tray->status_icon = gtk_status_icon_new_from_file(icon_path);
+    GdkPixbuf* icon = icon_path ? icon_cache_load_file(tray, icon_path) : NULL;
+    if (icon) {
+        tray->status_icon = gtk_status_icon_new_from_pixbuf(icon);
+        tray->static_icon = g_object_ref(icon);
     } else {
         tray->status_icon = gtk_status_icon_new_from_icon_name("application-default-icon");
     }
     
     if (!tray->status_icon) {
+        if (tray->static_icon) g_object_unref(tray->static_icon);
+        g_hash_table_destroy(tray->icon_cache);
+        g_hash_table_destroy(tray->menu_items);
+        notify_state_unref(tray->notify);
         free(tray);
         return NULL;
     }
@@ -91,34 +339,94 @@ platform_tray_t* platform_tray_create(const char* icon_path, const char* tooltip
 void platform_tray_destroy(platform_tray_t* tray) {
     if (!tray) return;
     
-    // Destroy menu and free menu item data
+    // Destroy menu; item data is freed with each widget
     if (tray->menu) {
         gtk_widget_destroy(tray->menu);
     }
-    
-    GSList* item = tray->menu_item_data_list;
-    while (item) {
-        free(item->data);
-        item = item->next;
-    }
-    g_slist_free(tray->menu_item_data_list);
+    g_hash_table_destroy(tray->menu_items);
     
     // Destroy status icon
+    stop_animation(tray);
     if (tray->status_icon) {
         g_object_unref(tray->status_icon);
     }
+    if (tray->static_icon) {
+        g_object_unref(tray->static_icon);
+    }
+    g_hash_table_destroy(tray->icon_cache);
+    
+    // Every unfinished notification, including one in the middle of its D-Bus
+    // call, is reported as failed now, while the callback's userdata is alive.
+    // The worker then settles the rest on its own, without waiting here.
+    notify_state_t* state = tray->notify;
+    g_mutex_lock(&state->lock);
+    state->closing = TRUE;
+    for (guint i = 0; i < state->pending->len; i++) {
+        notification_job_t* job = (notification_job_t*)g_ptr_array_index(state->pending, i);
+        if (!job->reported && state->callback) {
+            state->callback(job->id, PLATFORM_NOTIFICATION_FAILED, "Tray destroyed", state->userdata);
+        }
+        job->reported = TRUE;
+    }
+    state->callback = NULL;
+    g_mutex_unlock(&state->lock);
+    if (tray->notify_pool) {
+        g_thread_pool_free(tray->notify_pool, FALSE, FALSE);
+    }
+    notify_state_unref(state);
     
-    notify_uninit();
     free(tray);
 }
 
 int platform_tray_set_icon(platform_tray_t* tray, const char* icon_path) {
     if (!tray || !icon_path) return -1;
     
-    gtk_status_icon_set_from_file(tray->status_icon, icon_path);
+    GdkPixbuf* icon = icon_cache_load_file(tray, icon_path);
+    show_static_icon(tray, icon);
+    return icon ? 0 : -1;
+}
+
+int platform_tray_set_icon_data(platform_tray_t* tray, const unsigned char* data, size_t length) {
+    if (!tray || !data || length == 0) return -1;
+    
+    GdkPixbuf* icon = icon_cache_load_data(tray, data, length);
+    if (!icon) return -1;
+    
+    show_static_icon(tray, icon);
     return 0;
 }
 
+int platform_tray_set_animation(platform_tray_t* tray, const char* const* frame_paths, int count, int interval_ms) {
+    if (!tray || !frame_paths || count <= 0 || interval_ms <= 0) return -1;
+    
+    // Decode every frame up front; ticks only swap pixbufs
+    GPtrArray* frames = g_ptr_array_new_full((guint)count, g_object_unref);
+    for (int i = 0; i < count; i++) {
+        GdkPixbuf* frame = icon_cache_load_file(tray, frame_paths[i]);
+        if (!frame) {
+            g_ptr_array_free(frames, TRUE);
+            return -1;
+        }
+        g_ptr_array_add(frames, g_object_ref(frame));
+    }
+    
+    stop_animation(tray);
+    tray->animation_frames = frames;
+    tray->animation_index = 0;
+    gtk_status_icon_set_from_pixbuf(tray->status_icon, (GdkPixbuf*)g_ptr_array_index(frames, 0));
+    
+    if (count > 1) {
+        tray->animation_source = g_timeout_add((guint)interval_ms, on_animation_tick, tray);
+    }
+    return 0;
+}
+
+void platform_tray_stop_animation(platform_tray_t* tray) {
+    if (!tray || !tray->animation_frames) return;
+    
+    show_static_icon(tray, tray->static_icon);
+}
+
 int platform_tray_set_tooltip(platform_tray_t* tray, const char* tooltip) {
     if (!tray || !tooltip) return -1;
     
@@ -129,58 +437,86 @@ int platform_tray_set_tooltip(platform_tray_t* tray, const char* tooltip) {
 int platform_tray_set_menu(platform_tray_t* tray, const platform_menu_item_t* menu_items, int count) {
     if (!tray || !menu_items || count <= 0) return -1;
     
-    // Destroy existing menu and data
+    // Destroy existing menu; item data is freed with each widget
     if (tray->menu) {
         gtk_widget_destroy(tray->menu);
     }
-    
-    GSList* item = tray->menu_item_data_list;
-    while (item) {
-        free(item->data);
-        item = item->next;
-    }
-    g_slist_free(tray->menu_item_data_list);
-    tray->menu_item_data_list = NULL;
+    g_hash_table_remove_all(tray->menu_items);
     
     // Create new menu
     tray->menu = gtk_menu_new();
     
     for (int i = 0; i < count; i++) {
-        const platform_menu_item_t* menu_item = &menu_items[i];
-        GtkWidget* gtk_menu_item;
-        
-        if (menu_item->type == 1) { // separator
-            gtk_menu_item = gtk_separator_menu_item_new();
-        } else if (menu_item->type == 2) { // checkbox
-            gtk_menu_item = gtk_check_menu_item_new_with_label(menu_item->label);
-            gtk_check_menu_item_set_active(GTK_CHECK_MENU_ITEM(gtk_menu_item), menu_item->checked);
-        } else { // normal item
-            gtk_menu_item = gtk_menu_item_new_with_label(menu_item->label);
-        }
-        
-        gtk_widget_set_sensitive(gtk_menu_item, menu_item->enabled);
+        gtk_menu_shell_append(GTK_MENU_SHELL(tray->menu), create_menu_item_widget(tray, &menu_items[i]));
+    }
+    
+    return 0;
+}
+
+int platform_tray_update_item(platform_tray_t* tray, const platform_menu_item_t* item) {
+    if (!tray || !item) return -1;
+    
+    GtkWidget* widget = (GtkWidget*)g_hash_table_lookup(tray->menu_items, item->id);
+    if (!widget) return -1;
+    
+    int wanted_type = (item->type == 1 || item->type == 2) ? item->type : 0;
+    if (menu_item_widget_type(widget) != wanted_type) {
+        // GTK cannot change an item's class, so swap in a new widget at the same position
+        GList* children = gtk_container_get_children(GTK_CONTAINER(tray->menu));
+        int position = g_list_index(children, widget);
+        g_list_free(children);
         
-        if (menu_item->type != 1) { // not separator
-            // Create menu item data
-            menu_item_data_t* data = (menu_item_data_t*)malloc(sizeof(menu_item_data_t));
-            strncpy(data->id, menu_item->id, sizeof(data->id) - 1);
-            data->id[sizeof(data->id) - 1] = '\0';
-            data->callback = tray->menu_callback;
-            data->userdata = tray->userdata;
-            
-            tray->menu_item_data_list = g_slist_append(tray->menu_item_data_list, data);
-            
-            g_signal_connect(G_OBJECT(gtk_menu_item), "activate", 
-                           G_CALLBACK(on_menu_item_activate), data);
+        g_hash_table_remove(tray->menu_items, item->id);
+        gtk_widget_destroy(widget);
+        gtk_menu_shell_insert(GTK_MENU_SHELL(tray->menu), create_menu_item_widget(tray, item), position);
+        return 0;
+    }
+    
+    if (item->type == 1) return 0; // separators have no state
+    
+    const char* label = gtk_menu_item_get_label(GTK_MENU_ITEM(widget));
+    if (!label || strcmp(label, item->label) != 0) {
+        gtk_menu_item_set_label(GTK_MENU_ITEM(widget), item->label);
+    }
+    gtk_widget_set_sensitive(widget, item->enabled);
+    
+    if (item->type == 2) {
+        GtkCheckMenuItem* check = GTK_CHECK_MENU_ITEM(widget);
+        if (gtk_check_menu_item_get_active(check) != (item->checked ? TRUE : FALSE)) {
+            // set_active emits "activate"; a state push is not a user click
+            gpointer data = g_object_get_data(G_OBJECT(widget), MENU_ITEM_DATA_KEY);
+            g_signal_handlers_block_by_func(widget, G_CALLBACK(on_menu_item_activate), data);
+            gtk_check_menu_item_set_active(check, item->checked);
+            g_signal_handlers_unblock_by_func(widget, G_CALLBACK(on_menu_item_activate), data);
         }
-        
-        gtk_menu_shell_append(GTK_MENU_SHELL(tray->menu), gtk_menu_item);
-        gtk_widget_show(gtk_menu_item);
     }
     
     return 0;
 }
 
+int platform_tray_insert_item(platform_tray_t* tray, const platform_menu_item_t* item, int position) {
+    if (!tray || !item) return -1;
+    if (item->id[0] != '\0' && g_hash_table_contains(tray->menu_items, item->id)) return -1;
+    
+    if (!tray->menu) {
+        tray->menu = gtk_menu_new();
+    }
+    
+    gtk_menu_shell_insert(GTK_MENU_SHELL(tray->menu), create_menu_item_widget(tray, item), position);
+    return 0;
+}
+
+int platform_tray_remove_item(platform_tray_t* tray, const char* id) {
+    if (!tray || !id) return -1;
+    
+    GtkWidget* widget = (GtkWidget*)g_hash_table_lookup(tray->menu_items, id);
+    if (!widget) return -1;
+    
+    g_hash_table_remove(tray->menu_items, id);
+    gtk_widget_destroy(widget);
+    return 0;
+}
+
 void platform_tray_set_click_callback(platform_tray_t* tray, platform_tray_click_callback_t callback, void* userdata) {
     if (!tray) return;
     
@@ -195,13 +531,135 @@ void platform_tray_set_menu_callback(platform_tray_t* tray, platform_menu_click_
     tray->userdata = userdata;
     
     // Update existing menu item callbacks
-    GSList* item = tray->menu_item_data_list;
-    while (item) {
-        menu_item_data_t* data = (menu_item_data_t*)item->data;
-        data->callback = callback;
-        data->userdata = userdata;
-        item = item->next;
+    if (tray->menu) {
+        GList* children = gtk_container_get_children(GTK_CONTAINER(tray->menu));
+        for (GList* child = children; child; child = child->next) {
+            menu_item_data_t* data = (menu_item_data_t*)g_object_get_data(G_OBJECT(child->data), MENU_ITEM_DATA_KEY);
+            if (data) {
+                data->callback = callback;
+                data->userdata = userdata;
+            }
+        }
+        g_list_free(children);
+    }
+}
+
+static void notification_job_free(notification_job_t* job) {
+    g_free(job->id);
+    g_free(job->tag);
+    g_free(job->title);
+    g_free(job->body);
+    g_free(job);
+}
+
+// Report a job once; after destroy the tray has already reported it
+static void report_notification(notify_state_t* state, notification_job_t* job,
+                                platform_notification_status_t status, const char* error) {
+    g_mutex_lock(&state->lock);
+    if (!job->reported && state->callback) {
+        state->callback(job->id, status, error, state->userdata);
+    }
+    job->reported = TRUE;
+    g_mutex_unlock(&state->lock);
+}
+
+static void finish_notification_job(notify_state_t* state, notification_job_t* job) {
+    g_mutex_lock(&state->lock);
+    g_ptr_array_remove_fast(state->pending, job);
+    g_mutex_unlock(&state->lock);
+    notification_job_free(job);
+    notify_state_unref(state);
+}
+
+// Runs on the notification worker thread
+static void run_notification_job(gpointer data, gpointer user_data) {
+    notification_job_t* job = (notification_job_t*)data;
+    notify_state_t* state = (notify_state_t*)user_data;
+    
+    // The tray is gone and reported the job: settle it without a D-Bus call
+    g_mutex_lock(&state->lock);
+    gboolean closing = state->closing;
+    guint latest = job->tag ? GPOINTER_TO_UINT(g_hash_table_lookup(state->latest, job->tag)) : 0;
+    g_mutex_unlock(&state->lock);
+    if (closing) {
+        finish_notification_job(state, job);
+        return;
+    }
+    
+    // Only the newest queued notification for a tag is worth a D-Bus call
+    if (job->tag && latest != job->generation) {
+        report_notification(state, job, PLATFORM_NOTIFICATION_REPLACED, NULL);
+        finish_notification_job(state, job);
+        return;
+    }
+    
+    // A tagged notification reuses its object, so the server replaces it on screen
+    NotifyNotification* notification = job->tag
+        ? (NotifyNotification*)g_hash_table_lookup(state->notifications, job->tag)
+        : NULL;
+    if (notification) {
+        notify_notification_update(notification, job->title, job->body, NULL);
+    } else {
+        notification = notify_notification_new(job->title, job->body, NULL);
+        if (notification && job->tag) {
+            g_hash_table_insert(state->notifications, g_strdup(job->tag), notification);
+        }
     }
+    
+    GError* error = NULL;
+    gboolean result = notification ? notify_notification_show(notification, &error) : FALSE;
+    
+    if (result) {
+        report_notification(state, job, PLATFORM_NOTIFICATION_SHOWN, NULL);
+    } else {
+        fprintf(stderr, "Notification error: %s\n", error ? error->message : "could not create notification");
+        report_notification(state, job, PLATFORM_NOTIFICATION_FAILED,
+                            error ? error->message : "Could not create notification");
+    }
+    if (error) g_error_free(error);
+    
+    if (notification && !job->tag) {
+        g_object_unref(notification);
+    }
+    finish_notification_job(state, job);
+}
+
+void platform_tray_set_notification_callback(platform_tray_t* tray, platform_notification_callback_t callback, void* userdata) {
+    if (!tray) return;
+    
+    g_mutex_lock(&tray->notify->lock);
+    tray->notify->callback = callback;
+    tray->notify->userdata = userdata;
+    g_mutex_unlock(&tray->notify->lock);
+}
+
+int platform_tray_post_notification(platform_tray_t* tray, const char* notification_id, const char* tag,
+                                    const char* title, const char* body) {
+    if (!tray || !notification_id || !title || !body) return -1;
+    
+    notify_state_t* state = tray->notify;
+    if (!tray->notify_pool) {
+        tray->notify_pool = g_thread_pool_new(run_notification_job, state, 1, FALSE, NULL);
+        if (!tray->notify_pool) return -1;
+    }
+    
+    notification_job_t* job = g_new0(notification_job_t, 1);
+    job->id = g_strdup(notification_id);
+    job->tag = (tag && tag[0]) ? g_strdup(tag) : NULL;
+    job->title = g_strdup(title);
+    job->body = g_strdup(body);
+    
+    g_mutex_lock(&state->lock);
+    if (job->tag) {
+        job->generation = ++state->generation;
+        g_hash_table_replace(state->latest, g_strdup(job->tag), GUINT_TO_POINTER(job->generation));
+    }
+    g_ptr_array_add(state->pending, job);
+    g_mutex_unlock(&state->lock);
+    
+    g_atomic_int_inc(&state->refs);
+    g_thread_pool_push(tray->notify_pool, job, NULL);
+    return 0;
 }
 
 int platform_tray_show_notification(platform_tray_t* tray, const char* title, const char* body) {
@@ -223,20 +681,48 @@ int platform_tray_show_notification(platform_tray_t* tray, const char* title, co
     return result ? 0 : -1;
 }
 
+// Marshalled task, freed once it has run on the GTK thread
+typedef struct {
+    platform_tray_task_t task;
+    void* data;
+} tray_task_t;
+
+static gboolean run_tray_task(gpointer user_data) {
+    tray_task_t* task = (tray_task_t*)user_data;
+    task->task(task->data);
+    g_free(task);
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean quit_main_loop(gpointer user_data) {
+    (void)user_data;
+    if (gtk_main_level() > 0) {
+        gtk_main_quit();
+    }
+    return G_SOURCE_REMOVE;
+}
+
+void platform_tray_dispatch(platform_tray_task_t task, void* data) {
+    tray_task_t* queued = g_new(tray_task_t, 1);
+    queued->task = task;
+    queued->data = data;
+    // g_idle_add wakes the main context, so the task runs as soon as GTK is free
+    g_idle_add_full(G_PRIORITY_DEFAULT, run_tray_task, queued, NULL);
+}
+
+int platform_tray_init_event_loop(void) {
+    return gtk_init_check(0, NULL) ? 0 : -1;
+}
+
+void platform_tray_quit_event_loop(void) {
+    g_idle_add_full(G_PRIORITY_DEFAULT, quit_main_loop, NULL, NULL);
+}
+
 void platform_tray_run_event_loop(void* context) {
-    // Import the IPC context structure
-    typedef struct {
-        int should_exit;
-        void* application_data;
-    } ipc_base_context_t;
+    (void)context;
     
-    ipc_base_context_t* ipc_context = (ipc_base_context_t*)context;
-    
-    // GTK main loop for Linux
-    while (!ipc_context->should_exit) {
-        gtk_main_iteration_do(FALSE);
-        usleep(10000); // 10ms
-    }
+    // Blocks in poll() until a GTK event or a dispatched task arrives
+    gtk_main();
 }
 
 int platform_tray_is_supported(void) {
@@ -48,15 +48,31 @@
 struct platform_tray {
     NSStatusItem* statusItem;
     TrayDelegate* delegate;
+    platform_notification_callback_t notificationCallback;
+    void* notificationUserdata;
+    NSImage* staticImage;      // image to restore when the animation stops
+    NSArray* animationFrames;  // nil when not animating
+    NSTimer* animationTimer;
+    NSUInteger animationIndex;
 };
 
+static void stopAnimationTimer(platform_tray_t* tray) {
+    [tray->animationTimer invalidate];
+    [tray->animationTimer release];
+    tray->animationTimer = nil;
+    [tray->animationFrames release];
+    tray->animationFrames = nil;
+}
+
 platform_tray_t* platform_tray_create(const char* icon_path, const char* tooltip) {
     @autoreleasepool {
         // Initialize NSApplication if not already done
         [NSApplication sharedApplication];
-        [NSApp setActivationPolicy:NSApplicationActivationPolicyAccessory];
+        if ([NSApp activationPolicy] != NSApplicationActivationPolicyRegular) {
+            [NSApp setActivationPolicy:NSApplicationActivationPolicyAccessory];
+        }
         
-        platform_tray_t* tray = (platform_tray_t*)malloc(sizeof(platform_tray_t));
+        platform_tray_t* tray = (platform_tray_t*)calloc(1, sizeof(platform_tray_t));
         if (!tray) return NULL;
         
         // Create status item
@@ -107,6 +123,10 @@ void platform_tray_destroy(platform_tray_t* tray) {
     if (!tray) return;
     
     @autoreleasepool {
+        stopAnimationTimer(tray);
+        [tray->staticImage release];
+        tray->staticImage = nil;
+        
         if (tray->statusItem) {
             [[NSStatusBar systemStatusBar] removeStatusItem:tray->statusItem];
             [tray->statusItem release];
@@ -147,7 +167,8 @@ int platform_tray_set_icon(platform_tray_t* tray, const char* icon_path) {
             [iconCopy setSize:NSMakeSize(18, 18)];
             [iconCopy setTemplate:YES];
             
-            // Should already be on main thread
+            // Should already be on main thread; a still icon ends any animation
+            stopAnimationTimer(tray);
             if (tray->statusItem) {
                 NSButton* button = [tray->statusItem button];
                 if (button) {
@@ -164,6 +185,71 @@ int platform_tray_set_icon(platform_tray_t* tray, const char* icon_path) {
     }
 }
 
+int platform_tray_set_icon_data(platform_tray_t* tray, const unsigned char* data, size_t length) {
+    if (!tray || !data || length == 0) return -1;
+    
+    @autoreleasepool {
+        NSData* bytes = [NSData dataWithBytes:data length:length];
+        NSImage* image = [[NSImage alloc] initWithData:bytes];
+        if (!image) return -1;
+        
+        [image setSize:NSMakeSize(18, 18)];
+        [image setTemplate:YES];
+        stopAnimationTimer(tray);
+        [[tray->statusItem button] setImage:image];
+        [image release];
+        return 0;
+    }
+}
+
+int platform_tray_set_animation(platform_tray_t* tray, const char* const* frame_paths, int count, int interval_ms) {
+    if (!tray || !frame_paths || count <= 0 || interval_ms <= 0) return -1;
+    
+    @autoreleasepool {
+        // Decode every frame up front; timer ticks only swap images
+        NSMutableArray* frames = [NSMutableArray arrayWithCapacity:(NSUInteger)count];
+        for (int i = 0; i < count; i++) {
+            NSImage* frame = [[NSImage alloc] initWithContentsOfFile:[NSString stringWithUTF8String:frame_paths[i]]];
+            if (!frame) return -1;
+            [frame setSize:NSMakeSize(18, 18)];
+            [frame setTemplate:YES];
+            [frames addObject:frame];
+            [frame release];
+        }
+        
+        NSButton* button = [tray->statusItem button];
+        if (!tray->animationFrames) {
+            [tray->staticImage release];
+            tray->staticImage = [[button image] retain];
+        }
+        stopAnimationTimer(tray);
+        
+        tray->animationFrames = [frames copy];
+        tray->animationIndex = 0;
+        [button setImage:[frames objectAtIndex:0]];
+        
+        if (count > 1) {
+            tray->animationTimer = [[NSTimer scheduledTimerWithTimeInterval:interval_ms / 1000.0
+                                                                    repeats:YES
+                                                                      block:^(NSTimer* timer) {
+                (void)timer;
+                tray->animationIndex = (tray->animationIndex + 1) % [tray->animationFrames count];
+                [[tray->statusItem button] setImage:[tray->animationFrames objectAtIndex:tray->animationIndex]];
+            }] retain];
+        }
+        return 0;
+    }
+}
+
+void platform_tray_stop_animation(platform_tray_t* tray) {
+    if (!tray || !tray->animationFrames) return;
+    
+    @autoreleasepool {
+        stopAnimationTimer(tray);
+        [[tray->statusItem button] setImage:tray->staticImage];
+    }
+}
+
 int platform_tray_set_tooltip(platform_tray_t* tray, const char* tooltip) {
     if (!tray || !tooltip) return -1;
     
@@ -218,14 +304,23 @@ NSMenuItem* createMenuItemFromPlatform(const platform_menu_item_t* item, TrayDel
     return menuItem;
 }
 
+// Register an item under its id so it can be patched later
+static void registerMenuItem(TrayDelegate* delegate, const platform_menu_item_t* item, NSMenuItem* menuItem) {
+    if (strlen(item->id) > 0) {
+        [delegate.menuItems setObject:menuItem forKey:[NSString stringWithUTF8String:item->id]];
+    }
+}
+
 int platform_tray_set_menu(platform_tray_t* tray, const platform_menu_item_t* menu_items, int count) {
     if (!tray || !menu_items || count <= 0) return -1;
     
     @autoreleasepool {
         NSMenu* menu = [[NSMenu alloc] init];
+        [tray->delegate.menuItems removeAllObjects];
         
         for (int i = 0; i < count; i++) {
             NSMenuItem* menuItem = createMenuItemFromPlatform(&menu_items[i], tray->delegate);
+            registerMenuItem(tray->delegate, &menu_items[i], menuItem);
             [menu addItem:menuItem];
         }
         
@@ -234,6 +329,75 @@ int platform_tray_set_menu(platform_tray_t* tray, const platform_menu_item_t* me
     }
 }
 
+int platform_tray_update_item(platform_tray_t* tray, const platform_menu_item_t* item) {
+    if (!tray || !item) return -1;
+    
+    @autoreleasepool {
+        NSString* key = [NSString stringWithUTF8String:item->id];
+        NSMenuItem* menuItem = [tray->delegate.menuItems objectForKey:key];
+        if (!menuItem) return -1;
+        
+        if ([menuItem isSeparatorItem] != (item->type == 1)) {
+            // Separators are a distinct item kind, so swap in a new item at the same index
+            NSMenu* menu = [menuItem menu];
+            NSInteger index = [menu indexOfItem:menuItem];
+            NSMenuItem* replacement = createMenuItemFromPlatform(item, tray->delegate);
+            [menu removeItemAtIndex:index];
+            [menu insertItem:replacement atIndex:index];
+            registerMenuItem(tray->delegate, item, replacement);
+            return 0;
+        }
+        
+        if (item->type == 1) return 0; // separators have no state
+        
+        NSString* label = [NSString stringWithUTF8String:item->label];
+        if (![[menuItem title] isEqualToString:label]) {
+            [menuItem setTitle:label];
+        }
+        [menuItem setEnabled:item->enabled ? YES : NO];
+        [menuItem setState:(item->type == 2 && item->checked) ? NSControlStateValueOn : NSControlStateValueOff];
+        return 0;
+    }
+}
+
+int platform_tray_insert_item(platform_tray_t* tray, const platform_menu_item_t* item, int position) {
+    if (!tray || !item) return -1;
+    
+    @autoreleasepool {
+        if (strlen(item->id) > 0 &&
+            [tray->delegate.menuItems objectForKey:[NSString stringWithUTF8String:item->id]]) {
+            return -1;
+        }
+        
+        NSMenu* menu = [tray->statusItem menu];
+        if (!menu) {
+            menu = [[NSMenu alloc] init];
+            [tray->statusItem setMenu:menu];
+        }
+        
+        NSMenuItem* menuItem = createMenuItemFromPlatform(item, tray->delegate);
+        NSInteger count = [menu numberOfItems];
+        NSInteger index = (position < 0 || position > count) ? count : position;
+        [menu insertItem:menuItem atIndex:index];
+        registerMenuItem(tray->delegate, item, menuItem);
+        return 0;
+    }
+}
+
+int platform_tray_remove_item(platform_tray_t* tray, const char* id) {
+    if (!tray || !id) return -1;
+    
+    @autoreleasepool {
+        NSString* key = [NSString stringWithUTF8String:id];
+        NSMenuItem* menuItem = [tray->delegate.menuItems objectForKey:key];
+        if (!menuItem) return -1;
+        
+        [[menuItem menu] removeItem:menuItem];
+        [tray->delegate.menuItems removeObjectForKey:key];
+        return 0;
+    }
+}
+
 void platform_tray_set_click_callback(platform_tray_t* tray, platform_tray_click_callback_t callback, void* userdata) {
     if (!tray) return;
     
@@ -261,31 +425,73 @@ int platform_tray_show_notification(platform_tray_t* tray, const char* title, co
     }
 }
 
-void platform_tray_run_event_loop(void* context) {
-    // Import the IPC context structure
-    typedef struct {
-        int should_exit;
-        void* application_data;
-    } ipc_base_context_t;
+void platform_tray_set_notification_callback(platform_tray_t* tray, platform_notification_callback_t callback, void* userdata) {
+    if (!tray) return;
     
-    ipc_base_context_t* ipc_context = (ipc_base_context_t*)context;
+    tray->notificationCallback = callback;
+    tray->notificationUserdata = userdata;
+}
+
+int platform_tray_post_notification(platform_tray_t* tray, const char* notification_id, const char* tag,
+                                    const char* title, const char* body) {
+    if (!tray || !notification_id || !title || !body) return -1;
     
-    // macOS run loop
     @autoreleasepool {
-        while (!ipc_context->should_exit) {
-            @autoreleasepool {
-                NSEvent* event = [NSApp nextEventMatchingMask:NSEventMaskAny
-                                                    untilDate:[NSDate dateWithTimeIntervalSinceNow:0.1]
-                                                       inMode:NSDefaultRunLoopMode
-                                                      dequeue:YES];
-                if (event) {
-                    [NSApp sendEvent:event];
-                }
-                
-                // Process any pending runloop sources
-                [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.01]];
-            }
+        NSUserNotification* notification = [[NSUserNotification alloc] init];
+        notification.title = [NSString stringWithUTF8String:title];
+        notification.informativeText = [NSString stringWithUTF8String:body];
+        if (tag && tag[0]) {
+            // Delivering a notification with the same identifier replaces the old one
+            notification.identifier = [NSString stringWithUTF8String:tag];
         }
+        
+        // Delivery is handed to the notification center and does not block
+        [[NSUserNotificationCenter defaultUserNotificationCenter] deliverNotification:notification];
+        [notification release];
+        
+        if (tray->notificationCallback) {
+            tray->notificationCallback(notification_id, PLATFORM_NOTIFICATION_SHOWN, NULL, tray->notificationUserdata);
+        }
+        return 0;
+    }
+}
+
+int platform_tray_init_event_loop(void) {
+    // Windows share this loop, so the app keeps its Dock presence
+    [NSApplication sharedApplication];
+    [NSApp setActivationPolicy:NSApplicationActivationPolicyRegular];
+    return 0;
+}
+
+void platform_tray_dispatch(platform_tray_task_t task, void* data) {
+    dispatch_async(dispatch_get_main_queue(), ^{
+        task(data);
+    });
+}
+
+void platform_tray_quit_event_loop(void) {
+    dispatch_async(dispatch_get_main_queue(), ^{
+        [NSApp stop:nil];
+        // -stop: takes effect after the next event, so post one
+        NSEvent* event = [NSEvent otherEventWithType:NSEventTypeApplicationDefined
+                                            location:NSZeroPoint
+                                       modifierFlags:0
+                                           timestamp:0
+                                        windowNumber:0
+                                             context:nil
+                                             subtype:0
+                                               data1:0
+                                               data2:0];
+        [NSApp postEvent:event atStart:YES];
+    });
+}
+
+void platform_tray_run_event_loop(void* context) {
+    (void)context;
+    
+    // macOS run loop; the main dispatch queue drains inside it
+    @autoreleasepool {
+        [NSApp run];
     }
 }
 
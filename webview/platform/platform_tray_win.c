@@ -8,7 +8,9 @@
 #include <string.h>
 
 #define WM_TRAY_MESSAGE (WM_USER + 1)
+#define WM_TRAY_TASK (WM_USER + 2)
 #define TRAY_ID 1001
+#define TRAY_ANIMATION_TIMER 1
 
 typedef struct menu_item_info {
     char id[256];
@@ -25,11 +27,27 @@ struct platform_tray {
     void* userdata;
     menu_item_info_t* menu_items;
     UINT next_menu_id;
+    HICON static_icon;       // icon to restore when the animation stops
+    HICON* animation_frames; // NULL when not animating
+    int animation_count;
+    int animation_index;
+    platform_notification_callback_t notification_callback;
+    void* notification_userdata;
 };
 
 static platform_tray_t* g_tray = NULL; // Global tray instance for window procedure
+static DWORD g_loop_thread_id = 0;     // Thread that created the tray and runs its loop
 
 LRESULT CALLBACK TrayWindowProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    if (msg == WM_TIMER && wParam == TRAY_ANIMATION_TIMER) {
+        if (g_tray && g_tray->animation_frames) {
+            g_tray->animation_index = (g_tray->animation_index + 1) % g_tray->animation_count;
+            g_tray->nid.hIcon = g_tray->animation_frames[g_tray->animation_index];
+            Shell_NotifyIcon(NIM_MODIFY, &g_tray->nid);
+        }
+        return 0;
+    }
+    
     if (msg == WM_TRAY_MESSAGE) {
         // Both left-click and right-click now show the menu
         if ((lParam == WM_LBUTTONUP || lParam == WM_RBUTTONUP) && g_tray && g_tray->menu) {
@@ -64,6 +82,8 @@ platform_tray_t* platform_tray_create(const char* icon_path, const char* tooltip
     platform_tray_t* tray = (platform_tray_t*)calloc(1, sizeof(platform_tray_t));
     if (!tray) return NULL;
     
+    g_loop_thread_id = GetCurrentThreadId();
+    
     // Register window class
     WNDCLASS wc = {0};
     wc.lpfnWndProc = TrayWindowProc;
@@ -124,6 +144,9 @@ void platform_tray_destroy(platform_tray_t* tray) {
     
     // Remove tray icon
     Shell_NotifyIcon(NIM_DELETE, &tray->nid);
+    if (tray->animation_frames) {
+        platform_tray_stop_animation(tray);
+    }
     
     // Destroy menu
     if (tray->menu) {
@@ -150,6 +173,33 @@ void platform_tray_destroy(platform_tray_t* tray) {
     free(tray);
 }
 
+static void free_animation_frames(platform_tray_t* tray) {
+    KillTimer(tray->hwnd, TRAY_ANIMATION_TIMER);
+    for (int i = 0; i < tray->animation_count; i++) {
+        DestroyIcon(tray->animation_frames[i]);
+    }
+    free(tray->animation_frames);
+    tray->animation_frames = NULL;
+    tray->animation_count = 0;
+}
+
+// Show a new icon and free the one it replaces, ending any animation
+static int swap_icon(platform_tray_t* tray, HICON new_icon) {
+    HICON old_icon = tray->animation_frames ? tray->static_icon : tray->nid.hIcon;
+    tray->nid.hIcon = new_icon;
+    
+    BOOL result = Shell_NotifyIcon(NIM_MODIFY, &tray->nid);
+    
+    if (tray->animation_frames) {
+        free_animation_frames(tray);
+    }
+    if (old_icon && old_icon != LoadIcon(NULL, IDI_APPLICATION)) {
+        DestroyIcon(old_icon);
+    }
+    
+    return result ? 0 : -1;
+}
+
 int platform_tray_set_icon(platform_tray_t* tray, const char* icon_path) {
     if (!tray || !icon_path) return -1;
     
@@ -159,16 +209,62 @@ int platform_tray_set_icon(platform_tray_t* tray, const char* icon_path) {
     HICON new_icon = (HICON)LoadImageW(NULL, icon_path_w, IMAGE_ICON, 16, 16, LR_LOADFROMFILE);
     if (!new_icon) return -1;
     
-    HICON old_icon = tray->nid.hIcon;
-    tray->nid.hIcon = new_icon;
+    return swap_icon(tray, new_icon);
+}
+
+int platform_tray_set_icon_data(platform_tray_t* tray, const unsigned char* data, size_t length) {
+    if (!tray || !data || length == 0) return -1;
     
-    BOOL result = Shell_NotifyIcon(NIM_MODIFY, &tray->nid);
+    // Vista and later accept PNG bytes as icon resource data
+    HICON new_icon = CreateIconFromResourceEx((PBYTE)data, (DWORD)length, TRUE, 0x00030000, 16, 16, LR_DEFAULTCOLOR);
+    if (!new_icon) return -1;
     
-    if (old_icon && old_icon != LoadIcon(NULL, IDI_APPLICATION)) {
-        DestroyIcon(old_icon);
+    return swap_icon(tray, new_icon);
+}
+
+int platform_tray_set_animation(platform_tray_t* tray, const char* const* frame_paths, int count, int interval_ms) {
+    if (!tray || !frame_paths || count <= 0 || interval_ms <= 0) return -1;
+    
+    // Load every frame up front; timer ticks only swap handles
+    HICON* frames = (HICON*)calloc((size_t)count, sizeof(HICON));
+    if (!frames) return -1;
+    for (int i = 0; i < count; i++) {
+        WCHAR frame_path_w[MAX_PATH];
+        MultiByteToWideChar(CP_UTF8, 0, frame_paths[i], -1, frame_path_w, MAX_PATH);
+        frames[i] = (HICON)LoadImageW(NULL, frame_path_w, IMAGE_ICON, 16, 16, LR_LOADFROMFILE);
+        if (!frames[i]) {
+            for (int j = 0; j < i; j++) DestroyIcon(frames[j]);
+            free(frames);
+            return -1;
+        }
     }
     
-    return result ? 0 : -1;
+    if (!tray->animation_frames) {
+        tray->static_icon = tray->nid.hIcon;
+    }
+    
+    // Show the first new frame before the previous frames are freed
+    tray->nid.hIcon = frames[0];
+    Shell_NotifyIcon(NIM_MODIFY, &tray->nid);
+    if (tray->animation_frames) {
+        free_animation_frames(tray);
+    }
+    
+    tray->animation_frames = frames;
+    tray->animation_count = count;
+    tray->animation_index = 0;
+    if (count > 1) {
+        SetTimer(tray->hwnd, TRAY_ANIMATION_TIMER, (UINT)interval_ms, NULL);
+    }
+    return 0;
+}
+
+void platform_tray_stop_animation(platform_tray_t* tray) {
+    if (!tray || !tray->animation_frames) return;
+    
+    tray->nid.hIcon = tray->static_icon;
+    Shell_NotifyIcon(NIM_MODIFY, &tray->nid);
+    free_animation_frames(tray);
 }
 
 int platform_tray_set_tooltip(platform_tray_t* tray, const char* tooltip) {
@@ -179,6 +275,56 @@ int platform_tray_set_tooltip(platform_tray_t* tray, const char* tooltip) {
     return Shell_NotifyIcon(NIM_MODIFY, &tray->nid) ? 0 : -1;
 }
 
+static menu_item_info_t* find_menu_item_info(platform_tray_t* tray, const char* id) {
+    menu_item_info_t* item = tray->menu_items;
+    while (item) {
+        if (strcmp(item->id, id) == 0) return item;
+        item = item->next;
+    }
+    return NULL;
+}
+
+// Fill the parts of a MENUITEMINFOW that describe an item's type and state
+static void fill_menu_item_info(const platform_menu_item_t* menu_item, MENUITEMINFOW* mii, WCHAR* label_w) {
+    memset(mii, 0, sizeof(*mii));
+    mii->cbSize = sizeof(*mii);
+    mii->fMask = MIIM_FTYPE | MIIM_STATE | MIIM_ID;
+    
+    if (menu_item->type == 1) { // separator
+        mii->fType = MFT_SEPARATOR;
+        return;
+    }
+    
+    MultiByteToWideChar(CP_UTF8, 0, menu_item->label, -1, label_w, 256);
+    mii->fMask |= MIIM_STRING;
+    mii->fType = MFT_STRING;
+    mii->dwTypeData = label_w;
+    if (!menu_item->enabled) mii->fState |= MFS_GRAYED;
+    if (menu_item->type == 2 && menu_item->checked) mii->fState |= MFS_CHECKED;
+}
+
+// Insert one item at a position (-1 appends) and record its id
+static int insert_menu_item(platform_tray_t* tray, const platform_menu_item_t* menu_item, int position) {
+    WCHAR label_w[256];
+    MENUITEMINFOW mii;
+    fill_menu_item_info(menu_item, &mii, label_w);
+    
+    // Separators get a command id too, so they can be removed by id
+    mii.wID = tray->next_menu_id++;
+    
+    UINT index = position < 0 ? (UINT)GetMenuItemCount(tray->menu) : (UINT)position;
+    if (!InsertMenuItemW(tray->menu, index, TRUE, &mii)) return -1;
+    
+    // Store menu item info
+    menu_item_info_t* info = (menu_item_info_t*)malloc(sizeof(menu_item_info_t));
+    strncpy(info->id, menu_item->id, sizeof(info->id) - 1);
+    info->id[sizeof(info->id) - 1] = '\0';
+    info->menu_id = mii.wID;
+    info->next = tray->menu_items;
+    tray->menu_items = info;
+    return 0;
+}
+
 int platform_tray_set_menu(platform_tray_t* tray, const platform_menu_item_t* menu_items, int count) {
     if (!tray || !menu_items || count <= 0) return -1;
     
@@ -201,34 +347,54 @@ int platform_tray_set_menu(platform_tray_t* tray, const platform_menu_item_t* me
     if (!tray->menu) return -1;
     
     for (int i = 0; i < count; i++) {
-        const platform_menu_item_t* menu_item = &menu_items[i];
-        
-        if (menu_item->type == 1) { // separator
-            AppendMenu(tray->menu, MF_SEPARATOR, 0, NULL);
-        } else {
-            WCHAR label_w[256];
-            MultiByteToWideChar(CP_UTF8, 0, menu_item->label, -1, label_w, 256);
-            
-            UINT flags = MF_STRING;
-            if (!menu_item->enabled) flags |= MF_GRAYED;
-            if (menu_item->type == 2 && menu_item->checked) flags |= MF_CHECKED;
-            
-            UINT menu_id = tray->next_menu_id++;
-            AppendMenuW(tray->menu, flags, menu_id, label_w);
-            
-            // Store menu item info
-            menu_item_info_t* info = (menu_item_info_t*)malloc(sizeof(menu_item_info_t));
-            strncpy(info->id, menu_item->id, sizeof(info->id) - 1);
-            info->id[sizeof(info->id) - 1] = '\0';
-            info->menu_id = menu_id;
-            info->next = tray->menu_items;
-            tray->menu_items = info;
-        }
+        insert_menu_item(tray, &menu_items[i], -1);
     }
     
     return 0;
 }
 
+int platform_tray_update_item(platform_tray_t* tray, const platform_menu_item_t* item) {
+    if (!tray || !item || !tray->menu) return -1;
+    
+    menu_item_info_t* info = find_menu_item_info(tray, item->id);
+    if (!info) return -1;
+    
+    // Win32 menu items can change type in place
+    WCHAR label_w[256];
+    MENUITEMINFOW mii;
+    fill_menu_item_info(item, &mii, label_w);
+    mii.fMask &= ~MIIM_ID;
+    return SetMenuItemInfoW(tray->menu, info->menu_id, FALSE, &mii) ? 0 : -1;
+}
+
+int platform_tray_insert_item(platform_tray_t* tray, const platform_menu_item_t* item, int position) {
+    if (!tray || !item) return -1;
+    if (item->id[0] != '\0' && find_menu_item_info(tray, item->id)) return -1;
+    
+    if (!tray->menu) {
+        tray->menu = CreatePopupMenu();
+        if (!tray->menu) return -1;
+    }
+    
+    return insert_menu_item(tray, item, position);
+}
+
+int platform_tray_remove_item(platform_tray_t* tray, const char* id) {
+    if (!tray || !id || !tray->menu) return -1;
+    
+    menu_item_info_t** link = &tray->menu_items;
+    while (*link && strcmp((*link)->id, id) != 0) {
+        link = &(*link)->next;
+    }
+    if (!*link) return -1;
+    
+    menu_item_info_t* info = *link;
+    DeleteMenu(tray->menu, info->menu_id, MF_BYCOMMAND);
+    *link = info->next;
+    free(info);
+    return 0;
+}
+
 void platform_tray_set_click_callback(platform_tray_t* tray, platform_tray_click_callback_t callback, void* userdata) {
     if (!tray) return;
     
@@ -261,23 +427,57 @@ int platform_tray_show_notification(platform_tray_t* tray, const char* title, co
     return result ? 0 : -1;
 }
 
-void platform_tray_run_event_loop(void* context) {
-    // Import the IPC context structure
-    typedef struct {
-        int should_exit;
-        void* application_data;
-    } ipc_base_context_t;
+void platform_tray_set_notification_callback(platform_tray_t* tray, platform_notification_callback_t callback, void* userdata) {
+    if (!tray) return;
+    
+    tray->notification_callback = callback;
+    tray->notification_userdata = userdata;
+}
+
+int platform_tray_post_notification(platform_tray_t* tray, const char* notification_id, const char* tag,
+                                    const char* title, const char* body) {
+    (void)tag; // The tray icon has a single balloon, so every notification replaces the last
+    if (!tray || !notification_id) return -1;
+    
+    // Shell_NotifyIcon only posts to the shell, so it does not block the loop
+    int result = platform_tray_show_notification(tray, title, body);
+    if (tray->notification_callback) {
+        tray->notification_callback(notification_id,
+                                    result == 0 ? PLATFORM_NOTIFICATION_SHOWN : PLATFORM_NOTIFICATION_FAILED,
+                                    result == 0 ? NULL : "Shell_NotifyIcon failed", tray->notification_userdata);
+    }
+    return 0;
+}
+
+int platform_tray_init_event_loop(void) {
+    g_loop_thread_id = GetCurrentThreadId();
     
-    ipc_base_context_t* ipc_context = (ipc_base_context_t*)context;
+    // A thread gets its message queue on first use; create it before anything is posted
+    MSG msg;
+    PeekMessage(&msg, NULL, WM_USER, WM_USER, PM_NOREMOVE);
+    return 0;
+}
+
+void platform_tray_dispatch(platform_tray_task_t task, void* data) {
+    PostThreadMessage(g_loop_thread_id, WM_TRAY_TASK, (WPARAM)task, (LPARAM)data);
+}
+
+void platform_tray_quit_event_loop(void) {
+    PostThreadMessage(g_loop_thread_id, WM_QUIT, 0, 0);
+}
+
+void platform_tray_run_event_loop(void* context) {
+    (void)context;
     
-    // Windows message loop
+    // Windows message loop; GetMessage blocks until there is work
     MSG msg;
-    while (!ipc_context->should_exit) {
-        if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
-            TranslateMessage(&msg);
-            DispatchMessage(&msg);
+    while (GetMessage(&msg, NULL, 0, 0) > 0) {
+        if (msg.hwnd == NULL && msg.message == WM_TRAY_TASK) {
+            ((platform_tray_task_t)msg.wParam)((void*)msg.lParam);
+            continue;
         }
-        Sleep(10); // 10ms
+        TranslateMessage(&msg);
+        DispatchMessage(&msg);
     }
 }
 
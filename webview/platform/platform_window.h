@@ -7,10 +7,60 @@
 
 #pragma once
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+typedef void (*platform_window_close_callback_t)(void* userdata);
+
+// Page lifecycle reported by the browser engine
+typedef enum {
+    PLATFORM_LOAD_STARTED = 0,
+    PLATFORM_LOAD_FINISHED,
+    PLATFORM_LOAD_FAILED,
+    PLATFORM_LOAD_CRASHED   // The web content process died
+} platform_load_event_t;
+
+typedef void (*platform_window_load_callback_t)(void* userdata, platform_load_event_t event,
+                                                 const char* uri, const char* error);
+
+// cleared is 1 once cookies, storage and caches are gone, 0 if clearing failed
+typedef void (*platform_window_cleared_callback_t)(void* userdata, int cleared);
+
+// One request to a custom URI scheme
+typedef struct {
+    const char* uri;
+    const char* path;           // Path part of the URI, still percent-encoded
+    const char* range;          // Request headers, NULL when absent or not exposed by the engine
+    const char* if_none_match;
+    const char* accept_encoding;  // Only set when the engine decodes Content-Encoding for the scheme
+    const char* method;         // "GET" when the engine doesn't expose it
+    const unsigned char* body;  // Request body, valid while the handler runs; NULL if none or not exposed
+    size_t body_length;
+    void* native_window;        // Window holding the requesting web view, NULL if unknown
+    void* handle;               // Passed to platform_scheme_finish by deferred handlers
+} platform_scheme_request_t;
+
+// Filled in by the scheme handler. The body must stay valid until release(owner)
+// is called, which happens exactly once, possibly after the handler returned.
+typedef struct {
+    int status;
+    const char* content_type;
+    const unsigned char* body;
+    size_t length;
+    const char* file_path;       // Instead of body: stream length bytes of this file from file_offset
+    long long file_offset;
+    const char* const* headers;  // name, value pairs ending with NULL; valid until release like the body
+    void (*release)(void* owner);
+    void* owner;
+    int deferred;                // Set by the handler to answer later with platform_scheme_finish
+} platform_scheme_response_t;
+
+typedef void (*platform_scheme_handler_t)(void* userdata, const platform_scheme_request_t* request,
+                                          platform_scheme_response_t* response);
+
 /**
  * Set window transparency
  * @param native_window Platform-specific window handle
@@ -106,6 +156,59 @@ void platform_window_hide(void *native_window);
  */
 void platform_window_show(void *native_window);
 
+/**
+ * Call back once the window is closed by the user or destroyed
+ * @param native_window Platform-specific window handle
+ * @param callback Callback function, run on the UI thread
+ * @param userdata User data passed to callback
+ */
+void platform_window_set_close_callback(void *native_window, platform_window_close_callback_t callback, void *userdata);
+
+/**
+ * Report page loads of the web view inside the window
+ * @param native_window Platform-specific window handle
+ * @param callback Callback function, run on the UI thread; uri and error may be NULL
+ * @param userdata User data passed to callback
+ * @return 1 if the platform reports load events, 0 if it doesn't
+ */
+int platform_window_set_load_callback(void *native_window, platform_window_load_callback_t callback, void *userdata);
+
+/**
+ * Serve a custom URI scheme (e.g. "tronbun") to the web view inside the window.
+ * The handler runs on the UI thread; registering the same scheme again for
+ * web views sharing an engine context is a no-op.
+ * @param native_window Platform-specific window handle
+ * @param scheme Scheme name, without "://"
+ * @param handler Request handler
+ * @param userdata User data passed to handler
+ * @return 1 if the scheme is served, 0 if the platform can't register it
+ */
+int platform_window_register_scheme(void *native_window, const char *scheme, platform_scheme_handler_t handler, void *userdata);
+
+/**
+ * Answer a request whose handler set deferred, on the UI thread
+ * @param handle Request handle from platform_scheme_request_t
+ * @param response Response, released as for an immediate answer
+ */
+void platform_scheme_finish(void *handle, const platform_scheme_response_t *response);
+
+/**
+ * Whether scheme handlers see request methods and bodies (so pages can POST to them)
+ * @return 1 if bodies are passed to handlers, 0 otherwise
+ */
+int platform_window_scheme_bodies_supported(void);
+
+/**
+ * Clear the website data (cookies, local and session storage, HTTP cache, ...)
+ * of the web view inside the window. This covers every web view sharing its
+ * engine data store.
+ * @param native_window Platform-specific window handle
+ * @param callback Run on the UI thread when done, only if 1 is returned
+ * @param userdata User data passed to callback
+ * @return 1 if clearing started, 0 if the platform can't clear website data
+ */
+int platform_window_clear_website_data(void *native_window, platform_window_cleared_callback_t callback, void *userdata);
+
 #ifdef __cplusplus
 }
 #endif
\ No newline at end of file
@@ -1,6 +1,9 @@
 #ifdef __linux__
 #include <gtk/gtk.h>
 #include <gdk/gdk.h>
+#include <webkit2/webkit2.h>
+#include <stdio.h>
+#include <string.h>
 #include "platform_window.h"
 
 void platform_window_set_transparent(void *native_window) {
@@ -161,4 +164,317 @@ void platform_window_show(void *native_window) {
     }
 }
 
+typedef struct {
+    platform_window_close_callback_t callback;
+    void *userdata;
+} close_callback_t;
+
+static void on_window_destroy(GtkWidget *widget, gpointer data) {
+    (void)widget;
+    close_callback_t *handler = (close_callback_t *)data;
+    handler->callback(handler->userdata);
+}
+
+static void free_close_callback(gpointer data, GClosure *closure) {
+    (void)closure;
+    g_free(data);
+}
+
+void platform_window_set_close_callback(void *native_window, platform_window_close_callback_t callback, void *userdata) {
+    GtkWidget *win = GTK_WIDGET(native_window);
+    if (win && GTK_IS_WINDOW(win) && callback) {
+        close_callback_t *handler = g_new(close_callback_t, 1);
+        handler->callback = callback;
+        handler->userdata = userdata;
+        g_signal_connect_data(win, "destroy", G_CALLBACK(on_window_destroy), handler, free_close_callback, (GConnectFlags)0);
+    }
+}
+
+typedef struct {
+    platform_window_load_callback_t callback;
+    void *userdata;
+} load_callback_t;
+
+// The web view may be wrapped in containers, depending on the webview library version
+static WebKitWebView *find_web_view(GtkWidget *widget) {
+    if (WEBKIT_IS_WEB_VIEW(widget)) {
+        return WEBKIT_WEB_VIEW(widget);
+    }
+    if (!GTK_IS_CONTAINER(widget)) {
+        return NULL;
+    }
+    
+    WebKitWebView *found = NULL;
+    GList *children = gtk_container_get_children(GTK_CONTAINER(widget));
+    for (GList *child = children; child && !found; child = child->next) {
+        found = find_web_view(GTK_WIDGET(child->data));
+    }
+    g_list_free(children);
+    return found;
+}
+
+static void on_load_changed(WebKitWebView *web_view, WebKitLoadEvent load_event, gpointer data) {
+    load_callback_t *handler = (load_callback_t *)data;
+    if (load_event == WEBKIT_LOAD_STARTED) {
+        handler->callback(handler->userdata, PLATFORM_LOAD_STARTED, webkit_web_view_get_uri(web_view), NULL);
+    } else if (load_event == WEBKIT_LOAD_FINISHED) {
+        // Also emitted after load-failed; that load was already reported
+        if (!g_object_get_data(G_OBJECT(web_view), "tronbun-load-failed")) {
+            handler->callback(handler->userdata, PLATFORM_LOAD_FINISHED, webkit_web_view_get_uri(web_view), NULL);
+        }
+        g_object_set_data(G_OBJECT(web_view), "tronbun-load-failed", NULL);
+    }
+}
+
+static gboolean on_load_failed(WebKitWebView *web_view, WebKitLoadEvent load_event, gchar *failing_uri,
+                               GError *error, gpointer data) {
+    (void)load_event;
+    load_callback_t *handler = (load_callback_t *)data;
+    g_object_set_data(G_OBJECT(web_view), "tronbun-load-failed", GINT_TO_POINTER(1));
+    handler->callback(handler->userdata, PLATFORM_LOAD_FAILED, failing_uri, error ? error->message : NULL);
+    return FALSE;  // Let WebKit show its error page
+}
+
+static void on_web_process_terminated(WebKitWebView *web_view, WebKitWebProcessTerminationReason reason, gpointer data) {
+    load_callback_t *handler = (load_callback_t *)data;
+    const char *error = reason == WEBKIT_WEB_PROCESS_EXCEEDED_MEMORY_LIMIT ? "Web process exceeded its memory limit"
+                                                                          : "Web process crashed";
+    handler->callback(handler->userdata, PLATFORM_LOAD_CRASHED, webkit_web_view_get_uri(web_view), error);
+}
+
+static void free_load_callback(gpointer data, GClosure *closure) {
+    (void)closure;
+    g_free(data);
+}
+
+int platform_window_set_load_callback(void *native_window, platform_window_load_callback_t callback, void *userdata) {
+    GtkWidget *win = GTK_WIDGET(native_window);
+    if (!win || !GTK_IS_WINDOW(win) || !callback) {
+        return 0;
+    }
+    WebKitWebView *web_view = find_web_view(win);
+    if (!web_view) {
+        return 0;
+    }
+    
+    // One handler shared by the three signals, freed with the first of them
+    load_callback_t *handler = g_new(load_callback_t, 1);
+    handler->callback = callback;
+    handler->userdata = userdata;
+    g_signal_connect_data(web_view, "load-changed", G_CALLBACK(on_load_changed), handler, free_load_callback, (GConnectFlags)0);
+    g_signal_connect(web_view, "load-failed", G_CALLBACK(on_load_failed), handler);
+    g_signal_connect(web_view, "web-process-terminated", G_CALLBACK(on_web_process_terminated), handler);
+    return 1;
+}
+
+typedef struct {
+    platform_scheme_handler_t handler;
+    void *userdata;
+} scheme_handler_t;
+
+// Reply with a filled-in response; the body is handed over without a copy
+// and WebKit releases it when done. Files are read as WebKit consumes the stream.
+static void finish_scheme_request(WebKitURISchemeRequest *request, const platform_scheme_response_t *response) {
+    GBytes *bytes = NULL;
+    GInputStream *stream = NULL;
+    if (response->file_path) {
+        GFile *file = g_file_new_for_path(response->file_path);
+        GFileInputStream *file_stream = g_file_read(file, NULL, NULL);
+        g_object_unref(file);
+        if (file_stream && response->file_offset > 0 &&
+            !g_seekable_seek(G_SEEKABLE(file_stream), (goffset)response->file_offset, G_SEEK_SET, NULL, NULL)) {
+            g_clear_object(&file_stream);
+        }
+        stream = file_stream ? G_INPUT_STREAM(file_stream) : NULL;
+    } else {
+        bytes = response->release
+            ? g_bytes_new_with_free_func(response->body, response->length, response->release, response->owner)
+            : g_bytes_new(response->body, response->length);
+        stream = g_memory_input_stream_new_from_bytes(bytes);
+    }
+    if (!stream) {
+        GError *error = g_error_new(G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "Cannot read %s", response->file_path);
+        webkit_uri_scheme_request_finish_error(request, error);
+        g_error_free(error);
+        if (response->release) response->release(response->owner);
+        return;
+    }
+    
+#if WEBKIT_CHECK_VERSION(2, 36, 0)
+    WebKitURISchemeResponse *reply = webkit_uri_scheme_response_new(stream, (gint64)response->length);
+    webkit_uri_scheme_response_set_status(reply, (guint)response->status, NULL);
+    webkit_uri_scheme_response_set_content_type(reply, response->content_type);
+    SoupMessageHeaders *reply_headers = soup_message_headers_new(SOUP_MESSAGE_HEADERS_RESPONSE);
+    for (const char *const *header = response->headers; header && header[0] && header[1]; header += 2) {
+        soup_message_headers_append(reply_headers, header[0], header[1]);
+    }
+    webkit_uri_scheme_response_set_http_headers(reply, reply_headers);
+    webkit_uri_scheme_request_finish_with_response(request, reply);
+    g_object_unref(reply);
+#else
+    // Older WebKitGTK has no status codes or headers for custom schemes
+    if (response->status >= 400) {
+        GError *error = g_error_new(G_IO_ERROR, G_IO_ERROR_FAILED, "HTTP status %d", response->status);
+        webkit_uri_scheme_request_finish_error(request, error);
+        g_error_free(error);
+    } else {
+        webkit_uri_scheme_request_finish(request, stream, (gint64)response->length, response->content_type);
+    }
+#endif
+    
+    g_object_unref(stream);
+    if (bytes) {
+        g_bytes_unref(bytes);
+    } else if (response->release) {
+        // The file stream holds no reference to the reply; headers were copied above
+        response->release(response->owner);
+    }
+}
+
+#if WEBKIT_CHECK_VERSION(2, 40, 0)
+// The body stream is backed by the request's form data, so reading it
+// here doesn't wait on the network
+static GByteArray *read_request_body(WebKitURISchemeRequest *request) {
+    GInputStream *input = webkit_uri_scheme_request_get_http_body(request);
+    if (!input) return NULL;
+    
+    GByteArray *body = g_byte_array_new();
+    guint8 chunk[16384];
+    gssize read;
+    while ((read = g_input_stream_read(input, chunk, sizeof(chunk), NULL, NULL)) > 0) {
+        g_byte_array_append(body, chunk, (guint)read);
+    }
+    g_object_unref(input);
+    if (read < 0) {
+        g_byte_array_unref(body);
+        return NULL;
+    }
+    return body;
+}
+#endif
+
+static void on_scheme_request(WebKitURISchemeRequest *request, gpointer data) {
+    scheme_handler_t *scheme = (scheme_handler_t *)data;
+    
+    platform_scheme_request_t info;
+    memset(&info, 0, sizeof(info));
+    info.uri = webkit_uri_scheme_request_get_uri(request);
+    info.path = webkit_uri_scheme_request_get_path(request);
+    info.method = "GET";
+    info.handle = request;
+    WebKitWebView *web_view = webkit_uri_scheme_request_get_web_view(request);
+    if (web_view) {
+        GtkWidget *toplevel = gtk_widget_get_toplevel(GTK_WIDGET(web_view));
+        info.native_window = GTK_IS_WINDOW(toplevel) ? toplevel : NULL;
+    }
+#if WEBKIT_CHECK_VERSION(2, 36, 0)
+    SoupMessageHeaders *request_headers = webkit_uri_scheme_request_get_http_headers(request);
+    if (request_headers) {
+        info.range = soup_message_headers_get_one(request_headers, "Range");
+        info.if_none_match = soup_message_headers_get_one(request_headers, "If-None-Match");
+    }
+    const char *method = webkit_uri_scheme_request_get_http_method(request);
+    if (method) info.method = method;
+#endif
+    // accept_encoding stays NULL: WebKit hands custom scheme bodies to the
+    // page as they are, so compressed assets must be decoded here
+    
+    GByteArray *body = NULL;
+#if WEBKIT_CHECK_VERSION(2, 40, 0)
+    body = read_request_body(request);
+    if (body) {
+        info.body = body->data;
+        info.body_length = body->len;
+    }
+#endif
+    
+    platform_scheme_response_t response;
+    memset(&response, 0, sizeof(response));
+    scheme->handler(scheme->userdata, &info, &response);
+    if (body) g_byte_array_unref(body);
+    
+    if (response.deferred) {
+        // Kept alive until platform_scheme_finish
+        g_object_ref(request);
+        return;
+    }
+    finish_scheme_request(request, &response);
+}
+
+void platform_scheme_finish(void *handle, const platform_scheme_response_t *response) {
+    WebKitURISchemeRequest *request = WEBKIT_URI_SCHEME_REQUEST(handle);
+    finish_scheme_request(request, response);
+    g_object_unref(request);
+}
+
+int platform_window_scheme_bodies_supported(void) {
+#if WEBKIT_CHECK_VERSION(2, 40, 0)
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+typedef struct {
+    platform_window_cleared_callback_t callback;
+    void *userdata;
+} clear_request_t;
+
+static void on_website_data_cleared(GObject *source, GAsyncResult *result, gpointer data) {
+    clear_request_t *request = (clear_request_t *)data;
+    gboolean cleared = webkit_website_data_manager_clear_finish(WEBKIT_WEBSITE_DATA_MANAGER(source), result, NULL);
+    request->callback(request->userdata, cleared ? 1 : 0);
+    g_free(request);
+}
+
+int platform_window_clear_website_data(void *native_window, platform_window_cleared_callback_t callback, void *userdata) {
+    GtkWidget *win = GTK_WIDGET(native_window);
+    if (!win || !GTK_IS_WINDOW(win) || !callback) {
+        return 0;
+    }
+    WebKitWebView *web_view = find_web_view(win);
+    if (!web_view) {
+        return 0;
+    }
+    
+    clear_request_t *request = g_new(clear_request_t, 1);
+    request->callback = callback;
+    request->userdata = userdata;
+    webkit_website_data_manager_clear(webkit_web_view_get_website_data_manager(web_view),
+                                      WEBKIT_WEBSITE_DATA_ALL, 0, NULL, on_website_data_cleared, request);
+    return 1;
+}
+
+int platform_window_register_scheme(void *native_window, const char *scheme, platform_scheme_handler_t handler, void *userdata) {
+    GtkWidget *win = GTK_WIDGET(native_window);
+    if (!win || !GTK_IS_WINDOW(win) || !scheme || !handler) {
+        return 0;
+    }
+    WebKitWebView *web_view = find_web_view(win);
+    if (!web_view) {
+        return 0;
+    }
+    
+    // Schemes belong to the web context, which host mode webviews share
+    WebKitWebContext *context = webkit_web_view_get_context(web_view);
+    char key[64];
+    snprintf(key, sizeof(key), "tronbun-scheme-%s", scheme);
+    if (g_object_get_data(G_OBJECT(context), key)) {
+        return 1;
+    }
+    
+    scheme_handler_t *data = g_new(scheme_handler_t, 1);
+    data->handler = handler;
+    data->userdata = userdata;
+    webkit_web_context_register_uri_scheme(context, scheme, on_scheme_request, data, g_free);
+    
+    // Same-origin rules, secure-context APIs and fetch() apply as for https
+    WebKitSecurityManager *security = webkit_web_context_get_security_manager(context);
+    webkit_security_manager_register_uri_scheme_as_secure(security, scheme);
+    webkit_security_manager_register_uri_scheme_as_cors_enabled(security, scheme);
+    
+    g_object_set_data(G_OBJECT(context), key, GINT_TO_POINTER(1));
+    return 1;
+}
+
 #endif // __linux__
\ No newline at end of file
@@ -195,4 +195,46 @@ void platform_window_show(void *native_window) {
     if (win) {
         [win makeKeyAndOrderFront:nil];
     }
-}
\ No newline at end of file
+}
+
+void platform_window_set_close_callback(void *native_window, platform_window_close_callback_t callback, void *userdata) {
+    NSWindow *win = (__bridge NSWindow *)native_window;
+    if (win && callback) {
+        // The observer lives as long as the window; it fires once, on close
+        [[NSNotificationCenter defaultCenter] addObserverForName:NSWindowWillCloseNotification
+                                                          object:win
+                                                           queue:nil
+                                                      usingBlock:^(NSNotification *note) {
+            (void)note;
+            callback(userdata);
+        }];
+    }
+}
+
+int platform_window_set_load_callback(void *native_window, platform_window_load_callback_t callback, void *userdata) {
+    // The webview library owns the WKWebView navigation delegate; the page script reports instead
+    (void)native_window; (void)callback; (void)userdata;
+    return 0;
+}
+
+int platform_window_register_scheme(void *native_window, const char *scheme, platform_scheme_handler_t handler, void *userdata) {
+    // WKURLSchemeHandler can only be set on the configuration before the WKWebView is created
+    (void)native_window; (void)scheme; (void)handler; (void)userdata;
+    return 0;
+}
+
+void platform_scheme_finish(void *handle, const platform_scheme_response_t *response) {
+    // Scheme requests never reach a handler here, so nothing is deferred
+    (void)handle;
+    if (response && response->release) response->release(response->owner);
+}
+
+int platform_window_scheme_bodies_supported(void) {
+    return 0;
+}
+
+int platform_window_clear_website_data(void *native_window, platform_window_cleared_callback_t callback, void *userdata) {
+    // Not wired up to WKWebsiteDataStore; callers treat the data as kept
+    (void)native_window; (void)callback; (void)userdata;
+    return 0;
+}
@@ -1,6 +1,8 @@
 #ifdef _WIN32
 #include <windows.h>
 #include <dwmapi.h>
+#include <commctrl.h>
+#include <stdlib.h>
 #include "platform_window.h"
 
 void platform_window_set_transparent(void *native_window) {
@@ -171,4 +173,62 @@ void platform_window_show(void *native_window) {
     }
 }
 
+typedef struct {
+    platform_window_close_callback_t callback;
+    void *userdata;
+} close_callback_t;
+
+// Subclass procedure: sees WM_DESTROY before the webview's own window procedure
+static LRESULT CALLBACK close_subclass_proc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam,
+                                            UINT_PTR subclass_id, DWORD_PTR ref_data) {
+    close_callback_t *handler = (close_callback_t *)ref_data;
+    if (msg == WM_DESTROY) {
+        handler->callback(handler->userdata);
+    } else if (msg == WM_NCDESTROY) {
+        RemoveWindowSubclass(hwnd, close_subclass_proc, subclass_id);
+        free(handler);
+    }
+    return DefSubclassProc(hwnd, msg, wParam, lParam);
+}
+
+void platform_window_set_close_callback(void *native_window, platform_window_close_callback_t callback, void *userdata) {
+    HWND hwnd = (HWND)native_window;
+    if (hwnd && callback) {
+        close_callback_t *handler = (close_callback_t *)malloc(sizeof(close_callback_t));
+        if (!handler) return;
+        handler->callback = callback;
+        handler->userdata = userdata;
+        SetWindowSubclass(hwnd, close_subclass_proc, 1, (DWORD_PTR)handler);
+    }
+}
+
+int platform_window_set_load_callback(void *native_window, platform_window_load_callback_t callback, void *userdata) {
+    // WebView2 navigation events are only reachable through the controller,
+    // which the window handle doesn't expose; the page script reports instead
+    (void)native_window; (void)callback; (void)userdata;
+    return 0;
+}
+
+int platform_window_register_scheme(void *native_window, const char *scheme, platform_scheme_handler_t handler, void *userdata) {
+    // Needs WebResourceRequested on the WebView2 controller, which the window handle doesn't expose
+    (void)native_window; (void)scheme; (void)handler; (void)userdata;
+    return 0;
+}
+
+void platform_scheme_finish(void *handle, const platform_scheme_response_t *response) {
+    // Scheme requests never reach a handler here, so nothing is deferred
+    (void)handle;
+    if (response && response->release) response->release(response->owner);
+}
+
+int platform_window_scheme_bodies_supported(void) {
+    return 0;
+}
+
+int platform_window_clear_website_data(void *native_window, platform_window_cleared_callback_t callback, void *userdata) {
+    // The WebView2 profile is not reachable from the window handle
+    (void)native_window; (void)callback; (void)userdata;
+    return 0;
+}
+
 #endif // _WIN32
\ No newline at end of file
@@ -0,0 +1,277 @@
+/*
+ * Benchmark for cold asset loads from raw and gzip asset archives
+ *
+ * Writes the same synthetic web bundle (a large script, a stylesheet, a
+ * page and an already-compressed font) into two archives, one with every
+ * blob stored raw and one laid out the way `tronbun build` stores
+ * compressible assets. Each round drops the archive from the page cache,
+ * then maps it and serves every asset as the tronbun:// handler does.
+ * Reports the size on disk and p50/p99 load time for each layout.
+ */
+
+#if !defined(_WIN32) && !defined(__APPLE__) && !defined(_GNU_SOURCE)
+#define _XOPEN_SOURCE 600  // clock_gettime and posix_fadvise under -std=c99
+#endif
+
+#include "../common/asset_server.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <zlib.h>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#define BENCH_ROUNDS 25
+#define BENCH_FILES 4
+
+typedef struct {
+    const char* path;  // Sorted bytewise, as in the archive index
+    size_t size;
+    int compressible;
+    unsigned char* data;
+} bench_file_t;
+
+static bench_file_t g_files[BENCH_FILES] = {
+    {"app.js", 4 * 1024 * 1024, 1, NULL},
+    {"fonts/ui.woff2", 256 * 1024, 0, NULL},
+    {"index.html", 4 * 1024, 1, NULL},
+    {"style.css", 512 * 1024, 1, NULL},
+};
+
+static double now_us(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1000000.0 / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000000.0 + (double)ts.tv_nsec / 1000.0;
+#endif
+}
+
+static unsigned int g_seed = 12345;
+
+static unsigned int next_random(void) {
+    g_seed = g_seed * 1103515245u + 12345u;
+    return g_seed >> 8;
+}
+
+// Minified-looking source: statements built from a small vocabulary with
+// random identifiers and numbers, so it compresses like a real bundle
+static void fill_source(unsigned char* data, size_t size) {
+    static const char* words[] = {
+        "function ", "return ", "const ", "let ", "this.", "=>", "===", "null", "undefined",
+        "document.", "querySelector(", "addEventListener(", "Promise.resolve(", "async ", "await ",
+        "{", "}", "(", ")", ";", ",", ".map(", ".filter(", "new ", "if(", "else ", "typeof ",
+    };
+    size_t count = sizeof(words) / sizeof(words[0]);
+    size_t length = 0;
+    while (length < size) {
+        char token[32];
+        unsigned int pick = next_random() % (count + 2);
+        if (pick < count) {
+            snprintf(token, sizeof(token), "%s", words[pick]);
+        } else if (pick == count) {
+            snprintf(token, sizeof(token), "_%x", next_random() % 4096);
+        } else {
+            snprintf(token, sizeof(token), "%u", next_random() % 100000);
+        }
+        for (size_t i = 0; token[i] && length < size; i++) {
+            data[length++] = (unsigned char)token[i];
+        }
+    }
+}
+
+static void put_le(unsigned char* p, unsigned long long value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        p[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static size_t align_offset(size_t offset) {
+    return (offset + ASSET_ARCHIVE_ALIGNMENT - 1) / ASSET_ARCHIVE_ALIGNMENT * ASSET_ARCHIVE_ALIGNMENT;
+}
+
+// Same rule as cli/archive.ts: keep the gzip blob when it saves at least 10%
+static unsigned char* gzip_blob(const bench_file_t* file, size_t* length) {
+    uLong bound = compressBound((uLong)file->size) + 32;
+    unsigned char* out = (unsigned char*)malloc(bound);
+    if (!out) return NULL;
+    
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    deflateInit2(&stream, 9, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    stream.next_in = file->data;
+    stream.avail_in = (uInt)file->size;
+    stream.next_out = out;
+    stream.avail_out = (uInt)bound;
+    int ok = deflate(&stream, Z_FINISH) == Z_STREAM_END;
+    *length = stream.total_out;
+    deflateEnd(&stream);
+    if (!ok || *length > file->size / 10 * 9) {
+        free(out);
+        return NULL;
+    }
+    return out;
+}
+
+static size_t write_archive(const char* path, int compress) {
+    unsigned char* blobs[BENCH_FILES];
+    size_t lengths[BENCH_FILES];
+    size_t offsets[BENCH_FILES];
+    size_t strings = ASSET_ARCHIVE_HEADER_SIZE + BENCH_FILES * ASSET_ARCHIVE_ENTRY_SIZE;
+    size_t strings_length = 0;
+    for (int i = 0; i < BENCH_FILES; i++) {
+        strings_length += strlen(g_files[i].path);
+    }
+    
+    size_t offset = align_offset(strings + strings_length);
+    for (int i = 0; i < BENCH_FILES; i++) {
+        blobs[i] = compress && g_files[i].compressible ? gzip_blob(&g_files[i], &lengths[i]) : NULL;
+        if (!blobs[i]) lengths[i] = g_files[i].size;
+        offsets[i] = offset;
+        offset = align_offset(offset + lengths[i]);
+    }
+    size_t size = offsets[BENCH_FILES - 1] + lengths[BENCH_FILES - 1];
+    
+    unsigned char* archive = (unsigned char*)calloc(1, size);
+    if (!archive) return 0;
+    memcpy(archive, ASSET_ARCHIVE_MAGIC, 8);
+    put_le(archive + 8, ASSET_ARCHIVE_VERSION, 4);
+    put_le(archive + 12, BENCH_FILES, 4);
+    put_le(archive + 16, strings, 8);
+    put_le(archive + 24, strings_length, 8);
+    
+    size_t path_offset = 0;
+    for (int i = 0; i < BENCH_FILES; i++) {
+        unsigned char* entry = archive + ASSET_ARCHIVE_HEADER_SIZE + i * ASSET_ARCHIVE_ENTRY_SIZE;
+        size_t path_length = strlen(g_files[i].path);
+        put_le(entry, offsets[i], 8);
+        put_le(entry + 8, lengths[i], 8);
+        put_le(entry + 16, g_files[i].size, 8);
+        put_le(entry + 24, path_offset, 4);
+        put_le(entry + 28, path_length, 4);
+        put_le(entry + 32, crc32(0, g_files[i].data, (uInt)g_files[i].size), 4);
+        put_le(entry + 36, blobs[i] ? ASSET_ENCODING_GZIP : ASSET_ENCODING_NONE, 4);
+        memcpy(archive + strings + path_offset, g_files[i].path, path_length);
+        memcpy(archive + offsets[i], blobs[i] ? blobs[i] : g_files[i].data, lengths[i]);
+        path_offset += path_length;
+        free(blobs[i]);
+    }
+    
+    FILE* out = fopen(path, "wb");
+    int ok = out && fwrite(archive, 1, size, out) == size && fflush(out) == 0;
+#ifdef __linux__
+    if (ok) fsync(fileno(out));  // Dirty pages can't be dropped from the cache
+#endif
+    if (out) fclose(out);
+    free(archive);
+    return ok ? size : 0;
+}
+
+// Returns 1 if the archive is no longer cached, 0 if the load stays warm
+static int drop_from_cache(const char* path) {
+#ifdef __linux__
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    int dropped = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+    close(fd);
+    return dropped;
+#else
+    (void)path;
+    return 0;
+#endif
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double da = *(const double*)a, db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+// Map the archive and serve every asset, reading each body the way the
+// engine does when it copies the response
+static double load_all(const char* path, const char* accept_encoding, volatile unsigned int* sink) {
+    double start = now_us();
+    asset_server_t server;
+    if (!asset_server_init(&server, path, 0)) return -1.0;
+    
+    for (int i = 0; i < BENCH_FILES; i++) {
+        char request[64];
+        snprintf(request, sizeof(request), "/%s", g_files[i].path);
+        asset_response_t response;
+        asset_server_handle(&server, request, NULL, NULL, accept_encoding, &response);
+        unsigned int sum = 0;
+        for (size_t j = 0; j < response.length; j += 64) {
+            sum += response.body[j];
+        }
+        *sink += sum + (unsigned int)response.status;
+        asset_response_free(&response);
+    }
+    asset_server_free(&server);
+    return now_us() - start;
+}
+
+static int run(const char* name, const char* path, const char* accept_encoding, size_t size) {
+    double samples[BENCH_ROUNDS];
+    volatile unsigned int sink = 0;
+    int cold = 1;
+    for (int i = 0; i < BENCH_ROUNDS; i++) {
+        cold &= drop_from_cache(path);
+        samples[i] = load_all(path, accept_encoding, &sink);
+        if (samples[i] < 0) {
+            fprintf(stderr, "Failed to load %s\n", path);
+            return 0;
+        }
+    }
+    qsort(samples, BENCH_ROUNDS, sizeof(double), compare_doubles);
+    printf("  %-24s %8.1f KB   %s p50 %9.1f us   p99 %9.1f us\n", name, (double)size / 1024.0,
+           cold ? "cold" : "warm", samples[BENCH_ROUNDS / 2], samples[(BENCH_ROUNDS * 99) / 100]);
+    return 1;
+}
+
+int main(void) {
+    size_t total = 0;
+    for (int i = 0; i < BENCH_FILES; i++) {
+        g_files[i].data = (unsigned char*)malloc(g_files[i].size);
+        if (!g_files[i].data) return 1;
+        if (g_files[i].compressible) {
+            fill_source(g_files[i].data, g_files[i].size);
+        } else {
+            for (size_t j = 0; j < g_files[i].size; j++) {
+                g_files[i].data[j] = (unsigned char)next_random();
+            }
+        }
+        total += g_files[i].size;
+    }
+    
+    const char* raw_path = "build/bench_assets_raw.pak";
+    const char* gzip_path = "build/bench_assets_gzip.pak";
+    size_t raw_size = write_archive(raw_path, 0);
+    size_t gzip_size = write_archive(gzip_path, 1);
+    if (!raw_size || !gzip_size) {
+        fprintf(stderr, "Failed to write the benchmark archives\n");
+        return 1;
+    }
+    
+    printf("⏱️  Asset archive load, %d assets / %.1f KB (%d rounds each)\n", BENCH_FILES, (double)total / 1024.0, BENCH_ROUNDS);
+    int ok = run("raw", raw_path, NULL, raw_size) &&
+             run("gzip, decoded in host", gzip_path, NULL, gzip_size) &&
+             run("gzip, passed through", gzip_path, "gzip", gzip_size);
+    
+    remove(raw_path);
+    remove(gzip_path);
+    for (int i = 0; i < BENCH_FILES; i++) {
+        free(g_files[i].data);
+    }
+    return ok ? 0 : 1;
+}
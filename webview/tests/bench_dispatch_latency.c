@@ -0,0 +1,139 @@
+/*
+ * Benchmark for cross-thread command completion latency
+ * 
+ * Simulates the webview_main flow: a reader thread hands a command to a
+ * "main loop" thread and waits for it to finish. Compares the old
+ * 10 ms sleep-polling wait with the event-driven ipc_completion_t wait
+ * and reports p50/p99 round-trip latency for each.
+ */
+
+#if !defined(_WIN32) && !defined(__APPLE__) && !defined(_GNU_SOURCE)
+#define _XOPEN_SOURCE 600  // clock_gettime and usleep under -std=c99
+#endif
+
+#include "../common/ipc_common.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_ITERATIONS 300
+
+static const char* BENCH_COMMAND = "{\"method\":\"window_set_position\",\"id\":\"1\",\"params\":{\"x\":10,\"y\":20}}";
+
+// Single-slot work queue standing in for webview_dispatch + the GTK main loop
+typedef struct {
+    ipc_completion_t* completion;  // Event-driven mode
+    volatile int* response_ready;  // Polling mode
+} bench_job_t;
+
+static ipc_completion_t g_queue_ready;
+static bench_job_t g_job;
+static volatile int g_main_loop_exit = 0;
+
+static double now_us(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1000000.0 / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000000.0 + (double)ts.tv_nsec / 1000.0;
+#endif
+}
+
+static THREAD_RETURN main_loop_thread(THREAD_ARG arg) {
+    (void)arg;
+    
+    while (1) {
+        ipc_completion_wait(&g_queue_ready, -1);
+        ipc_completion_destroy(&g_queue_ready);
+        ipc_completion_init(&g_queue_ready);
+        if (g_main_loop_exit) break;
+        
+        // Do the same parsing work a real handler does
+        ipc_command_t command;
+        ipc_command_parse(BENCH_COMMAND, &command);
+        volatile int x = ipc_command_get_int(&command, "x", 0);
+        (void)x;
+        ipc_command_release(&command);
+        
+        if (g_job.completion) {
+            ipc_completion_signal(g_job.completion);
+        } else {
+            *g_job.response_ready = 1;
+        }
+    }
+    return 0;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double da = *(const double*)a, db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+static void report(const char* name, double* samples, int count) {
+    qsort(samples, count, sizeof(double), compare_doubles);
+    printf("  %-22s p50 %9.1f us   p99 %9.1f us   max %9.1f us\n", name,
+           samples[count / 2], samples[(count * 99) / 100], samples[count - 1]);
+}
+
+static void run_polling(double* samples) {
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        volatile int response_ready = 0;
+        double start = now_us();
+        
+        g_job.completion = NULL;
+        g_job.response_ready = &response_ready;
+        ipc_completion_signal(&g_queue_ready);
+        
+        // Old stdin_monitor_thread wait loop
+        int timeout_count = 0;
+        while (!response_ready && timeout_count < 100) {
+            thread_sleep(10);
+            timeout_count++;
+        }
+        samples[i] = now_us() - start;
+    }
+}
+
+static void run_event_driven(double* samples) {
+    for (int i = 0; i < BENCH_ITERATIONS; i++) {
+        ipc_completion_t completion;
+        ipc_completion_init(&completion);
+        double start = now_us();
+        
+        g_job.completion = &completion;
+        g_job.response_ready = NULL;
+        ipc_completion_signal(&g_queue_ready);
+        
+        ipc_completion_wait(&completion, 1000);
+        samples[i] = now_us() - start;
+        ipc_completion_destroy(&completion);
+    }
+}
+
+int main(void) {
+    double* polling = (double*)malloc(sizeof(double) * BENCH_ITERATIONS);
+    double* event_driven = (double*)malloc(sizeof(double) * BENCH_ITERATIONS);
+    if (!polling || !event_driven) return 1;
+    
+    ipc_completion_init(&g_queue_ready);
+    ipc_thread_create(main_loop_thread, NULL);
+    
+    printf("⏱️  Command completion latency (%d round trips each)\n", BENCH_ITERATIONS);
+    run_polling(polling);
+    run_event_driven(event_driven);
+    report("sleep polling (10 ms)", polling, BENCH_ITERATIONS);
+    report("ipc_completion_t", event_driven, BENCH_ITERATIONS);
+    
+    g_main_loop_exit = 1;
+    ipc_completion_signal(&g_queue_ready);
+    thread_sleep(10);
+    
+    free(polling);
+    free(event_driven);
+    return 0;
+}
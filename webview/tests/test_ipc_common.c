@@ -5,7 +5,16 @@
  * work correctly with various inputs, edge cases, and error conditions.
  */
 
+#if !defined(_WIN32) && !defined(__APPLE__) && !defined(_GNU_SOURCE)
+#define _XOPEN_SOURCE 600  // usleep and fseeko under -std=c99
+#endif
+#ifndef _WIN32
+#define _FILE_OFFSET_BITS 64
+#endif
+
 #include "../common/ipc_common.h"
+#include "../common/asset_server.h"
+#include <zlib.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -213,6 +222,55 @@ int test_ipc_extract_param_json() {
     TEST_PASS();
 }
 
+int test_ipc_command_parse() {
+    TEST_START("ipc_command_parse and typed accessors");
+    
+    ipc_command_t cmd;
+    
+    // Test parsing once and reading several typed params from the tree
+    const char* json1 = "{\"method\":\"window_set_position\",\"id\":\"42\",\"params\":{\"x\":10,\"y\":-20,\"title\":\"Hi \\\"there\\\"\",\"opacity\":0.5,\"on_top\":true,\"flag\":0}}";
+    int result1 = ipc_command_parse(json1, &cmd);
+    TEST_ASSERT(result1 == 1, "Should return 1 for valid command");
+    TEST_ASSERT(strcmp(cmd.method, "window_set_position") == 0, "Method should be extracted correctly");
+    TEST_ASSERT(strcmp(cmd.id, "42") == 0, "ID should be extracted correctly");
+    TEST_ASSERT(ipc_command_get_int(&cmd, "x", 0) == 10, "Should read int param");
+    TEST_ASSERT(ipc_command_get_int(&cmd, "y", 0) == -20, "Should read negative int param");
+    TEST_ASSERT(strcmp(ipc_command_get_string(&cmd, "title", ""), "Hi \"there\"") == 0, "Should read unescaped string param");
+    float opacity = ipc_command_get_float(&cmd, "opacity", 1.0f);
+    TEST_ASSERT(opacity > 0.49f && opacity < 0.51f, "Should read float param");
+    TEST_ASSERT(ipc_command_get_bool(&cmd, "on_top", 0) == 1, "Should read bool param");
+    TEST_ASSERT(ipc_command_get_bool(&cmd, "flag", 1) == 0, "Should read numeric bool param");
+    
+    // Test defaults for missing or mistyped keys
+    TEST_ASSERT(ipc_command_get_int(&cmd, "missing", 999) == 999, "Should return default for missing int");
+    TEST_ASSERT(ipc_command_get_int(&cmd, "title", 999) == 999, "Should return default for non-number");
+    TEST_ASSERT(ipc_command_get_string(&cmd, "x", NULL) == NULL, "Should return default for non-string");
+    TEST_ASSERT(ipc_command_get_param(&cmd, "missing") == NULL, "Should return NULL for missing node");
+    ipc_command_release(&cmd);
+    TEST_ASSERT(cmd.root == NULL, "Release should clear the tree");
+    
+    // Test command without params
+    const char* json2 = "{\"method\":\"window_center\",\"id\":\"7\"}";
+    TEST_ASSERT(ipc_command_parse(json2, &cmd) == 1, "Should parse command without params");
+    TEST_ASSERT(cmd.params == NULL, "Params should be NULL when absent");
+    TEST_ASSERT(ipc_command_get_int(&cmd, "x", 5) == 5, "Accessors should handle missing params");
+    ipc_command_release(&cmd);
+    
+    // Test invalid commands keep a usable id for error reporting
+    TEST_ASSERT(ipc_command_parse(NULL, &cmd) == 0, "Should return 0 for NULL input");
+    TEST_ASSERT(strcmp(cmd.id, "unknown") == 0, "ID should default to unknown");
+    ipc_command_release(&cmd);
+    
+    TEST_ASSERT(ipc_command_parse("{\"id\":\"9\"}", &cmd) == 0, "Should return 0 without method");
+    TEST_ASSERT(strcmp(cmd.id, "9") == 0, "ID should be kept when method is missing");
+    ipc_command_release(&cmd);
+    
+    TEST_ASSERT(ipc_command_parse("{not json", &cmd) == 0, "Should return 0 for malformed JSON");
+    ipc_command_release(&cmd);
+    
+    TEST_PASS();
+}
+
 int test_ipc_write_response() {
     TEST_START("ipc_write_response");
     
@@ -639,6 +697,1015 @@ int test_large_payload_handling() {
     TEST_PASS();
 }
 
+int test_message_framing() {
+    TEST_START("line and length-prefixed message framing");
+    
+    // Build a payload well above the old 32 KB line ceiling
+    size_t payload_size = 200000;
+    char* payload = (char*)malloc(payload_size + 64);
+    TEST_ASSERT(payload != NULL, "Could not allocate payload");
+    strcpy(payload, "{\"method\":\"set_html\",\"id\":\"big\",\"params\":{\"html\":\"");
+    size_t pos = strlen(payload);
+    while (pos < payload_size) payload[pos++] = 'x';
+    strcpy(payload + pos, "\"}}");
+    size_t payload_len = strlen(payload);
+    
+    FILE* original_stdout = stdout;
+    ipc_framing_t modes[2] = { IPC_FRAMING_LINE, IPC_FRAMING_LENGTH };
+    
+    for (int m = 0; m < 2; m++) {
+        FILE* temp_file = tmpfile();
+        TEST_ASSERT(temp_file != NULL, "Could not create temporary file");
+        
+        ipc_set_framing(modes[m]);
+        stdout = temp_file;
+        ipc_write_message(payload, payload_len);
+        ipc_write_response("small", "true", NULL);
+        stdout = original_stdout;
+        rewind(temp_file);
+        
+        size_t len = 0;
+        char* first = ipc_read_message(temp_file, &len);
+        TEST_ASSERT(first != NULL, "Should read large message back");
+        TEST_ASSERT(len == payload_len && strcmp(first, payload) == 0, "Large message should round-trip intact");
+        
+        ipc_command_t cmd;
+        TEST_ASSERT(ipc_command_parse(first, &cmd) == 1, "Large message should parse as one command");
+        TEST_ASSERT(strlen(ipc_command_get_string(&cmd, "html", "")) == payload_size - strlen("{\"method\":\"set_html\",\"id\":\"big\",\"params\":{\"html\":\""), "Large param should be complete");
+        ipc_command_release(&cmd);
+        free(first);
+        
+        char* second = ipc_read_message(temp_file, &len);
+        TEST_ASSERT(second != NULL && strstr(second, "\"id\":\"small\"") != NULL, "Following message should stay separate");
+        free(second);
+        
+        TEST_ASSERT(ipc_read_message(temp_file, &len) == NULL, "Should return NULL at EOF");
+        fclose(temp_file);
+    }
+    
+    // Truncated frame is reported as end of input
+    FILE* temp_file = tmpfile();
+    TEST_ASSERT(temp_file != NULL, "Could not create temporary file");
+    const unsigned char truncated[] = { 0x00, 0x00, 0x01, 0x00, '{', '}' };
+    fwrite(truncated, 1, sizeof(truncated), temp_file);
+    rewind(temp_file);
+    TEST_ASSERT(ipc_read_message(temp_file, NULL) == NULL, "Truncated frame should not be returned");
+    fclose(temp_file);
+    
+    ipc_set_framing(IPC_FRAMING_LINE);
+    free(payload);
+    
+    TEST_PASS();
+}
+
+static THREAD_RETURN signal_completion_thread(THREAD_ARG arg) {
+    thread_sleep(20);
+    ipc_completion_signal((ipc_completion_t*)arg);
+    return 0;
+}
+
+int test_completion_signalling() {
+    TEST_START("completion signalling and timeouts");
+    
+    ipc_completion_t completion;
+    
+    // Signal from another thread wakes the waiter
+    ipc_completion_init(&completion);
+    ipc_thread_create(signal_completion_thread, &completion);
+    TEST_ASSERT(ipc_completion_wait(&completion, 5000) == 1, "Should complete when signalled");
+    TEST_ASSERT(completion.abandoned == 0, "Completed wait should not be abandoned");
+    ipc_completion_destroy(&completion);
+    
+    // Signal before wait returns immediately
+    ipc_completion_init(&completion);
+    TEST_ASSERT(ipc_completion_signal(&completion) == 0, "Signal without timeout should keep ownership with waiter");
+    TEST_ASSERT(ipc_completion_wait(&completion, 0) == 1, "Already signalled completion should not block");
+    ipc_completion_destroy(&completion);
+    
+    // Timeout hands ownership to the signaller
+    ipc_completion_init(&completion);
+    TEST_ASSERT(ipc_completion_wait(&completion, 10) == 0, "Should time out without a signal");
+    TEST_ASSERT(ipc_completion_signal(&completion) == 1, "Late signal should report the abandoned waiter");
+    ipc_completion_destroy(&completion);
+    
+    TEST_PASS();
+}
+
+int test_pipeline_deadlines() {
+    TEST_START("pipelined command window and deadlines");
+    
+    ipc_pipeline_t pipeline;
+    ipc_pipeline_entry_t slow, late, quick;
+    ipc_pipeline_init(&pipeline, 3, 5000);
+    
+    // Per-command deadline is parsed from the command line
+    ipc_command_t cmd;
+    TEST_ASSERT(ipc_command_parse("{\"method\":\"eval\",\"id\":\"late-id\",\"deadline_ms\":10}", &cmd) == 1, "Should parse command with deadline");
+    TEST_ASSERT(cmd.deadline_ms == 10, "Should read per-command deadline");
+    
+    TEST_ASSERT(ipc_pipeline_submit(&pipeline, &slow, "slow-id", 0) == 1, "Should submit with default deadline");
+    TEST_ASSERT(ipc_pipeline_submit(&pipeline, &late, cmd.id, cmd.deadline_ms) == 1, "Should submit with own deadline");
+    TEST_ASSERT(ipc_pipeline_submit(&pipeline, &quick, "quick-id", 0) == 1, "Should submit third command");
+    TEST_ASSERT(pipeline.in_flight == 3, "All three commands should be in flight");
+    ipc_command_release(&cmd);
+    
+    // Out-of-order start and finish are fine
+    TEST_ASSERT(ipc_pipeline_begin(&pipeline, &quick) == 1, "Pending command should start");
+    ipc_pipeline_end(&pipeline, &quick);
+    TEST_ASSERT(pipeline.in_flight == 2, "Finished command should free its slot");
+    TEST_ASSERT(ipc_pipeline_begin(&pipeline, &slow) == 1, "Running command is not expired");
+    
+    FILE* original_stdout = stdout;
+    FILE* temp_file = tmpfile();
+    TEST_ASSERT(temp_file != NULL, "Could not create temporary file");
+    stdout = temp_file;
+    thread_sleep(30);
+    long long next_wait = ipc_pipeline_expire_due(&pipeline);
+    stdout = original_stdout;
+    rewind(temp_file);
+    
+    char captured[1024];
+    size_t bytes_read = fread(captured, 1, sizeof(captured) - 1, temp_file);
+    captured[bytes_read] = '\0';
+    fclose(temp_file);
+    
+    TEST_ASSERT(strstr(captured, "\"id\":\"late-id\"") != NULL, "Deadline error should carry the real id");
+    TEST_ASSERT(strstr(captured, "Command deadline exceeded") != NULL, "Should report the deadline error");
+    TEST_ASSERT(strstr(captured, "slow-id") == NULL, "Started command should not be expired");
+    TEST_ASSERT(next_wait == -1, "No pending deadlines should remain");
+    TEST_ASSERT(pipeline.in_flight == 2, "Expired command should hold its slot until dropped");
+    
+    // The expired command is dropped when the main thread reaches it
+    TEST_ASSERT(ipc_pipeline_begin(&pipeline, &late) == 0, "Expired command should not run");
+    TEST_ASSERT(pipeline.in_flight == 1, "Dropping the expired command should free its slot");
+    ipc_pipeline_end(&pipeline, &slow);
+    TEST_ASSERT(pipeline.in_flight == 0 && pipeline.head == NULL, "Pipeline should be empty");
+    
+    ipc_pipeline_shutdown(&pipeline);
+    TEST_ASSERT(ipc_pipeline_submit(&pipeline, &quick, "after", 0) == 0, "Should refuse commands after shutdown");
+    ipc_pipeline_destroy(&pipeline);
+    
+    TEST_PASS();
+}
+
+static int test_method_calls = 0;
+
+static int count_method_handler(void* target, const ipc_command_t* command) {
+    (void)command;
+    (*(int*)target)++;
+    test_method_calls++;
+    return 0;
+}
+
+static int failing_method_handler(void* target, const ipc_command_t* command) {
+    (void)target;
+    (void)command;
+    return 7;
+}
+
+int test_method_table() {
+    TEST_START("perfect-hash method table");
+    
+    static const ipc_param_spec_t url_params[] = {{"url", IPC_PARAM_STRING, 1}, {NULL, IPC_PARAM_ANY, 0}};
+    static const ipc_param_spec_t size_params[] = {{"width", IPC_PARAM_NUMBER, 0}, {NULL, IPC_PARAM_ANY, 0}};
+    ipc_method_t methods[] = {
+        {"set_title", count_method_handler, NULL, 0, 0, 0, 0},
+        {"set_size", count_method_handler, size_params, 0, 0, 0, 0},
+        {"navigate", count_method_handler, url_params, 0, 0, 0, 0},
+        {"eval", failing_method_handler, NULL, 0, 0, 0, 0},
+        {"ipc:response", count_method_handler, NULL, 0, 0, 0, 0},
+        {"window_set_opacity", count_method_handler, NULL, 0, 0, 0, 0},
+        {"window_show", count_method_handler, NULL, 0, 0, 0, 0},
+        {"window_hide", count_method_handler, NULL, 0, 0, 0, 0},
+    };
+    int count = (int)(sizeof(methods) / sizeof(methods[0]));
+    ipc_method_table_t table;
+    
+    TEST_ASSERT(ipc_method_table_init(&table, methods, count) == 1, "Should build the method table");
+    for (int i = 0; i < count; i++) {
+        TEST_ASSERT(ipc_method_table_lookup(&table, methods[i].name) == &methods[i], "Every method should map to its own entry");
+    }
+    TEST_ASSERT(ipc_method_table_lookup(&table, "window_sho") == NULL, "Unknown names should not match");
+    TEST_ASSERT(ipc_method_table_lookup(&table, "") == NULL, "Empty name should not match");
+    
+    FILE* original_stdout = stdout;
+    FILE* temp_file = tmpfile();
+    TEST_ASSERT(temp_file != NULL, "Could not create temporary file");
+    stdout = temp_file;
+    
+    int target = 0;
+    int status = -1;
+    ipc_command_t cmd;
+    ipc_command_parse("{\"method\":\"navigate\",\"id\":\"nav-1\",\"params\":{\"url\":\"about:blank\"}}", &cmd);
+    ipc_dispatch_result_t ok = ipc_method_table_dispatch(&table, &target, &cmd, &status);
+    ipc_command_release(&cmd);
+    
+    ipc_command_parse("{\"method\":\"navigate\",\"id\":\"nav-2\",\"params\":{}}", &cmd);
+    ipc_dispatch_result_t missing = ipc_method_table_dispatch(&table, &target, &cmd, &status);
+    ipc_command_release(&cmd);
+    
+    ipc_command_parse("{\"method\":\"set_size\",\"id\":\"size-1\",\"params\":{\"width\":\"wide\"}}", &cmd);
+    ipc_dispatch_result_t mistyped = ipc_method_table_dispatch(&table, &target, &cmd, &status);
+    ipc_command_release(&cmd);
+    
+    ipc_command_parse("{\"method\":\"bogus\",\"id\":\"bogus-1\"}", &cmd);
+    ipc_dispatch_result_t unknown = ipc_method_table_dispatch(&table, &target, &cmd, &status);
+    ipc_command_release(&cmd);
+    
+    int failed_status = 0;
+    ipc_command_parse("{\"method\":\"eval\",\"id\":\"eval-1\"}", &cmd);
+    ipc_method_table_dispatch(&table, &target, &cmd, &failed_status);
+    ipc_command_release(&cmd);
+    
+    stdout = original_stdout;
+    rewind(temp_file);
+    char captured[1024];
+    size_t bytes_read = fread(captured, 1, sizeof(captured) - 1, temp_file);
+    captured[bytes_read] = '\0';
+    fclose(temp_file);
+    
+    TEST_ASSERT(ok == IPC_DISPATCH_OK && status == 0 && target == 1, "Valid command should run its handler");
+    TEST_ASSERT(missing == IPC_DISPATCH_INVALID_PARAMS, "Missing required param should be rejected");
+    TEST_ASSERT(mistyped == IPC_DISPATCH_INVALID_PARAMS, "Mistyped param should be rejected");
+    TEST_ASSERT(unknown == IPC_DISPATCH_UNKNOWN_METHOD, "Unknown method should be reported to the caller");
+    TEST_ASSERT(test_method_calls == 1, "Rejected commands should not reach handlers");
+    TEST_ASSERT(failed_status == 7, "Handler status should be returned");
+    TEST_ASSERT(strstr(captured, "\"id\":\"nav-2\"") != NULL && strstr(captured, "Missing required param: url") != NULL,
+                "Schema errors should be answered under the command id");
+    TEST_ASSERT(strstr(captured, "Invalid type for param: width") != NULL, "Type errors should name the param");
+    TEST_ASSERT(strstr(captured, "bogus-1") == NULL, "Unknown methods are answered by the caller");
+    
+    TEST_ASSERT(methods[2].calls == 1 && methods[2].errors == 1, "Navigate metrics should count calls and rejections");
+    TEST_ASSERT(methods[3].calls == 1 && methods[3].errors == 1, "Failing handler should count as an error");
+    
+    char* metrics = ipc_method_table_metrics_json(&table);
+    TEST_ASSERT(metrics != NULL, "Should serialize metrics");
+    TEST_ASSERT(strstr(metrics, "\"navigate\":{\"calls\":1,\"errors\":1") != NULL, "Metrics should be keyed by method");
+    free(metrics);
+    ipc_method_table_destroy(&table);
+    
+    // Duplicate registrations are a programming error
+    ipc_method_t duplicates[] = {
+        {"eval", count_method_handler, NULL, 0, 0, 0, 0},
+        {"eval", failing_method_handler, NULL, 0, 0, 0, 0},
+    };
+    TEST_ASSERT(ipc_method_table_init(&table, duplicates, 2) == 0, "Duplicate method names should be rejected");
+    
+    TEST_PASS();
+}
+
+int test_command_pool() {
+    TEST_START("pooled commands and arenas");
+    
+    ipc_command_pool_t pool;
+    ipc_command_pool_init(&pool, 2);
+    
+    // A parsed command lives entirely in its arena
+    ipc_pooled_command_t* cmd = ipc_command_pool_acquire(&pool, &pool);
+    TEST_ASSERT(cmd != NULL && cmd->context == &pool, "Should acquire a command object");
+    TEST_ASSERT(ipc_command_pool_parse(cmd, "{\"method\":\"set_html\",\"id\":\"html-1\",\"params\":{\"html\":\"<p>hi</p>\"}}") == 1,
+                "Should parse into the arena");
+    TEST_ASSERT(strcmp(cmd->command.method, "set_html") == 0, "Method should be parsed");
+    TEST_ASSERT(strcmp(ipc_command_get_string(&cmd->command, "html", ""), "<p>hi</p>") == 0, "Params should be readable");
+    TEST_ASSERT(cmd->arena.head != NULL && cmd->arena.head->used > 0, "Tree should be allocated from the arena");
+    
+    void* scratch = ipc_arena_alloc(&cmd->arena, 3);
+    TEST_ASSERT(scratch != NULL && ((size_t)scratch % 16) == 0, "Arena allocations should be aligned");
+    
+    // Steady state: the same object and arena block come back
+    ipc_arena_block_t* block = cmd->arena.head;
+    ipc_pooled_command_t* first = cmd;
+    ipc_command_pool_release(cmd);
+    cmd = ipc_command_pool_acquire(&pool, NULL);
+    TEST_ASSERT(cmd == first, "Released command should be reused");
+    TEST_ASSERT(cmd->arena.head == block && block->used == 0, "Arena block should be kept and reset");
+    TEST_ASSERT(pool.created == 1, "No new command object should be allocated");
+    
+    // A big command grows the arena; an outlier beyond the retain limit is dropped on reset
+    size_t big_length = IPC_ARENA_RETAIN_LIMIT + 1024;
+    char* big = (char*)malloc(big_length + 64);
+    TEST_ASSERT(big != NULL, "Could not allocate big command");
+    int offset = sprintf(big, "{\"method\":\"eval\",\"id\":\"big\",\"params\":{\"js\":\"");
+    memset(big + offset, 'x', big_length);
+    strcpy(big + offset + big_length, "\"}}");
+    TEST_ASSERT(ipc_command_pool_parse(cmd, big) == 1, "Should parse a command larger than one block");
+    TEST_ASSERT(strlen(ipc_command_get_string(&cmd->command, "js", "")) == big_length, "Large param should be intact");
+    free(big);
+    ipc_command_pool_release(cmd);
+    cmd = ipc_command_pool_acquire(&pool, NULL);
+    TEST_ASSERT(cmd->arena.head == NULL, "Oversized arena block should not be retained");
+    
+    // Invalid commands still report their id and release cleanly
+    TEST_ASSERT(ipc_command_pool_parse(cmd, "{\"id\":\"no-method\"}") == 0, "Should reject command without method");
+    TEST_ASSERT(strcmp(cmd->command.id, "no-method") == 0, "Id should survive a failed parse");
+    TEST_ASSERT(ipc_command_pool_parse(cmd, "{\"method\":") == 0, "Should reject truncated JSON");
+    ipc_command_pool_release(cmd);
+    
+    // Heap-parsed commands are unaffected by the arena hooks
+    ipc_command_t heap_cmd;
+    TEST_ASSERT(ipc_command_parse("{\"method\":\"eval\",\"id\":\"heap\"}", &heap_cmd) == 1, "Heap parse should still work");
+    char* printed = cJSON_PrintUnformatted(heap_cmd.root);
+    TEST_ASSERT(printed != NULL && strstr(printed, "\"heap\"") != NULL, "Printing should use the heap");
+    cJSON_free(printed);
+    ipc_command_release(&heap_cmd);
+    
+    // More concurrent commands than the freelist holds: extras are freed on release
+    ipc_pooled_command_t* held[3];
+    for (int i = 0; i < 3; i++) held[i] = ipc_command_pool_acquire(&pool, NULL);
+    for (int i = 0; i < 3; i++) ipc_command_pool_release(held[i]);
+    TEST_ASSERT(pool.free_count == 2, "Freelist should be capped");
+    
+    ipc_command_pool_destroy(&pool);
+    
+    // The reader reuses one buffer across messages
+    FILE* input = tmpfile();
+    TEST_ASSERT(input != NULL, "Could not create temporary file");
+    fputs("{\"method\":\"a\",\"id\":\"1\"}\n{\"method\":\"b\",\"id\":\"2\"}\n", input);
+    rewind(input);
+    ipc_reader_t reader;
+    ipc_reader_init(&reader);
+    size_t length = 0;
+    const char* first_line = ipc_reader_next(&reader, input, &length);
+    TEST_ASSERT(first_line != NULL && strstr(first_line, "\"a\"") != NULL, "Should read the first message");
+    const char* second_line = ipc_reader_next(&reader, input, &length);
+    TEST_ASSERT(second_line == first_line && strstr(second_line, "\"b\"") != NULL, "Should reuse the buffer");
+    TEST_ASSERT(ipc_reader_next(&reader, input, &length) == NULL, "Should report EOF");
+    ipc_reader_destroy(&reader);
+    fclose(input);
+    
+    TEST_PASS();
+}
+
+static void batch_test_runner(void* target, const ipc_command_t* command) {
+    (*(int*)target)++;
+    if (strcmp(command->method, "ok") == 0) {
+        ipc_write_response(command->id, ipc_command_get_string(command, "value", "true"), NULL);
+    } else if (strcmp(command->method, "json") == 0) {
+        ipc_write_json_response(command->id, "{\"a\":1}", NULL);
+    } else if (strcmp(command->method, "fail") == 0) {
+        ipc_write_response(command->id, "true", NULL);
+        ipc_write_response(command->id, NULL, "WebView error: 2");
+    } else if (strcmp(command->method, "target") == 0) {
+        char target[16];
+        snprintf(target, sizeof(target), "%d", command->target);
+        ipc_write_response(command->id, target, NULL);
+    }
+}
+
+static int run_test_batch(const char* json, char* captured, size_t captured_size) {
+    int runs = 0;
+    ipc_command_t cmd;
+    ipc_command_parse(json, &cmd);
+    
+    FILE* original_stdout = stdout;
+    FILE* temp_file = tmpfile();
+    stdout = temp_file;
+    ipc_run_batch(&cmd, batch_test_runner, &runs);
+    stdout = original_stdout;
+    
+    rewind(temp_file);
+    size_t bytes_read = fread(captured, 1, captured_size - 1, temp_file);
+    captured[bytes_read] = '\0';
+    fclose(temp_file);
+    ipc_command_release(&cmd);
+    return runs;
+}
+
+int test_batch_commands() {
+    TEST_START("batched commands");
+    
+    char captured[2048];
+    int runs = run_test_batch("{\"method\":\"batch\",\"id\":\"b1\",\"params\":{\"commands\":["
+                              "{\"method\":\"ok\",\"params\":{\"value\":\"yes\"}},"
+                              "{\"method\":\"json\"},"
+                              "{\"method\":\"silent\"}]}}", captured, sizeof(captured));
+    TEST_ASSERT(runs == 3, "Every sub-command should run");
+    TEST_ASSERT(strstr(captured, "\"id\":\"b1\"") != NULL, "Batch should answer under its own id");
+    TEST_ASSERT(strstr(captured, "\"result\":[{\"result\":\"yes\"},{\"result\":{\"a\":1}},{\"result\":null}]") != NULL,
+                "Results should be collected in order");
+    TEST_ASSERT(strchr(captured, '\n') == strrchr(captured, '\n'), "Batch should write exactly one message");
+    
+    runs = run_test_batch("{\"method\":\"batch\",\"id\":\"b2\",\"params\":{\"commands\":["
+                          "{\"method\":\"ok\"},{\"method\":\"fail\"},{\"method\":\"ok\"},{\"method\":\"batch\"}]}}",
+                          captured, sizeof(captured));
+    TEST_ASSERT(runs == 2, "Commands after a failure should be skipped");
+    TEST_ASSERT(strstr(captured, "{\"error\":\"WebView error: 2\"}") != NULL, "Last write for a sub-command should win");
+    TEST_ASSERT(strstr(captured, "Skipped after an earlier error") != NULL, "Skipped commands should be reported");
+    
+    runs = run_test_batch("{\"method\":\"batch\",\"id\":\"b3\",\"params\":{\"stop_on_error\":false,\"commands\":["
+                          "{\"method\":\"fail\"},{\"method\":\"ok\"},{\"params\":{}},{\"method\":\"batch\"}]}}",
+                          captured, sizeof(captured));
+    TEST_ASSERT(runs == 2, "Without stop_on_error every valid command should run");
+    TEST_ASSERT(strstr(captured, "{\"error\":\"Invalid command format\"}") != NULL, "Sub-command without method should fail");
+    TEST_ASSERT(strstr(captured, "Nested batches are not supported") != NULL, "Nested batches should be rejected");
+    
+    // Outside a batch, responses go straight to stdout again
+    FILE* original_stdout = stdout;
+    FILE* temp_file = tmpfile();
+    stdout = temp_file;
+    ipc_write_response("after", "true", NULL);
+    stdout = original_stdout;
+    TEST_ASSERT(ftell(temp_file) > 0, "Capture should end with the batch");
+    fclose(temp_file);
+    
+    TEST_PASS();
+}
+
+int test_raw_passthrough() {
+    TEST_START("raw passthrough of ipc:response results");
+    
+    // Member spans are found without parsing, whatever the nesting or escaping
+    const char* object = "{ \"a\" : [1, {\"x\": \"}\"}], \"b\":\"q\\\"}\" ,\"c\":-1.5e3,\"d\":{\"e\":null}}";
+    const char* value;
+    size_t value_length;
+    TEST_ASSERT(ipc_json_find_member(object, strlen(object), "a", &value, &value_length) == 1, "Should find array member");
+    TEST_ASSERT(value_length == strlen("[1, {\"x\": \"}\"}]") && strncmp(value, "[1, {\"x\": \"}\"}]", value_length) == 0, "Array span should be exact");
+    TEST_ASSERT(ipc_json_find_member(object, strlen(object), "b", &value, &value_length) == 1, "Should find string member");
+    TEST_ASSERT(strncmp(value, "\"q\\\"}\"", value_length) == 0, "String span should include escapes");
+    TEST_ASSERT(ipc_json_find_member(object, strlen(object), "c", &value, &value_length) == 1 && strncmp(value, "-1.5e3", value_length) == 0,
+                "Should find number member");
+    TEST_ASSERT(ipc_json_find_member(object, strlen(object), "d", &value, &value_length) == 1 && strncmp(value, "{\"e\":null}", value_length) == 0,
+                "Should find object member");
+    TEST_ASSERT(ipc_json_find_member(object, strlen(object), "e", &value, &value_length) == 0, "Nested keys are not members");
+    TEST_ASSERT(ipc_json_find_member("{\"a\":[1,2", 9, "a", &value, &value_length) == 0, "Truncated text should not match");
+    TEST_ASSERT(ipc_json_find_member("[1]", 3, "a", &value, &value_length) == 0, "Non-objects have no members");
+    
+    // Invoke arguments arrive as [channel, data] and are split the same way
+    const char* args = "[\"getData\", {\"userId\":123,\"tags\":[\"a,b\"]}]";
+    TEST_ASSERT(ipc_json_find_element(args, strlen(args), 0, &value, &value_length) == 1 && strncmp(value, "\"getData\"", value_length) == 0,
+                "Should find first element");
+    TEST_ASSERT(ipc_json_find_element(args, strlen(args), 1, &value, &value_length) == 1 &&
+                strncmp(value, "{\"userId\":123,\"tags\":[\"a,b\"]}", value_length) == 0 &&
+                value_length == strlen("{\"userId\":123,\"tags\":[\"a,b\"]}"), "Should find second element");
+    TEST_ASSERT(ipc_json_find_element(args, strlen(args), 2, &value, &value_length) == 0, "Out of range element should not match");
+    TEST_ASSERT(ipc_json_find_element("[]", 2, 0, &value, &value_length) == 0, "Empty array has no elements");
+    
+    ipc_command_pool_t pool;
+    ipc_command_pool_init(&pool, 1);
+    ipc_command_pool_set_passthrough(&pool, "ipc:response", "result");
+    
+    const char* response = "{\"method\":\"ipc:response\",\"id\":\"seq-1\",\"params\":{\"id\":\"seq-1\","
+                           "\"result\":{\"rows\":[1,2.50,\"\\u00e9\"],\"ok\":true} ,\"echo\":true}}";
+    ipc_pooled_command_t* cmd = ipc_command_pool_acquire(&pool, NULL);
+    TEST_ASSERT(ipc_command_pool_parse(cmd, response) == 1, "Should parse passthrough command");
+    size_t raw_length = 0;
+    const char* raw = ipc_command_get_raw_param(&cmd->command, "result", &raw_length);
+    TEST_ASSERT(raw != NULL && strcmp(raw, "{\"rows\":[1,2.50,\"\\u00e9\"],\"ok\":true}") == 0, "Result bytes should be untouched");
+    TEST_ASSERT(raw_length == strlen(raw), "Raw length should match");
+    TEST_ASSERT(cJSON_IsNull(ipc_command_get_param(&cmd->command, "result")), "Result should not be parsed into the tree");
+    TEST_ASSERT(strcmp(ipc_command_get_string(&cmd->command, "id", ""), "seq-1") == 0, "Other params should be parsed");
+    TEST_ASSERT(ipc_command_get_bool(&cmd->command, "echo", 0) == 1, "Params after the result should be parsed");
+    ipc_command_pool_release(cmd);
+    
+    // Other methods are parsed normally
+    cmd = ipc_command_pool_acquire(&pool, NULL);
+    TEST_ASSERT(ipc_command_pool_parse(cmd, "{\"method\":\"eval\",\"id\":\"e\",\"params\":{\"result\":[1]}}") == 1, "Should parse other method");
+    TEST_ASSERT(ipc_command_get_raw_param(&cmd->command, "result", NULL) == NULL, "Other methods have no raw params");
+    TEST_ASSERT(cJSON_IsArray(ipc_command_get_param(&cmd->command, "result")), "Other methods keep their tree");
+    ipc_command_pool_release(cmd);
+    
+    ipc_command_pool_destroy(&pool);
+    TEST_PASS();
+}
+
+static int read_captured(FILE* temp_file, char* captured, size_t size) {
+    rewind(temp_file);
+    size_t bytes_read = fread(captured, 1, size - 1, temp_file);
+    captured[bytes_read] = '\0';
+    return (int)bytes_read;
+}
+
+int test_json_string_escaping() {
+    TEST_START("JSON string escaping in writers");
+    
+    FILE* original_stdout = stdout;
+    FILE* temp_file = tmpfile();
+    TEST_ASSERT(temp_file != NULL, "Could not create temporary file");
+    char captured[4096];
+    
+    // Every special character, at every offset of the 8-byte scan
+    const char* specials = "\"\\\n\r\t\b\f\x01\x1f";
+    for (size_t s = 0; specials[s]; s++) {
+        for (int offset = 0; offset < 20; offset++) {
+            char text[64];
+            memset(text, 'a', sizeof(text));
+            text[offset] = specials[s];
+            text[offset + 21] = '\0';
+            
+            FILE* message_file = tmpfile();
+            TEST_ASSERT(message_file != NULL, "Could not create temporary file");
+            stdout = message_file;
+            ipc_write_response("esc", NULL, text);
+            stdout = original_stdout;
+            int length = read_captured(message_file, captured, sizeof(captured));
+            fclose(message_file);
+            
+            char* newline = strchr(captured, '\n');
+            TEST_ASSERT(newline != NULL && newline - captured == length - 1, "Message should stay on one line");
+            *newline = '\0';
+            cJSON* parsed = cJSON_Parse(captured);
+            TEST_ASSERT(parsed != NULL, "Escaped message should be valid JSON");
+            cJSON* error = cJSON_GetObjectItem(parsed, "error");
+            TEST_ASSERT(cJSON_IsString(error) && strcmp(error->valuestring, text) == 0, "Error text should round-trip");
+            cJSON_Delete(parsed);
+        }
+    }
+    
+    // Ids, event names and UTF-8 text are escaped but otherwise untouched
+    stdout = temp_file;
+    ipc_write_response("id \"with\" quotes", "caf\xc3\xa9 \xe2\x9c\x93", NULL);
+    ipc_write_event_string("menu_click", "menuId", "item\n\"1\"");
+    ipc_write_json_response("json\\id", "{\"raw\":[1,2]}", NULL);
+    stdout = original_stdout;
+    read_captured(temp_file, captured, sizeof(captured));
+    fclose(temp_file);
+    
+    TEST_ASSERT(strstr(captured, "\"id\":\"id \\\"with\\\" quotes\",\"result\":\"caf\xc3\xa9 \xe2\x9c\x93\"") != NULL,
+                "Id should be escaped and UTF-8 passed through");
+    TEST_ASSERT(strstr(captured, "{\"type\":\"menu_click\",\"data\":{\"menuId\":\"item\\n\\\"1\\\"\"}}") != NULL,
+                "Event field should be escaped");
+    TEST_ASSERT(strstr(captured, "\"id\":\"json\\\\id\",\"result\":{\"raw\":[1,2]}") != NULL, "Raw JSON results are not escaped");
+    
+    int lines = 0;
+    for (char* p = captured; *p; p++) if (*p == '\n') lines++;
+    TEST_ASSERT(lines == 3, "Each message should be exactly one line");
+    
+    // Messages larger than the inline buffer
+    ipc_json_writer_t writer;
+    ipc_json_writer_begin(&writer);
+    char big[3000];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    big[1500] = '"';
+    ipc_json_writer_string(&writer, big);
+    TEST_ASSERT(!writer.failed && writer.length == IPC_FRAME_HEADER_LENGTH + sizeof(big) + 2, "Large string should grow the buffer");
+    TEST_ASSERT(memcmp(writer.data + IPC_FRAME_HEADER_LENGTH + 1500, "x\\\"", 3) == 0, "Quote should be escaped in place");
+    
+    temp_file = tmpfile();
+    stdout = temp_file;
+    TEST_ASSERT(ipc_json_writer_send(&writer) == 1, "Should send a large message");
+    stdout = original_stdout;
+    fseek(temp_file, 0, SEEK_END);
+    TEST_ASSERT(ftell(temp_file) == (long)(sizeof(big) + 3), "Whole message should be written");
+    fclose(temp_file);
+    
+    TEST_PASS();
+}
+
+int test_base64_params() {
+    TEST_START("Base64 parameter decoding");
+    
+    unsigned char out[32];
+    TEST_ASSERT(ipc_base64_decode("aGVsbG8=", 8, out) == 5 && memcmp(out, "hello", 5) == 0, "Should decode padded text");
+    TEST_ASSERT(ipc_base64_decode("aGVsbG8", 7, out) == 5 && memcmp(out, "hello", 5) == 0, "Padding should be optional");
+    TEST_ASSERT(ipc_base64_decode("", 0, out) == 0, "Empty text decodes to nothing");
+    TEST_ASSERT(ipc_base64_decode("+/8=", 4, out) == 2 && out[0] == 0xfb && out[1] == 0xff, "Should decode standard alphabet");
+    TEST_ASSERT(ipc_base64_decode("-_8", 3, out) == 2 && out[0] == 0xfb && out[1] == 0xff, "Should decode URL-safe alphabet");
+    TEST_ASSERT(ipc_base64_decode("aGV*bG8=", 8, out) == (size_t)-1, "Should reject invalid characters");
+    TEST_ASSERT(ipc_base64_decode("aGVsb", 5, out) == (size_t)-1, "Should reject impossible lengths");
+    TEST_ASSERT(ipc_base64_decode("aG=Vs", 5, out) == (size_t)-1, "Should reject data after padding");
+    
+    ipc_command_pool_t pool;
+    ipc_command_pool_init(&pool, 1);
+    ipc_pooled_command_t* cmd = ipc_command_pool_acquire(&pool, NULL);
+    TEST_ASSERT(ipc_command_pool_parse(cmd, "{\"method\":\"tray_set_icon_data\",\"id\":\"i\","
+                                            "\"params\":{\"data\":\"iVBORw0KGgo=\",\"bad\":\"@@\",\"n\":1}}") == 1,
+                "Should parse icon command");
+    size_t length = 0;
+    const unsigned char* png = ipc_command_get_base64(&cmd->command, "data", &length);
+    TEST_ASSERT(png != NULL && length == 8 && memcmp(png, "\x89PNG\r\n\x1a\n", 8) == 0, "Should decode PNG signature");
+    TEST_ASSERT(ipc_command_get_base64(&cmd->command, "bad", &length) == NULL, "Invalid base64 param should be NULL");
+    TEST_ASSERT(ipc_command_get_base64(&cmd->command, "n", &length) == NULL, "Non-string param should be NULL");
+    TEST_ASSERT(ipc_command_get_base64(&cmd->command, "missing", &length) == NULL, "Missing param should be NULL");
+    ipc_command_pool_release(cmd);
+    ipc_command_pool_destroy(&pool);
+    
+    TEST_PASS();
+}
+
+int test_command_target() {
+    TEST_START("Host target handles");
+    
+    ipc_command_t cmd;
+    TEST_ASSERT(ipc_command_parse("{\"method\":\"eval\",\"id\":\"1\",\"target\":7}", &cmd) == 1, "Should parse targeted command");
+    TEST_ASSERT(cmd.target == 7, "Should read the target handle");
+    ipc_command_release(&cmd);
+    TEST_ASSERT(cmd.target == -1, "Release should clear the target");
+    
+    TEST_ASSERT(ipc_command_parse("{\"method\":\"eval\",\"id\":\"2\"}", &cmd) == 1, "Should parse untargeted command");
+    TEST_ASSERT(cmd.target == -1, "Missing target should be -1");
+    ipc_command_release(&cmd);
+    
+    TEST_ASSERT(ipc_command_parse("{\"method\":\"eval\",\"id\":\"3\",\"target\":\"7\"}", &cmd) == 1, "Should parse string target");
+    TEST_ASSERT(cmd.target == -1, "Non-numeric target should be ignored");
+    ipc_command_release(&cmd);
+    
+    char captured[512];
+    int runs = run_test_batch("{\"method\":\"batch\",\"id\":\"b\",\"target\":3,"
+                              "\"params\":{\"commands\":[{\"method\":\"target\"}]}}", captured, sizeof(captured));
+    TEST_ASSERT(runs == 1, "Should run the sub-command");
+    TEST_ASSERT(strstr(captured, "\"result\":\"3\"") != NULL, "Sub-commands should inherit the batch target");
+    
+    TEST_PASS();
+}
+
+int test_asset_paths() {
+    TEST_START("Asset path resolution");
+    
+    char out[256];
+    TEST_ASSERT(asset_resolve_path("/", out, sizeof(out)) && strcmp(out, "index.html") == 0, "Root should serve index.html");
+    TEST_ASSERT(asset_resolve_path("/app/main.js", out, sizeof(out)) && strcmp(out, "app/main.js") == 0, "Should strip the leading slash");
+    TEST_ASSERT(asset_resolve_path("/docs/", out, sizeof(out)) && strcmp(out, "docs/index.html") == 0, "Directories should serve index.html");
+    TEST_ASSERT(asset_resolve_path("/a//./b%20c.css", out, sizeof(out)) && strcmp(out, "a/b c.css") == 0, "Should decode and normalize");
+    TEST_ASSERT(!asset_resolve_path("/../secret", out, sizeof(out)), "Should refuse parent segments");
+    TEST_ASSERT(!asset_resolve_path("/a/%2e%2e/%2e%2e/secret", out, sizeof(out)), "Should refuse encoded parent segments");
+    TEST_ASSERT(!asset_resolve_path("/a%2fb", out, sizeof(out)), "Should refuse encoded separators");
+    TEST_ASSERT(!asset_resolve_path("/a%00b", out, sizeof(out)), "Should refuse encoded NUL");
+    TEST_ASSERT(!asset_resolve_path("/..\\secret", out, sizeof(out)), "Should refuse backslashes");
+    TEST_ASSERT(!asset_resolve_path("/C:/secret", out, sizeof(out)), "Should refuse drive letters");
+    
+    TEST_ASSERT(strcmp(asset_mime_type("app/main.JS"), "text/javascript; charset=utf-8") == 0, "Extensions should be case-insensitive");
+    TEST_ASSERT(strcmp(asset_mime_type("font.woff2"), "font/woff2") == 0, "Should know woff2");
+    TEST_ASSERT(strcmp(asset_mime_type("v1.0/LICENSE"), "application/octet-stream") == 0, "Dots in directories don't count");
+    
+    TEST_PASS();
+}
+
+int test_asset_ranges() {
+    TEST_START("Asset byte ranges");
+    
+    long long start = -1, end = -1;
+    TEST_ASSERT(asset_parse_range("bytes=0-99", 1000, &start, &end) == 1 && start == 0 && end == 99, "Should parse a closed range");
+    TEST_ASSERT(asset_parse_range("bytes=900-", 1000, &start, &end) == 1 && start == 900 && end == 999, "Should parse an open range");
+    TEST_ASSERT(asset_parse_range("bytes=-100", 1000, &start, &end) == 1 && start == 900 && end == 999, "Should parse a suffix range");
+    TEST_ASSERT(asset_parse_range("bytes=-5000", 1000, &start, &end) == 1 && start == 0, "Long suffixes cover the asset");
+    TEST_ASSERT(asset_parse_range("bytes=500-5000", 1000, &start, &end) == 1 && end == 999, "Should clamp the end");
+    TEST_ASSERT(asset_parse_range("bytes=1000-", 1000, &start, &end) == -1, "Should report unsatisfiable ranges");
+    TEST_ASSERT(asset_parse_range("bytes=0-1,5-6", 1000, &start, &end) == 0, "Multiple ranges serve everything");
+    TEST_ASSERT(asset_parse_range("bytes=9-3", 1000, &start, &end) == 0, "Inverted ranges are ignored");
+    TEST_ASSERT(asset_parse_range("items=0-1", 1000, &start, &end) == 0, "Other units are ignored");
+    TEST_ASSERT(asset_parse_range(NULL, 1000, &start, &end) == 0, "No header serves everything");
+    
+    // Served from this test's own source
+    asset_server_t server;
+    asset_response_t response;
+    TEST_ASSERT(asset_server_init(&server, "tests/", 0), "Should create the server");
+    
+    asset_server_handle(&server, "/test_ipc_common.c", "bytes=0-1", NULL, NULL, &response);
+    TEST_ASSERT(response.status == 206 && response.length == 2 && memcmp(response.body, "/*", 2) == 0, "Should serve the range");
+    TEST_ASSERT(strncmp(response.content_range, "bytes 0-1/", 10) == 0, "Should set Content-Range");
+    TEST_ASSERT(strcmp(response.cache_control, "no-cache") == 0, "max_age 0 should revalidate");
+    char etag[sizeof(response.etag)];
+    strcpy(etag, response.etag);
+    asset_response_free(&response);
+    
+    asset_server_handle(&server, "/test_ipc_common.c", NULL, NULL, NULL, &response);
+    TEST_ASSERT(response.status == 200 && response.body == NULL && response.owned == NULL, "Whole files should not be read");
+    TEST_ASSERT(response.file_path && strcmp(response.file_path, "tests/test_ipc_common.c") == 0, "Whole files should be streamed");
+    TEST_ASSERT(response.file_offset == 0 && (long long)response.length == response.total, "Should stream the whole file");
+    asset_response_free(&response);
+    
+    asset_server_handle(&server, "/test_ipc_common.c", NULL, etag, NULL, &response);
+    TEST_ASSERT(response.status == 304 && response.body == NULL, "Matching ETag should be 304");
+    asset_server_handle(&server, "/missing.js", NULL, NULL, NULL, &response);
+    TEST_ASSERT(response.status == 404, "Missing asset should be 404");
+    asset_server_handle(&server, "/../Makefile", NULL, NULL, NULL, &response);
+    TEST_ASSERT(response.status == 403, "Escaping the root should be 403");
+    asset_server_free(&server);
+    
+    TEST_PASS();
+}
+
+// Two assets, laid out as `tronbun build` writes them
+static size_t build_test_archive(unsigned char* buffer) {
+    static const char* paths[] = {"app.js", "index.html"};
+    static const char* contents[] = {"console.log(1)", "<html></html>"};
+    size_t strings = ASSET_ARCHIVE_HEADER_SIZE + 2 * ASSET_ARCHIVE_ENTRY_SIZE;
+    size_t offsets[2] = {128, 192};
+    
+    memset(buffer, 0, 256);
+    memcpy(buffer, ASSET_ARCHIVE_MAGIC, 8);
+    buffer[8] = ASSET_ARCHIVE_VERSION;
+    buffer[12] = 2;
+    buffer[16] = (unsigned char)strings;
+    buffer[24] = 16;
+    
+    size_t path_offset = 0;
+    for (int i = 0; i < 2; i++) {
+        unsigned char* entry = buffer + ASSET_ARCHIVE_HEADER_SIZE + i * ASSET_ARCHIVE_ENTRY_SIZE;
+        entry[0] = (unsigned char)offsets[i];
+        entry[8] = (unsigned char)strlen(contents[i]);
+        entry[16] = (unsigned char)strlen(contents[i]);
+        entry[24] = (unsigned char)path_offset;
+        entry[28] = (unsigned char)strlen(paths[i]);
+        entry[32] = (unsigned char)(0xa0 + i);
+        memcpy(buffer + strings + path_offset, paths[i], strlen(paths[i]));
+        memcpy(buffer + offsets[i], contents[i], strlen(contents[i]));
+        path_offset += strlen(paths[i]);
+    }
+    return offsets[1] + strlen(contents[1]);
+}
+
+int test_asset_archive() {
+    TEST_START("Asset archive lookups");
+    
+    unsigned char buffer[256];
+    size_t size = build_test_archive(buffer);
+    asset_archive_t archive;
+    asset_archive_entry_t entry;
+    TEST_ASSERT(asset_archive_open_memory(&archive, buffer, size), "Should open a valid archive");
+    TEST_ASSERT(archive.count == 2, "Should read the entry count");
+    TEST_ASSERT(asset_archive_find(&archive, "index.html", &entry), "Should find the last entry");
+    TEST_ASSERT(entry.length == 13 && memcmp(entry.data, "<html></html>", 13) == 0, "Should slice the blob");
+    TEST_ASSERT(entry.data == buffer + 192, "Slices should point into the archive");
+    TEST_ASSERT(asset_archive_find(&archive, "app.js", &entry) && entry.crc32 == 0xa0, "Should find the first entry");
+    TEST_ASSERT(!asset_archive_find(&archive, "app.j", &entry), "Prefixes should not match");
+    TEST_ASSERT(!asset_archive_find(&archive, "zzz", &entry), "Should miss unknown paths");
+    
+    TEST_ASSERT(!asset_archive_open_memory(&archive, buffer, size - 1), "Truncated blobs should be rejected");
+    buffer[ASSET_ARCHIVE_HEADER_SIZE + 28] = 200;
+    TEST_ASSERT(!asset_archive_open_memory(&archive, buffer, size), "Paths outside the string table should be rejected");
+    build_test_archive(buffer);
+    buffer[0] = 'X';
+    TEST_ASSERT(!asset_archive_open_memory(&archive, buffer, size), "Bad magic should be rejected");
+    
+    // Served from a mapped copy
+    build_test_archive(buffer);
+    const char* path = "build/test_assets.pak";
+    FILE* file = fopen(path, "wb");
+    TEST_ASSERT(file && fwrite(buffer, 1, size, file) == size, "Should write the archive");
+    fclose(file);
+    
+    asset_server_t server;
+    asset_response_t response;
+    TEST_ASSERT(asset_server_init(&server, path, 60) && server.has_archive, "Should map the archive");
+    asset_server_handle(&server, "/", "bytes=6-", NULL, NULL, &response);
+    TEST_ASSERT(response.status == 206 && response.length == 7 && memcmp(response.body, "</html>", 7) == 0, "Should serve a range of index.html");
+    TEST_ASSERT(response.owned == NULL, "Archive responses should not copy");
+    TEST_ASSERT(strcmp(response.etag, "\"a1-d\"") == 0, "ETag should come from the stored checksum");
+    TEST_ASSERT(strcmp(response.cache_control, "public, max-age=60") == 0, "Should set max-age");
+    asset_response_free(&response);
+    asset_server_handle(&server, "/missing.css", NULL, NULL, NULL, &response);
+    TEST_ASSERT(response.status == 404, "Missing entries should be 404");
+    asset_server_free(&server);
+    remove(path);
+    
+    TEST_PASS();
+}
+
+static void put_le(unsigned char* p, unsigned long long value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        p[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+// One gzip entry, app.js, holding text
+static size_t build_gzip_archive(unsigned char* buffer, size_t buffer_size, const char* text, size_t text_length) {
+    size_t blob = 128;
+    memset(buffer, 0, buffer_size);
+    
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    deflateInit2(&stream, 9, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+    stream.next_in = (Bytef*)text;
+    stream.avail_in = (uInt)text_length;
+    stream.next_out = buffer + blob;
+    stream.avail_out = (uInt)(buffer_size - blob);
+    deflate(&stream, Z_FINISH);
+    size_t stored = stream.total_out;
+    deflateEnd(&stream);
+    
+    size_t strings = ASSET_ARCHIVE_HEADER_SIZE + ASSET_ARCHIVE_ENTRY_SIZE;
+    memcpy(buffer, ASSET_ARCHIVE_MAGIC, 8);
+    put_le(buffer + 8, ASSET_ARCHIVE_VERSION, 4);
+    put_le(buffer + 12, 1, 4);
+    put_le(buffer + 16, strings, 8);
+    put_le(buffer + 24, 6, 8);
+    
+    unsigned char* entry = buffer + ASSET_ARCHIVE_HEADER_SIZE;
+    put_le(entry, blob, 8);
+    put_le(entry + 8, stored, 8);
+    put_le(entry + 16, text_length, 8);
+    put_le(entry + 28, 6, 4);
+    put_le(entry + 32, crc32(0, (const Bytef*)text, (uInt)text_length), 4);
+    put_le(entry + 36, ASSET_ENCODING_GZIP, 4);
+    memcpy(buffer + strings, "app.js", 6);
+    return blob + stored;
+}
+
+int test_asset_encodings() {
+    TEST_START("Compressed asset entries");
+    
+    TEST_ASSERT(asset_accepts_encoding("gzip, deflate, br", "gzip"), "Should find gzip in a list");
+    TEST_ASSERT(asset_accepts_encoding("br;q=1.0, GZIP;q=0.5", "gzip"), "Codings should be case-insensitive");
+    TEST_ASSERT(asset_accepts_encoding("*", "gzip"), "Wildcard should accept gzip");
+    TEST_ASSERT(!asset_accepts_encoding("gzip;q=0, *", "gzip"), "q=0 should refuse gzip");
+    TEST_ASSERT(!asset_accepts_encoding("identity", "gzip"), "Other codings should not match");
+    TEST_ASSERT(!asset_accepts_encoding(NULL, "gzip"), "No header should mean no encodings");
+    
+    char text[2000];
+    for (size_t i = 0; i < sizeof(text); i++) {
+        text[i] = "const x = 1;\n"[i % 13];
+    }
+    static unsigned char buffer[4096];
+    size_t size = build_gzip_archive(buffer, sizeof(buffer), text, sizeof(text));
+    size_t stored = size - 128;
+    TEST_ASSERT(stored < sizeof(text) / 10, "Test text should compress");
+    
+    const char* path = "build/test_assets_gzip.pak";
+    FILE* file = fopen(path, "wb");
+    TEST_ASSERT(file && fwrite(buffer, 1, size, file) == size, "Should write the archive");
+    fclose(file);
+    
+    asset_server_t server;
+    asset_response_t response;
+    TEST_ASSERT(asset_server_init(&server, path, 0), "Should map the archive");
+    asset_server_handle(&server, "/app.js", NULL, NULL, "gzip, br", &response);
+    TEST_ASSERT(response.status == 200 && response.length == stored, "Should pass the stored bytes through");
+    TEST_ASSERT(response.content_encoding && strcmp(response.content_encoding, "gzip") == 0, "Should label the encoding");
+    TEST_ASSERT(response.body == server.archive.data + 128 && response.owned == NULL, "Pass-through should not copy");
+    TEST_ASSERT(strstr(response.etag, "-gzip\"") != NULL, "Encoded responses need their own ETag");
+    asset_response_free(&response);
+    
+    asset_server_handle(&server, "/app.js", NULL, NULL, NULL, &response);
+    TEST_ASSERT(response.status == 200 && response.content_encoding == NULL, "Should decode without Accept-Encoding");
+    TEST_ASSERT(response.length == sizeof(text) && memcmp(response.body, text, sizeof(text)) == 0, "Should serve the decoded text");
+    TEST_ASSERT(response.owned == NULL && server.decoded_bytes == sizeof(text), "Decoded text should be cached");
+    const unsigned char* decoded = response.body;
+    asset_response_free(&response);
+    
+    asset_server_handle(&server, "/app.js", "bytes=13-25", NULL, "gzip", &response);
+    TEST_ASSERT(response.status == 206 && response.content_encoding == NULL, "Ranges should be served decoded");
+    TEST_ASSERT(response.body == decoded + 13 && response.length == 13, "Ranges should reuse the cache");
+    asset_response_free(&response);
+    asset_server_free(&server);
+    
+    // Damaged blobs fail the gzip checks instead of serving garbage
+    buffer[128 + stored / 2] ^= 0xff;
+    file = fopen(path, "wb");
+    TEST_ASSERT(file && fwrite(buffer, 1, size, file) == size, "Should rewrite the archive");
+    fclose(file);
+    TEST_ASSERT(asset_server_init(&server, path, 0), "Should map the damaged archive");
+    asset_server_handle(&server, "/app.js", NULL, NULL, NULL, &response);
+    TEST_ASSERT(response.status == 500 && response.body == NULL, "Corrupt entries should be 500");
+    asset_server_free(&server);
+    remove(path);
+    
+    TEST_PASS();
+}
+
+int test_shared_files() {
+    TEST_START("Files shared by token");
+    
+    asset_file_table_t table;
+    memset(&table, 0, sizeof(table));
+    char token[ASSET_FILE_TOKEN_LENGTH + 1];
+    char other[ASSET_FILE_TOKEN_LENGTH + 1];
+    TEST_ASSERT(!asset_files_share(&table, "tests/missing.bin", token), "Missing files should not be shared");
+    TEST_ASSERT(!asset_files_share(&table, "tests", token), "Directories should not be shared");
+    TEST_ASSERT(asset_files_share(&table, "tests/test_ipc_common.c", token), "Should share a file");
+    TEST_ASSERT(strlen(token) == ASSET_FILE_TOKEN_LENGTH && strspn(token, "0123456789abcdef") == ASSET_FILE_TOKEN_LENGTH, "Token should be hex");
+    TEST_ASSERT(asset_files_share(&table, "tests/test_ipc_common.c", other) && strcmp(token, other) != 0, "Tokens should be unique");
+    
+    FILE* file = fopen("tests/test_ipc_common.c", "rb");
+    char head[10];
+    TEST_ASSERT(file && fread(head, 1, sizeof(head), file) == sizeof(head), "Should read the test source");
+    fseek(file, 0, SEEK_END);
+    long long size = ftell(file);
+    fclose(file);
+    
+    char path[128];
+    asset_response_t response;
+    snprintf(path, sizeof(path), "/%s", token);
+    asset_files_handle(&table, path, NULL, NULL, &response);
+    TEST_ASSERT(response.status == 200 && response.body == NULL, "Whole files should not be read into memory");
+    TEST_ASSERT(response.file_path && strcmp(response.file_path, "tests/test_ipc_common.c") == 0, "Should stream from the shared path");
+    TEST_ASSERT(response.file_offset == 0 && (long long)response.length == size, "Should stream the whole file");
+    TEST_ASSERT(strcmp(response.cache_control, "no-cache") == 0, "Shared files should be revalidated");
+    asset_response_free(&response);
+    
+    snprintf(path, sizeof(path), "/%s/source.c", token);
+    asset_files_handle(&table, path, "bytes=100-", NULL, &response);
+    TEST_ASSERT(response.status == 206 && response.file_offset == 100 && (long long)response.length == size - 100, "Open ranges should stream from the offset");
+    asset_response_free(&response);
+    asset_files_handle(&table, path, "bytes=0-9", NULL, &response);
+    TEST_ASSERT(response.status == 206 && response.file_path == NULL, "Bounded ranges should be read");
+    TEST_ASSERT(response.length == 10 && memcmp(response.body, head, 10) == 0, "Should read the requested bytes");
+    asset_response_free(&response);
+    
+    asset_files_handle(&table, "/0123456789abcdef0123456789abcdef", NULL, NULL, &response);
+    TEST_ASSERT(response.status == 404, "Unknown tokens should be 404");
+    asset_files_handle(&table, "/", NULL, NULL, &response);
+    TEST_ASSERT(response.status == 404, "Missing tokens should be 404");
+    TEST_ASSERT(asset_files_unshare(&table, token) && !asset_files_unshare(&table, token), "Should unshare once");
+    snprintf(path, sizeof(path), "/%s", token);
+    asset_files_handle(&table, path, NULL, NULL, &response);
+    TEST_ASSERT(response.status == 404, "Unshared files should be 404");
+    snprintf(path, sizeof(path), "/%s", other);
+    asset_files_handle(&table, path, NULL, NULL, &response);
+    TEST_ASSERT(response.status == 200, "Other tokens should keep working");
+    asset_response_free(&response);
+    asset_files_free(&table);
+    
+#ifndef _WIN32
+    // Bounded range past 4 GB in a sparse file: offsets must not go through long
+    const char* large_path = "build/large_shared.bin";
+    const long long marker_offset = 5LL * 1024 * 1024 * 1024;
+    FILE* large = fopen(large_path, "wb");
+    int created = large && fseeko(large, (off_t)marker_offset, SEEK_SET) == 0 && fwrite("tronbun!", 1, 8, large) == 8;
+    if (large) fclose(large);
+    if (created) {
+        memset(&table, 0, sizeof(table));
+        TEST_ASSERT(asset_files_share(&table, large_path, token), "Should share a file past 4 GB");
+        snprintf(path, sizeof(path), "/%s", token);
+        asset_files_handle(&table, path, "bytes=5368709120-5368709126", NULL, &response);
+        TEST_ASSERT(response.status == 206 && response.body && response.length == 7 && memcmp(response.body, "tronbun", 7) == 0,
+                    "Should read a bounded range past 4 GB");
+        asset_response_free(&response);
+        asset_files_free(&table);
+    }
+    remove(large_path);
+#endif
+    
+    TEST_PASS();
+}
+
+int test_binary_frames() {
+    TEST_START("Binary frames with raw attachments");
+    
+    unsigned char bytes[300];
+    for (size_t i = 0; i < sizeof(bytes); i++) bytes[i] = (unsigned char)(i * 7);
+    bytes[0] = '\n';
+    bytes[1] = 0;
+    
+    FILE* original_stdout = stdout;
+    FILE* temp_file = tmpfile();
+    TEST_ASSERT(temp_file != NULL, "Could not create temporary file");
+    
+    ipc_json_writer_t writer;
+    ipc_set_framing(IPC_FRAMING_LINE);
+    ipc_json_writer_begin(&writer);
+    ipc_json_writer_append(&writer, "{}");
+    TEST_ASSERT(ipc_json_writer_send_binary(&writer, bytes, sizeof(bytes)) == 0, "Line framing should refuse binary frames");
+    
+    ipc_set_framing(IPC_FRAMING_LENGTH);
+    stdout = temp_file;
+    ipc_json_writer_begin(&writer);
+    ipc_json_writer_append(&writer, "{\"method\":\"ipc:response\",\"id\":\"bin-1\",\"params\":{\"binary\":true}}");
+    int sent = ipc_json_writer_send_binary(&writer, bytes, sizeof(bytes));
+    ipc_write_message("{\"method\":\"eval\",\"id\":\"plain\"}", 30);
+    stdout = original_stdout;
+    TEST_ASSERT(sent == 1, "Binary frame should be written");
+    rewind(temp_file);
+    
+    unsigned char header[8];
+    TEST_ASSERT(fread(header, 1, 8, temp_file) == 8 && (header[0] & 0x80) != 0, "Binary frame should carry the flag");
+    rewind(temp_file);
+    
+    ipc_reader_t reader;
+    ipc_reader_init(&reader);
+    ipc_command_pool_t pool;
+    ipc_command_pool_init(&pool, 1);
+    
+    size_t length = 0;
+    const char* json = ipc_reader_next(&reader, temp_file, &length);
+    TEST_ASSERT(json != NULL && length == strlen(json), "Should read the JSON part of a binary frame");
+    ipc_pooled_command_t* cmd = ipc_command_pool_acquire(&pool, NULL);
+    TEST_ASSERT(ipc_command_pool_parse(cmd, json) == 1, "JSON part should parse");
+    TEST_ASSERT(strcmp(cmd->command.id, "bin-1") == 0, "Should keep the id");
+    TEST_ASSERT(ipc_reader_detach_attachment(&reader, &cmd->command) == 1, "Should move the attachment");
+    TEST_ASSERT(cmd->command.attachment_length == sizeof(bytes) &&
+                memcmp(cmd->command.attachment, bytes, sizeof(bytes)) == 0, "Attachment should round-trip byte for byte");
+    TEST_ASSERT(reader.buffer == NULL, "Reader should give up its buffer");
+    
+    // The next message reads into a new buffer while the attachment lives on
+    json = ipc_reader_next(&reader, temp_file, &length);
+    TEST_ASSERT(json != NULL && strstr(json, "\"id\":\"plain\"") != NULL, "Following message should stay separate");
+    TEST_ASSERT(reader.attachment_length == 0, "Plain frames have no attachment");
+    TEST_ASSERT(memcmp(cmd->command.attachment, bytes, sizeof(bytes)) == 0, "Attachment should outlive the next read");
+    ipc_command_t plain;
+    TEST_ASSERT(ipc_command_parse(json, &plain) == 1, "Plain message should parse");
+    TEST_ASSERT(ipc_reader_detach_attachment(&reader, &plain) == 0 && plain.attachment == NULL, "Nothing to move");
+    ipc_command_release(&plain);
+    ipc_command_pool_release(cmd);
+    fclose(temp_file);
+    
+    // A JSON length past the end of the frame is reported as end of input
+    temp_file = tmpfile();
+    TEST_ASSERT(temp_file != NULL, "Could not create temporary file");
+    const unsigned char malformed[] = { 0x80, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x09, '{', '}' };
+    fwrite(malformed, 1, sizeof(malformed), temp_file);
+    rewind(temp_file);
+    TEST_ASSERT(ipc_reader_next(&reader, temp_file, NULL) == NULL, "Malformed binary frame should not be returned");
+    fclose(temp_file);
+    
+    ipc_reader_destroy(&reader);
+    ipc_command_pool_destroy(&pool);
+    ipc_set_framing(IPC_FRAMING_LINE);
+    
+    TEST_PASS();
+}
+
 int test_concurrent_parsing() {
     TEST_START("concurrent parsing simulation");
     
@@ -717,6 +1784,7 @@ int test_malformed_json_resilience() {
 int main() {
     printf("🧪 Running IPC Common Unit Tests\n");
     printf("================================\n\n");
+    ipc_init();
     
     // Core functionality tests
     printf("📋 Running core functionality tests...\n");
@@ -726,6 +1794,7 @@ int main() {
     RUN_TEST(test_ipc_extract_param_int);
     RUN_TEST(test_ipc_extract_param_float);
     RUN_TEST(test_ipc_extract_param_json);
+    RUN_TEST(test_ipc_command_parse);
     RUN_TEST(test_ipc_write_response);
     RUN_TEST(test_ipc_write_event);
     printf("✅ Core functionality tests completed successfully!\n\n");
@@ -746,7 +1815,23 @@ int main() {
     // Performance and stress tests
     printf("📋 Running performance and stress tests...\n");
     RUN_TEST(test_large_payload_handling);
+    RUN_TEST(test_message_framing);
     RUN_TEST(test_concurrent_parsing);
+    RUN_TEST(test_completion_signalling);
+    RUN_TEST(test_pipeline_deadlines);
+    RUN_TEST(test_method_table);
+    RUN_TEST(test_command_pool);
+    RUN_TEST(test_batch_commands);
+    RUN_TEST(test_raw_passthrough);
+    RUN_TEST(test_json_string_escaping);
+    RUN_TEST(test_base64_params);
+    RUN_TEST(test_command_target);
+    RUN_TEST(test_asset_paths);
+    RUN_TEST(test_asset_ranges);
+    RUN_TEST(test_asset_archive);
+    RUN_TEST(test_asset_encodings);
+    RUN_TEST(test_shared_files);
+    RUN_TEST(test_binary_frames);
     printf("✅ Performance and stress tests completed!\n\n");
     
     // Resilience and edge case tests
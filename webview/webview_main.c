@@ -1,10 +1,14 @@
 #include "../vendors/webview/core/include/webview/webview.h"
 #include "platform/platform_window.h"
+#include "platform/platform_tray.h"
 #include "common/ipc_common.h"
+#include "common/tray_methods.h"
+#include "common/asset_server.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -24,46 +28,102 @@
 
 // Using IPC_IPC_MAX_COMMAND_LENGTH from ipc_common.h
 
-typedef struct {
+#define DEFAULT_WINDOW_TITLE "Tronbun default title"
+#define DEFAULT_WINDOW_WIDTH 800
+#define DEFAULT_WINDOW_HEIGHT 600
+
+// Structure for bind callback data
+typedef struct bind_callback_data {
     webview_t webview;
-    int should_exit;
-} thread_context_t;
+    int handle;
+    char callback_id[256];
+    struct bind_callback_data* next;  // Next binding made through the bind command
+} bind_callback_data_t;
+
+// When a window created hidden for the first paint is shown
+typedef enum {
+    WEBVIEW_SHOW_NOW = 0,   // Not waiting; shown as usual
+    WEBVIEW_SHOW_ON_PAINT,  // First contentful paint, or the end of the first load
+    WEBVIEW_SHOW_ON_MARK    // The page calls window.tronbun.ready()
+} webview_show_when_t;
 
-// Structure for dispatching commands to the main thread
+// Startup milestones, in ipc_now_ms() time; 0 until reached
 typedef struct {
-    webview_t webview;
-    char command[IPC_MAX_COMMAND_LENGTH];
-    char response[IPC_MAX_COMMAND_LENGTH];
-    int* response_ready;
-} command_dispatch_t;
+    long long started_ms;     // Process start, or host_create_webview in host mode
+    long long window_ms;      // Toolkit window and web view created
+    long long navigation_ms;  // First navigate or set_html
+    long long dom_ready_ms;
+    int reported;             // The startup event went out
+} webview_startup_t;
 
-// Structure for bind callback data
+// One webview; the method handlers receive it as their target
 typedef struct {
     webview_t webview;
-    char callback_id[256];
-    char request_data[IPC_MAX_COMMAND_LENGTH];
-} bind_callback_data_t;
+    int handle;                      // Host object handle, -1 when the process owns a single webview
+    bind_callback_data_t* bindings;  // Bindings to drop on reset (the invoke bridge is not listed)
+    int tainted;                     // Set by state reset cannot undo (init scripts, blur)
+    int load_state;                  // webview_load_state_t of the current page
+    int native_load_events;          // The platform reports started/finished/failed/crashed itself
+    int show_when;                   // webview_show_when_t; reset to WEBVIEW_SHOW_NOW once shown
+    webview_startup_t startup;
+} webview_view_t;
+
+// Progress of the current page, as reported by isready and the load events
+typedef enum {
+    WEBVIEW_LOAD_LOADING = 0,
+    WEBVIEW_LOAD_DOM_READY,
+    WEBVIEW_LOAD_FINISHED
+} webview_load_state_t;
+
+typedef struct {
+    webview_view_t view;      // The single webview (unused in host mode)
+    int should_exit;
+    int host;                 // Host mode: one process, many webviews and trays, addressed by target
+    ipc_pipeline_t pipeline;  // Commands submitted to the main thread but not finished
+    ipc_command_pool_t pool;  // Reused command objects, parsed on the stdin thread
+} thread_context_t;
 
 // Forward declarations
 void execute_command_dispatch(webview_t w, void* arg);
 void handle_bind_callback(const char *id, const char *req, void *arg);
 void handle_invoke_callback(const char *id, const char *req, void *arg);
+void handle_lifecycle_callback(const char *id, const char *req, void *arg);
+static void host_close(int handle);
+static void binary_calls_cancel(const webview_view_t* view, const char* reason);
+
+// Hosted webviews name themselves in every event so the parent can route it
+static void write_event_target(ipc_json_writer_t* writer, int handle) {
+    if (handle < 0) return;
+    char target[32];
+    snprintf(target, sizeof(target), ",\"target\":%d", handle);
+    ipc_json_writer_append(writer, target);
+}
 
 // Bind callback handler
 void handle_bind_callback(const char *id, const char *req, void *arg) {
     bind_callback_data_t* data = (bind_callback_data_t*)arg;
     
     // Write the callback result to stdout
-    printf("{\"type\":\"bind_callback\",\"id\":\"%s\",\"seq\":\"%s\",\"req\":%s}\n", 
-           data->callback_id, id, req);
-    fflush(stdout);
+    ipc_json_writer_t writer;
+    ipc_json_writer_begin(&writer);
+    ipc_json_writer_append(&writer, "{\"type\":\"bind_callback\",\"id\":");
+    ipc_json_writer_string(&writer, data->callback_id);
+    write_event_target(&writer, data->handle);
+    ipc_json_writer_append(&writer, ",\"seq\":");
+    ipc_json_writer_string(&writer, id);
+    ipc_json_writer_append(&writer, ",\"req\":");
+    ipc_json_writer_append(&writer, req);
+    ipc_json_writer_append_n(&writer, "}", 1);
+    ipc_json_writer_send(&writer);
     
     webview_return(data->webview, id, 0, "{\"status\":\"success\"}");
 }
 
+// Page-to-Bun calls: the page calls __bunwebview_invoke(channel, data), so req is
+// the JSON array [channel, data]. Both elements are copied into the emitted
+// line as-is, making channel and data first-class fields:
+//   {"type":"ipc:call","id":"__bunwebview_invoke","seq":"<seq>","channel":"...","data":...}
 void handle_invoke_callback(const char *id, const char *req, void *arg) {
-    fprintf(stderr, "Executing invoke callback: %s\n", req);
-    
     bind_callback_data_t* data = (bind_callback_data_t*)arg;
     
     if (data == NULL) {
@@ -71,331 +131,1370 @@ void handle_invoke_callback(const char *id, const char *req, void *arg) {
         return;
     }
     
+    size_t req_length = strlen(req);
+    const char* channel;
+    size_t channel_length;
+    const char* payload = "null";
+    size_t payload_length = 4;
     
-    // Write the callback result to stdout
-    printf("{\"type\":\"ipc:call\",\"id\":\"%s\",\"seq\":\"%s\",\"req\":%s}\n", 
-           data->callback_id, id, req);
+    if (!ipc_json_find_element(req, req_length, 0, &channel, &channel_length) || channel[0] != '"') {
+        webview_return(data->webview, id, 1, "\"Invalid invoke arguments\"");
+        return;
+    }
+    ipc_json_find_element(req, req_length, 1, &payload, &payload_length);
     
-    fflush(stdout);
+    ipc_json_writer_t writer;
+    ipc_json_writer_begin(&writer);
+    ipc_json_writer_append(&writer, "{\"type\":\"ipc:call\",\"id\":");
+    ipc_json_writer_string(&writer, data->callback_id);
+    write_event_target(&writer, data->handle);
+    ipc_json_writer_append(&writer, ",\"seq\":");
+    ipc_json_writer_string(&writer, id);
+    ipc_json_writer_append(&writer, ",\"channel\":");
+    ipc_json_writer_append_n(&writer, channel, channel_length);
+    ipc_json_writer_append(&writer, ",\"data\":");
+    ipc_json_writer_append_n(&writer, payload, payload_length);
+    ipc_json_writer_append_n(&writer, "}", 1);
+    ipc_json_writer_send(&writer);
 }
 
-// Function to be called on the main thread to execute commands
-void execute_command_dispatch(webview_t w, void* arg) {
-    (void)w; // Suppress unused parameter warning
-    command_dispatch_t* cmd = (command_dispatch_t*)arg;
-    char method[256], id[256], params[IPC_MAX_COMMAND_LENGTH];
+// Page lifecycle event:
+//   {"type":"load","state":"started|dom-ready|finished|failed|crashed","url":"...","error":"..."}
+static void write_load_event(const webview_view_t* view, const char* state, const char* url, const char* error) {
+    ipc_json_writer_t writer;
+    ipc_json_writer_begin(&writer);
+    ipc_json_writer_append(&writer, "{\"type\":\"load\",\"state\":");
+    ipc_json_writer_string(&writer, state);
+    write_event_target(&writer, view->handle);
+    if (url) {
+        ipc_json_writer_append(&writer, ",\"url\":");
+        ipc_json_writer_string(&writer, url);
+    }
+    if (error) {
+        ipc_json_writer_append(&writer, ",\"error\":");
+        ipc_json_writer_string(&writer, error);
+    }
+    ipc_json_writer_append_n(&writer, "}", 1);
+    ipc_json_writer_send(&writer);
+}
+
+static void view_mark_navigation(webview_view_t* view) {
+    if (!view->startup.navigation_ms) view->startup.navigation_ms = ipc_now_ms();
+}
+
+static void write_startup_ms(ipc_json_writer_t* writer, const char* key, long long started, long long at) {
+    if (!at) return;
+    char field[64];
+    snprintf(field, sizeof(field), ",\"%s\":%lld", key, at - started);
+    ipc_json_writer_append(writer, field);
+}
+
+// The first paint (or whatever the window waits for) ends startup: show the
+// window if it was held back and report the milestones, in ms since start:
+//   {"type":"startup","trigger":"paint|mark|load|error","window_ms":...,
+//    "navigation_ms":...,"dom_ready_ms":...,"ready_ms":...}
+static void view_startup_done(webview_view_t* view, const char* trigger) {
+    if (view->startup.reported) return;
+    view->startup.reported = 1;
+    long long now = ipc_now_ms();
     
-    fprintf(stderr, "Executing command: %s\n", cmd->command);
+    if (view->show_when != WEBVIEW_SHOW_NOW) {
+        view->show_when = WEBVIEW_SHOW_NOW;
+        platform_window_show(webview_get_window(view->webview));
+    }
     
-    if (!ipc_parse_command(cmd->command, method, id, params)) {
-        ipc_write_response(id, NULL, "Invalid command format");
-        *cmd->response_ready = 1;
-        return;
+    const webview_startup_t* startup = &view->startup;
+    ipc_json_writer_t writer;
+    ipc_json_writer_begin(&writer);
+    ipc_json_writer_append(&writer, "{\"type\":\"startup\",\"trigger\":");
+    ipc_json_writer_string(&writer, trigger);
+    write_event_target(&writer, view->handle);
+    write_startup_ms(&writer, "window_ms", startup->started_ms, startup->window_ms);
+    write_startup_ms(&writer, "navigation_ms", startup->started_ms, startup->navigation_ms);
+    write_startup_ms(&writer, "dom_ready_ms", startup->started_ms, startup->dom_ready_ms);
+    write_startup_ms(&writer, "ready_ms", startup->started_ms, now);
+    ipc_json_writer_append_n(&writer, "}", 1);
+    ipc_json_writer_send(&writer);
+}
+
+// A page finished loading; waiting for paint stops here, since a hidden
+// window may never paint. A page expected to mark itself ready keeps waiting.
+static void view_load_ended(webview_view_t* view) {
+    if (view->show_when != WEBVIEW_SHOW_ON_MARK) view_startup_done(view, "load");
+}
+
+// Load progress from the browser engine
+static void handle_load_event(void* userdata, platform_load_event_t event, const char* uri, const char* error) {
+    webview_view_t* view = (webview_view_t*)userdata;
+    switch (event) {
+        case PLATFORM_LOAD_STARTED:
+            view->load_state = WEBVIEW_LOAD_LOADING;
+            binary_calls_cancel(view, "Page navigated away");
+            write_load_event(view, "started", uri, NULL);
+            break;
+        case PLATFORM_LOAD_FINISHED:
+            view->load_state = WEBVIEW_LOAD_FINISHED;
+            write_load_event(view, "finished", uri, NULL);
+            view_load_ended(view);
+            break;
+        case PLATFORM_LOAD_FAILED:
+            write_load_event(view, "failed", uri, error);
+            view_startup_done(view, "error");  // Show the error page
+            break;
+        case PLATFORM_LOAD_CRASHED:
+            view->load_state = WEBVIEW_LOAD_LOADING;
+            binary_calls_cancel(view, "Web process crashed");
+            write_load_event(view, "crashed", uri, error);
+            view_startup_done(view, "error");
+            break;
     }
+}
+
+// Load progress from the page itself: the bridge script calls
+// __bunwebview_lifecycle(state, location.href) on DOMContentLoaded, first
+// contentful paint, load and window.tronbun.ready(). "finished" only counts
+// where the platform has no load events of its own.
+void handle_lifecycle_callback(const char *id, const char *req, void *arg) {
+    webview_view_t* view = (webview_view_t*)arg;
+    cJSON* args = cJSON_Parse(req);
+    const char* state = cJSON_GetStringValue(cJSON_GetArrayItem(args, 0));
+    const char* url = cJSON_GetStringValue(cJSON_GetArrayItem(args, 1));
     
-    webview_error_t result = WEBVIEW_ERROR_OK;
+    if (state && strcmp(state, "dom-ready") == 0) {
+        if (view->load_state < WEBVIEW_LOAD_DOM_READY) view->load_state = WEBVIEW_LOAD_DOM_READY;
+        if (!view->startup.dom_ready_ms) view->startup.dom_ready_ms = ipc_now_ms();
+        write_load_event(view, "dom-ready", url, NULL);
+    } else if (state && strcmp(state, "finished") == 0 && !view->native_load_events) {
+        view->load_state = WEBVIEW_LOAD_FINISHED;
+        write_load_event(view, "finished", url, NULL);
+        view_load_ended(view);
+    } else if (state && strcmp(state, "first-paint") == 0) {
+        if (view->show_when != WEBVIEW_SHOW_ON_MARK) view_startup_done(view, "paint");
+    } else if (state && strcmp(state, "ready") == 0) {
+        view_startup_done(view, "mark");
+    }
     
-    // Handle different webview methods
-    if (strcmp(method, "set_title") == 0) {
-        char title[512];
-        ipc_extract_param_string(params, "title", title, sizeof(title));
-        result = webview_set_title(cmd->webview, title);
-        ipc_write_response(id, "true", NULL);
-        
-    } else if (strcmp(method, "set_size") == 0) {
-        int width = 800, height = 600, hints = 0;
-        ipc_extract_param_int(params, "width", &width);
-        ipc_extract_param_int(params, "height", &height);
-        ipc_extract_param_int(params, "hints", &hints);
-        result = webview_set_size(cmd->webview, width, height, (webview_hint_t)hints);
-        ipc_write_response(id, "true", NULL);
-        
-    } else if (strcmp(method, "navigate") == 0) {
-        char url[1024];
-        ipc_extract_param_string(params, "url", url, sizeof(url));
-        result = webview_navigate(cmd->webview, url);
-        ipc_write_response(id, "true", NULL);
-        
-    } else if (strcmp(method, "set_html") == 0) {
-        char html[IPC_MAX_COMMAND_LENGTH];
-        ipc_extract_param_string(params, "html", html, sizeof(html));
-        result = webview_set_html(cmd->webview, html);
-        ipc_write_response(id, "true", NULL);
-        
-    } else if (strcmp(method, "eval") == 0) {
-        char js[IPC_MAX_COMMAND_LENGTH];
-        ipc_extract_param_string(params, "js", js, sizeof(js));
-        result = webview_eval(cmd->webview, js);
-        ipc_write_response(id, "true", NULL);
-        
-    } else if (strcmp(method, "init") == 0) {
-        char js[IPC_MAX_COMMAND_LENGTH];
-        ipc_extract_param_string(params, "js", js, sizeof(js));
-        result = webview_init(cmd->webview, js);
-        ipc_write_response(id, "true", NULL);
-        
-    } else if (strcmp(method, "bind") == 0) {
-        char name[256];
-        ipc_extract_param_string(params, "name", name, sizeof(name));
-        
-        // Create callback data
-        bind_callback_data_t* callback_data = (bind_callback_data_t*)malloc(sizeof(bind_callback_data_t));
-        callback_data->webview = cmd->webview;  
-        strncpy(callback_data->callback_id, name, sizeof(callback_data->callback_id) - 1);
-        callback_data->callback_id[sizeof(callback_data->callback_id) - 1] = '\0';
-        
-        result = webview_bind(cmd->webview, name, handle_bind_callback, callback_data);
-        ipc_write_response(id, "true", NULL);
-        
-    } else if (strcmp(method, "unbind") == 0) {
-        char name[256];
-        ipc_extract_param_string(params, "name", name, sizeof(name));
-        result = webview_unbind(cmd->webview, name);
-        ipc_write_response(id, "true", NULL);
-        
-    } else if (strcmp(method, "terminate") == 0) {
-        result = webview_terminate(cmd->webview);
-        ipc_write_response(id, "true", NULL);
-        
-    } else if (strcmp(method, "get_window") == 0) {
-        void* window = webview_get_window(cmd->webview);
-        char window_ptr[64];
-        snprintf(window_ptr, sizeof(window_ptr), "%p", window);
-        ipc_write_response(id, window_ptr, NULL);
-        
-    } else if (strcmp(method, "get_version") == 0) {
-        const webview_version_info_t* version = webview_version();
-        char version_str[256];
-        snprintf(version_str, sizeof(version_str), 
-                "{\"major\":%u,\"minor\":%u,\"patch\":%u,\"number\":\"%s\"}",
-                version->version.major, version->version.minor, 
-                version->version.patch, version->version_number);
-        // For JSON responses, we need to handle raw JSON differently
-        printf("{\"type\":\"response\",\"id\":\"%s\",\"result\":%s}\n", id, version_str);
-        fflush(stdout);
-    } else if (strcmp(method, "ipc:response") == 0) {
-        fprintf(stderr, "Executing ipc:response: %s\n", params);
-        char ipcId[256];
-        ipc_extract_param_string(params, "id", ipcId, sizeof(ipcId));
-        char result[IPC_MAX_COMMAND_LENGTH];
-        ipc_extract_param_json(params, "result", result, sizeof(result));
-        fprintf(stderr, "Executing ipc:response2: %s\n", result);
-        // For JSON responses, we need to handle raw JSON differently  
-        printf("{\"type\":\"response\",\"id\":\"%s\",\"result\":%s}\n", id, result);
-        fflush(stdout);
-        fprintf(stderr, "Executing ipc:response3: %s\n", result);
-        webview_return(cmd->webview, ipcId, 0, result);
-    
-    // Platform window control commands
-    } else if (strcmp(method, "window_set_transparent") == 0) {
-        void* window = webview_get_window(cmd->webview);
-        platform_window_set_transparent(window);
-        ipc_write_response(id, "true", NULL);
-        
-    } else if (strcmp(method, "window_set_opaque") == 0) {
-        void* window = webview_get_window(cmd->webview);
-        platform_window_set_opaque(window);
-        ipc_write_response(id, "true", NULL);
-        
-    } else if (strcmp(method, "window_enable_blur") == 0) {
-        void* window = webview_get_window(cmd->webview);
-        platform_window_enable_blur(window);
-        ipc_write_response(id, "true", NULL);
-        
-    } else if (strcmp(method, "window_remove_decorations") == 0) {
-        void* window = webview_get_window(cmd->webview);
-        platform_window_remove_decorations(window);
-        ipc_write_response(id, "true", NULL);
-        
-    } else if (strcmp(method, "window_add_decorations") == 0) {
-        void* window = webview_get_window(cmd->webview);
-        platform_window_add_decorations(window);
-        ipc_write_response(id, "true", NULL);
-    } else if (strcmp(method, "window_set_always_on_top") == 0) {
-        void* window = webview_get_window(cmd->webview);
-        int on_top = 1;
-        ipc_extract_param_int(params, "on_top", &on_top);
-        platform_window_set_always_on_top(window, on_top);
-        ipc_write_response(id, "true", NULL);
-        
-    } else if (strcmp(method, "window_set_opacity") == 0) {
-        void* window = webview_get_window(cmd->webview);
-        float opacity = 1.0f;
-        // Extract float parameter (using string first, then convert)
-        char opacity_str[32];
-        ipc_extract_param_string(params, "opacity", opacity_str, sizeof(opacity_str));
-        if (strlen(opacity_str) > 0) {
-            opacity = (float)atof(opacity_str);
+    cJSON_Delete(args);
+    webview_return(view->webview, id, 0, "null");
+}
+
+// Method handlers, run on the main thread. Each writes its own success
+// response; a non-zero return is a webview_error_t reported by the caller.
+static int method_set_title(void* target, const ipc_command_t* command) {
+    webview_view_t* view = (webview_view_t*)target;
+    webview_error_t result = webview_set_title(view->webview, ipc_command_get_string(command, "title", ""));
+    ipc_write_response(command->id, "true", NULL);
+    return result;
+}
+
+static int method_set_size(void* target, const ipc_command_t* command) {
+    webview_view_t* view = (webview_view_t*)target;
+    int width = ipc_command_get_int(command, "width", 800);
+    int height = ipc_command_get_int(command, "height", 600);
+    int hints = ipc_command_get_int(command, "hints", 0);
+    webview_error_t result = webview_set_size(view->webview, width, height, (webview_hint_t)hints);
+    ipc_write_response(command->id, "true", NULL);
+    return result;
+}
+
+static int method_navigate(void* target, const ipc_command_t* command) {
+    webview_view_t* view = (webview_view_t*)target;
+    view_mark_navigation(view);
+    webview_error_t result = webview_navigate(view->webview, ipc_command_get_string(command, "url", ""));
+    ipc_write_response(command->id, "true", NULL);
+    return result;
+}
+
+static int method_set_html(void* target, const ipc_command_t* command) {
+    webview_view_t* view = (webview_view_t*)target;
+    view_mark_navigation(view);
+    webview_error_t result = webview_set_html(view->webview, ipc_command_get_string(command, "html", ""));
+    ipc_write_response(command->id, "true", NULL);
+    return result;
+}
+
+static int method_eval(void* target, const ipc_command_t* command) {
+    webview_view_t* view = (webview_view_t*)target;
+    webview_error_t result = webview_eval(view->webview, ipc_command_get_string(command, "js", ""));
+    ipc_write_response(command->id, "true", NULL);
+    return result;
+}
+
+static int method_init(void* target, const ipc_command_t* command) {
+    webview_view_t* view = (webview_view_t*)target;
+    view->tainted = 1;  // The webview library cannot remove init scripts
+    webview_error_t result = webview_init(view->webview, ipc_command_get_string(command, "js", ""));
+    ipc_write_response(command->id, "true", NULL);
+    return result;
+}
+
+static int method_bind(void* target, const ipc_command_t* command) {
+    webview_view_t* view = (webview_view_t*)target;
+    const char* name = ipc_command_get_string(command, "name", "");
+    
+    // Create callback data
+    bind_callback_data_t* callback_data = (bind_callback_data_t*)malloc(sizeof(bind_callback_data_t));
+    callback_data->webview = view->webview;
+    callback_data->handle = view->handle;
+    strncpy(callback_data->callback_id, name, sizeof(callback_data->callback_id) - 1);
+    callback_data->callback_id[sizeof(callback_data->callback_id) - 1] = '\0';
+    
+    webview_error_t result = webview_bind(view->webview, name, handle_bind_callback, callback_data);
+    if (result == WEBVIEW_ERROR_OK) {
+        callback_data->next = view->bindings;
+        view->bindings = callback_data;
+    } else {
+        free(callback_data);
+    }
+    ipc_write_response(command->id, "true", NULL);
+    return result;
+}
+
+// Unlink and free the callback data of one binding
+static void forget_binding(webview_view_t* view, const char* name) {
+    bind_callback_data_t** link = &view->bindings;
+    while (*link) {
+        if (strcmp((*link)->callback_id, name) == 0) {
+            bind_callback_data_t* binding = *link;
+            *link = binding->next;
+            free(binding);
+            return;
         }
-        platform_window_set_opacity(window, opacity);
-        ipc_write_response(id, "true", NULL);
-        
-    } else if (strcmp(method, "window_set_resizable") == 0) {
-        void* window = webview_get_window(cmd->webview);
-        int resizable = 1;
-        ipc_extract_param_int(params, "resizable", &resizable);
-        platform_window_set_resizable(window, resizable);
-        ipc_write_response(id, "true", NULL);
-        
-    } else if (strcmp(method, "window_set_position") == 0) {
-        void* window = webview_get_window(cmd->webview);
-        int x = 0, y = 0;
-        ipc_extract_param_int(params, "x", &x);
-        ipc_extract_param_int(params, "y", &y);
-        platform_window_set_position(window, x, y);
-        ipc_write_response(id, "true", NULL);
-        
-    } else if (strcmp(method, "window_center") == 0) {
-        void* window = webview_get_window(cmd->webview);
-        platform_window_center(window);
-        ipc_write_response(id, "true", NULL);
-        
-    } else if (strcmp(method, "window_minimize") == 0) {
-        void* window = webview_get_window(cmd->webview);
-        platform_window_minimize(window);
-        ipc_write_response(id, "true", NULL);
-        
-    } else if (strcmp(method, "window_maximize") == 0) {
-        void* window = webview_get_window(cmd->webview);
-        platform_window_maximize(window);
-        ipc_write_response(id, "true", NULL);
-        
-    } else if (strcmp(method, "window_restore") == 0) {
-        void* window = webview_get_window(cmd->webview);
-        platform_window_restore(window);
-        ipc_write_response(id, "true", NULL);
-        
-    } else if (strcmp(method, "window_hide") == 0) {
-        void* window = webview_get_window(cmd->webview);
-        platform_window_hide(window);
-        ipc_write_response(id, "true", NULL);
-        
-    } else if (strcmp(method, "window_show") == 0) {
-        void* window = webview_get_window(cmd->webview);
-        platform_window_show(window);
-        ipc_write_response(id, "true", NULL);
-        
+        link = &(*link)->next;
+    }
+}
+
+static int method_unbind(void* target, const ipc_command_t* command) {
+    webview_view_t* view = (webview_view_t*)target;
+    const char* name = ipc_command_get_string(command, "name", "");
+    webview_error_t result = webview_unbind(view->webview, name);
+    if (result == WEBVIEW_ERROR_OK) {
+        forget_binding(view, name);
+    }
+    ipc_write_response(command->id, "true", NULL);
+    return result;
+}
+
+// A reset waiting for the website data to be cleared before it answers
+typedef struct {
+    webview_view_t* view;
+    char id[IPC_MAX_ID_LENGTH];
+} reset_request_t;
+
+static void reset_data_cleared(void* userdata, int cleared) {
+    reset_request_t* request = (reset_request_t*)userdata;
+    int pristine = cleared && !request->view->tainted;
+    ipc_write_json_response(request->id, pristine ? "{\"pristine\":true}" : "{\"pristine\":false}", NULL);
+    free(request);
+}
+
+// Return a used webview to its freshly started state so a pool can hand it out
+// again: hidden, default title and geometry, plain window, blank page, no
+// bindings besides the invoke bridge, and no cookies, storage or cache. The
+// result reports whether that worked; init scripts and blur cannot be undone,
+// and website data only where the platform clears it, so such a webview
+// should be discarded.
+static int method_reset(void* target, const ipc_command_t* command) {
+    webview_view_t* view = (webview_view_t*)target;
+    void* window = webview_get_window(view->webview);
+    
+    binary_calls_cancel(view, "Window reset");
+    while (view->bindings) {
+        bind_callback_data_t* binding = view->bindings;
+        view->bindings = binding->next;
+        webview_unbind(view->webview, binding->callback_id);
+        free(binding);
+    }
+    
+    platform_window_hide(window);
+    platform_window_set_opaque(window);
+    platform_window_add_decorations(window);
+    platform_window_set_always_on_top(window, 0);
+    platform_window_set_opacity(window, 1.0f);
+    platform_window_set_resizable(window, 1);
+    platform_window_restore(window);
+    webview_set_title(view->webview, DEFAULT_WINDOW_TITLE);
+    webview_set_size(view->webview, DEFAULT_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT, WEBVIEW_HINT_NONE);
+    platform_window_center(window);
+    webview_error_t result = webview_navigate(view->webview, "about:blank");
+    
+    // Answer once the data is gone, so the next owner can't see any of it.
+    // Hosted webviews share one data store, which would clear the others' too.
+    if (!view->tainted && view->handle < 0) {
+        reset_request_t* request = (reset_request_t*)malloc(sizeof(reset_request_t));
+        if (request) {
+            request->view = view;
+            snprintf(request->id, sizeof(request->id), "%s", command->id);
+            if (platform_window_clear_website_data(window, reset_data_cleared, request)) {
+                return result;
+            }
+            free(request);
+        }
+    }
+    ipc_write_json_response(command->id, "{\"pristine\":false}", NULL);
+    return result;
+}
+
+static int method_terminate(void* target, const ipc_command_t* command) {
+    webview_view_t* view = (webview_view_t*)target;
+    if (view->handle >= 0) {
+        // A hosted webview closes its own window; the host keeps running
+        ipc_write_response(command->id, "true", NULL);
+        host_close(view->handle);
+        return 0;
+    }
+    webview_error_t result = webview_terminate(view->webview);
+    ipc_write_response(command->id, "true", NULL);
+    return result;
+}
+
+static int method_get_window(void* target, const ipc_command_t* command) {
+    webview_view_t* view = (webview_view_t*)target;
+    char window_ptr[64];
+    snprintf(window_ptr, sizeof(window_ptr), "%p", webview_get_window(view->webview));
+    ipc_write_response(command->id, window_ptr, NULL);
+    return 0;
+}
+
+static int method_get_version(void* target, const ipc_command_t* command) {
+    (void)target;
+    const webview_version_info_t* version = webview_version();
+    char version_str[256];
+    snprintf(version_str, sizeof(version_str), 
+            "{\"major\":%u,\"minor\":%u,\"patch\":%u,\"number\":\"%s\"}",
+            version->version.major, version->version.minor, 
+            version->version.patch, version->version_number);
+    // For JSON responses, we need to handle raw JSON differently
+    ipc_write_json_response(command->id, version_str, NULL);
+    return 0;
+}
+
+// Whether the current page's DOM is ready; the load events push the same information
+static int method_isready(void* target, const ipc_command_t* command) {
+    webview_view_t* view = (webview_view_t*)target;
+    ipc_write_json_response(command->id, view->load_state >= WEBVIEW_LOAD_DOM_READY ? "true" : "false", NULL);
+    return 0;
+}
+
+static int method_get_metrics(void* target, const ipc_command_t* command);
+static int method_batch(void* target, const ipc_command_t* command);
+static int method_share_file(void* target, const ipc_command_t* command);
+static int method_unshare_file(void* target, const ipc_command_t* command);
+static int binary_call_finish(const char* seq, const ipc_command_t* command);
+
+static int method_ipc_response(void* target, const ipc_command_t* command) {
+    webview_view_t* view = (webview_view_t*)target;
+    const char* ipcId = ipc_command_get_string(command, "id", "");
+    
+    // Calls that arrived as raw bytes are answered over their scheme request;
+    // a "bin-" id no longer pending was cancelled with its page or window
+    if (binary_call_finish(ipcId, command) || strncmp(ipcId, "bin-", 4) == 0) {
+        ipc_write_response(command->id, "true", NULL);
+        return 0;
+    }
+    
+    const char* error = ipc_command_get_string(command, "error", NULL);
+    if (error) {
+        cJSON* message = cJSON_CreateString(error);
+        char* printed_error = message ? cJSON_PrintUnformatted(message) : NULL;
+        webview_return(view->webview, ipcId, 1, printed_error ? printed_error : "\"IPC handler failed\"");
+        ipc_write_response(command->id, "true", NULL);
+        cJSON_free(printed_error);
+        cJSON_Delete(message);
+        return 0;
+    }
+    
+    // The result is forwarded as it arrived on stdin; only commands that
+    // bypassed the pool (e.g. inside a batch) need their tree printed
+    char* printed = NULL;
+    const char* ipc_result = ipc_command_get_raw_param(command, "result", NULL);
+    if (!ipc_result) {
+        const cJSON* result_item = ipc_command_get_param(command, "result");
+        printed = result_item ? cJSON_PrintUnformatted(result_item) : NULL;
+        ipc_result = printed ? printed : "null";
+    }
+    
+    webview_return(view->webview, ipcId, 0, ipc_result);
+    
+    // Echoing the result back to Bun is opt-in
+    if (ipc_command_get_bool(command, "echo", 0)) {
+        ipc_write_json_response(command->id, ipc_result, NULL);
     } else {
-        ipc_write_response(id, NULL, "Unknown method");
+        ipc_write_response(command->id, "true", NULL);
+    }
+    cJSON_free(printed);
+    return 0;
+}
+
+// Platform window control commands
+static int method_window_set_transparent(void* target, const ipc_command_t* command) {
+    platform_window_set_transparent(webview_get_window(((webview_view_t*)target)->webview));
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static int method_window_set_opaque(void* target, const ipc_command_t* command) {
+    platform_window_set_opaque(webview_get_window(((webview_view_t*)target)->webview));
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static int method_window_enable_blur(void* target, const ipc_command_t* command) {
+    ((webview_view_t*)target)->tainted = 1;  // There is no platform call to disable it again
+    platform_window_enable_blur(webview_get_window(((webview_view_t*)target)->webview));
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static int method_window_remove_decorations(void* target, const ipc_command_t* command) {
+    platform_window_remove_decorations(webview_get_window(((webview_view_t*)target)->webview));
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static int method_window_add_decorations(void* target, const ipc_command_t* command) {
+    platform_window_add_decorations(webview_get_window(((webview_view_t*)target)->webview));
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static int method_window_set_always_on_top(void* target, const ipc_command_t* command) {
+    int on_top = ipc_command_get_bool(command, "on_top", 1);
+    platform_window_set_always_on_top(webview_get_window(((webview_view_t*)target)->webview), on_top);
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static int method_window_set_opacity(void* target, const ipc_command_t* command) {
+    // Opacity is sent as a string by older clients, accept both forms
+    float opacity = ipc_command_get_float(command, "opacity", 1.0f);
+    const char* opacity_str = ipc_command_get_string(command, "opacity", NULL);
+    if (opacity_str && strlen(opacity_str) > 0) {
+        opacity = (float)atof(opacity_str);
     }
+    platform_window_set_opacity(webview_get_window(((webview_view_t*)target)->webview), opacity);
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static int method_window_set_resizable(void* target, const ipc_command_t* command) {
+    int resizable = ipc_command_get_bool(command, "resizable", 1);
+    platform_window_set_resizable(webview_get_window(((webview_view_t*)target)->webview), resizable);
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static int method_window_set_position(void* target, const ipc_command_t* command) {
+    int x = ipc_command_get_int(command, "x", 0);
+    int y = ipc_command_get_int(command, "y", 0);
+    platform_window_set_position(webview_get_window(((webview_view_t*)target)->webview), x, y);
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static int method_window_center(void* target, const ipc_command_t* command) {
+    platform_window_center(webview_get_window(((webview_view_t*)target)->webview));
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static int method_window_minimize(void* target, const ipc_command_t* command) {
+    platform_window_minimize(webview_get_window(((webview_view_t*)target)->webview));
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static int method_window_maximize(void* target, const ipc_command_t* command) {
+    platform_window_maximize(webview_get_window(((webview_view_t*)target)->webview));
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static int method_window_restore(void* target, const ipc_command_t* command) {
+    platform_window_restore(webview_get_window(((webview_view_t*)target)->webview));
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static int method_window_hide(void* target, const ipc_command_t* command) {
+    platform_window_hide(webview_get_window(((webview_view_t*)target)->webview));
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static int method_window_show(void* target, const ipc_command_t* command) {
+    platform_window_show(webview_get_window(((webview_view_t*)target)->webview));
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+// Param schemas
+static const ipc_param_spec_t set_title_params[] = {{"title", IPC_PARAM_STRING, 0}, {NULL, IPC_PARAM_ANY, 0}};
+static const ipc_param_spec_t set_size_params[] = {
+    {"width", IPC_PARAM_NUMBER, 0}, {"height", IPC_PARAM_NUMBER, 0}, {"hints", IPC_PARAM_NUMBER, 0},
+    {NULL, IPC_PARAM_ANY, 0}
+};
+static const ipc_param_spec_t navigate_params[] = {{"url", IPC_PARAM_STRING, 1}, {NULL, IPC_PARAM_ANY, 0}};
+static const ipc_param_spec_t set_html_params[] = {{"html", IPC_PARAM_STRING, 1}, {NULL, IPC_PARAM_ANY, 0}};
+static const ipc_param_spec_t js_params[] = {{"js", IPC_PARAM_STRING, 1}, {NULL, IPC_PARAM_ANY, 0}};
+static const ipc_param_spec_t name_params[] = {{"name", IPC_PARAM_STRING, 1}, {NULL, IPC_PARAM_ANY, 0}};
+static const ipc_param_spec_t share_file_params[] = {{"path", IPC_PARAM_STRING, 1}, {NULL, IPC_PARAM_ANY, 0}};
+static const ipc_param_spec_t unshare_file_params[] = {{"token", IPC_PARAM_STRING, 1}, {NULL, IPC_PARAM_ANY, 0}};
+static const ipc_param_spec_t ipc_response_params[] = {
+    {"id", IPC_PARAM_STRING, 1}, {"result", IPC_PARAM_ANY, 0}, {"echo", IPC_PARAM_BOOL, 0},
+    {"error", IPC_PARAM_STRING, 0}, {"binary", IPC_PARAM_BOOL, 0},
+    {NULL, IPC_PARAM_ANY, 0}
+};
+static const ipc_param_spec_t batch_params[] = {
+    {"commands", IPC_PARAM_ARRAY, 1}, {"stop_on_error", IPC_PARAM_BOOL, 0},
+    {NULL, IPC_PARAM_ANY, 0}
+};
+static const ipc_param_spec_t on_top_params[] = {{"on_top", IPC_PARAM_BOOL, 0}, {NULL, IPC_PARAM_ANY, 0}};
+static const ipc_param_spec_t opacity_params[] = {{"opacity", IPC_PARAM_ANY, 0}, {NULL, IPC_PARAM_ANY, 0}};
+static const ipc_param_spec_t resizable_params[] = {{"resizable", IPC_PARAM_BOOL, 0}, {NULL, IPC_PARAM_ANY, 0}};
+static const ipc_param_spec_t position_params[] = {
+    {"x", IPC_PARAM_NUMBER, 0}, {"y", IPC_PARAM_NUMBER, 0},
+    {NULL, IPC_PARAM_ANY, 0}
+};
+
+// Every webview method is registered here, and only here
+static ipc_method_t g_webview_methods[] = {
+    {"set_title",                 method_set_title,                 set_title_params,    0, 0, 0, 0},
+    {"set_size",                  method_set_size,                  set_size_params,     0, 0, 0, 0},
+    {"navigate",                  method_navigate,                  navigate_params,     0, 0, 0, 0},
+    {"set_html",                  method_set_html,                  set_html_params,     0, 0, 0, 0},
+    {"eval",                      method_eval,                      js_params,           0, 0, 0, 0},
+    {"init",                      method_init,                      js_params,           0, 0, 0, 0},
+    {"bind",                      method_bind,                      name_params,         0, 0, 0, 0},
+    {"unbind",                    method_unbind,                    name_params,         0, 0, 0, 0},
+    {"terminate",                 method_terminate,                 NULL,                0, 0, 0, 0},
+    {"reset",                     method_reset,                     NULL,                0, 0, 0, 0},
+    {"get_window",                method_get_window,                NULL,                0, 0, 0, 0},
+    {"get_version",               method_get_version,               NULL,                0, 0, 0, 0},
+    {"get_metrics",               method_get_metrics,               NULL,                0, 0, 0, 0},
+    {"isready",                   method_isready,                   NULL,                0, 0, 0, 0},
+    {"share_file",                method_share_file,                share_file_params,   0, 0, 0, 0},
+    {"unshare_file",              method_unshare_file,              unshare_file_params, 0, 0, 0, 0},
+    {"batch",                     method_batch,                     batch_params,        0, 0, 0, 0},
+    {"ipc:response",              method_ipc_response,              ipc_response_params, 0, 0, 0, 0},
+    {"window_set_transparent",    method_window_set_transparent,    NULL,                0, 0, 0, 0},
+    {"window_set_opaque",         method_window_set_opaque,         NULL,                0, 0, 0, 0},
+    {"window_enable_blur",        method_window_enable_blur,        NULL,                0, 0, 0, 0},
+    {"window_remove_decorations", method_window_remove_decorations, NULL,                0, 0, 0, 0},
+    {"window_add_decorations",    method_window_add_decorations,    NULL,                0, 0, 0, 0},
+    {"window_set_always_on_top",  method_window_set_always_on_top,  on_top_params,       0, 0, 0, 0},
+    {"window_set_opacity",        method_window_set_opacity,        opacity_params,      0, 0, 0, 0},
+    {"window_set_resizable",      method_window_set_resizable,      resizable_params,    0, 0, 0, 0},
+    {"window_set_position",       method_window_set_position,       position_params,     0, 0, 0, 0},
+    {"window_center",             method_window_center,             NULL,                0, 0, 0, 0},
+    {"window_minimize",           method_window_minimize,           NULL,                0, 0, 0, 0},
+    {"window_maximize",           method_window_maximize,           NULL,                0, 0, 0, 0},
+    {"window_restore",            method_window_restore,            NULL,                0, 0, 0, 0},
+    {"window_hide",               method_window_hide,               NULL,                0, 0, 0, 0},
+    {"window_show",               method_window_show,               NULL,                0, 0, 0, 0},
+};
+
+static ipc_method_table_t g_webview_method_table;
+
+static int method_get_metrics(void* target, const ipc_command_t* command) {
+    (void)target;
+    char* metrics = ipc_method_table_metrics_json(&g_webview_method_table);
+    ipc_write_json_response(command->id, metrics ? metrics : "{}", NULL);
+    free(metrics);
+    return 0;
+}
+
+// Run one command through the method table and report webview errors
+static void run_command(void* target, const ipc_command_t* command) {
+    int result = WEBVIEW_ERROR_OK;
+    ipc_dispatch_result_t dispatched = ipc_method_table_dispatch(&g_webview_method_table, target, command, &result);
     
-    if (result != WEBVIEW_ERROR_OK) {
+    if (dispatched == IPC_DISPATCH_UNKNOWN_METHOD) {
+        ipc_write_response(command->id, NULL, "Unknown method");
+    } else if (dispatched == IPC_DISPATCH_OK && result != WEBVIEW_ERROR_OK) {
         char error_msg[256];
         snprintf(error_msg, sizeof(error_msg), "WebView error: %d", result);
-        ipc_write_response(id, NULL, error_msg);
+        ipc_write_response(command->id, NULL, error_msg);
+    }
+}
+
+// Runs every sub-command within this one main-thread dispatch
+static int method_batch(void* target, const ipc_command_t* command) {
+    ipc_run_batch(command, run_command, target);
+    return 0;
+}
+
+// Initial window configuration, given at spawn time (TRONBUN_CONFIG) or in
+// host_create_webview, so the window appears configured without round trips:
+//   {"title", "width", "height", "hints", "debug", "url", "html", "init": [js...],
+//    "decorations", "transparent", "opaque", "blur", "always_on_top", "resizable",
+//    "position": {"x", "y"}, "center", "hidden", "show_when": "paint"|"mark"}
+static const char* config_string(const cJSON* config, const char* key) {
+    const cJSON* item = cJSON_GetObjectItem(config, key);
+    return cJSON_IsString(item) ? cJSON_GetStringValue(item) : NULL;
+}
+
+static int config_bool(const cJSON* config, const char* key, int fallback) {
+    const cJSON* item = cJSON_GetObjectItem(config, key);
+    return cJSON_IsBool(item) ? cJSON_IsTrue(item) : fallback;
+}
+
+static int config_int(const cJSON* config, const char* key, int fallback) {
+    const cJSON* item = cJSON_GetObjectItem(config, key);
+    return cJSON_IsNumber(item) ? (int)cJSON_GetNumberValue(item) : fallback;
+}
+
+// Devtools stay enabled unless the configuration turns them off
+static int window_config_debug(const cJSON* config) {
+    return config_bool(config, "debug", 1);
+}
+
+// Parse TRONBUN_CONFIG; NULL when unset or invalid
+static cJSON* read_window_config(void) {
+    const char* text = getenv("TRONBUN_CONFIG");
+    if (!text || !*text) return NULL;
+    
+    cJSON* config = cJSON_Parse(text);
+    if (!cJSON_IsObject(config)) {
+        fprintf(stderr, "Ignoring invalid TRONBUN_CONFIG\n");
+        cJSON_Delete(config);
+        return NULL;
+    }
+    return config;
+}
+
+// Apply a configuration to a webview that has not been shown by the loop yet
+static void apply_window_config(webview_view_t* view, const cJSON* config) {
+    if (!config) return;
+    webview_t w = view->webview;
+    void* window = webview_get_window(w);
+    
+    const char* title = config_string(config, "title");
+    if (title) webview_set_title(w, title);
+    
+    int width = config_int(config, "width", 0);
+    int height = config_int(config, "height", 0);
+    if (width > 0 && height > 0) {
+        webview_set_size(w, width, height, (webview_hint_t)config_int(config, "hints", 0));
+    }
+    
+    // Init scripts must be registered before the first page loads
+    const cJSON* script = NULL;
+    cJSON_ArrayForEach(script, cJSON_GetObjectItem(config, "init")) {
+        if (!cJSON_IsString(script)) continue;
+        webview_init(w, cJSON_GetStringValue(script));
+        view->tainted = 1;
+    }
+    
+    const char* html = config_string(config, "html");
+    const char* url = config_string(config, "url");
+    if (html) {
+        view_mark_navigation(view);
+        webview_set_html(w, html);
+    } else if (url) {
+        view_mark_navigation(view);
+        webview_navigate(w, url);
+    }
+    
+    if (!config_bool(config, "decorations", 1)) platform_window_remove_decorations(window);
+    if (config_bool(config, "transparent", 0)) platform_window_set_transparent(window);
+    if (config_bool(config, "opaque", 0)) platform_window_set_opaque(window);
+    if (config_bool(config, "blur", 0)) {
+        platform_window_enable_blur(window);
+        view->tainted = 1;
+    }
+    if (config_bool(config, "always_on_top", 0)) platform_window_set_always_on_top(window, 1);
+    if (cJSON_IsBool(cJSON_GetObjectItem(config, "resizable"))) {
+        platform_window_set_resizable(window, config_bool(config, "resizable", 1));
+    }
+    
+    const cJSON* position = cJSON_GetObjectItem(config, "position");
+    if (cJSON_IsObject(position)) {
+        platform_window_set_position(window, config_int(position, "x", 0), config_int(position, "y", 0));
+    } else if (config_bool(config, "center", 0)) {
+        platform_window_center(window);
+    }
+    
+    // Held back until the first paint or the page's ready mark; a hidden window stays hidden
+    const char* show_when = config_string(config, "show_when");
+    if (config_bool(config, "hidden", 0)) {
+        platform_window_hide(window);
+    } else if (show_when && (strcmp(show_when, "paint") == 0 || strcmp(show_when, "mark") == 0)) {
+        view->show_when = strcmp(show_when, "mark") == 0 ? WEBVIEW_SHOW_ON_MARK : WEBVIEW_SHOW_ON_PAINT;
+        platform_window_hide(window);
+    }
+}
+
+// Host mode: objects created by host_create_* and addressed by the command target
+#define HOST_MAX_OBJECTS 64
+
+typedef enum {
+    HOST_OBJECT_NONE = 0,
+    HOST_OBJECT_WEBVIEW,
+    HOST_OBJECT_TRAY
+} host_object_kind_t;
+
+typedef struct {
+    host_object_kind_t kind;
+    int handle;  // Chosen by the parent, so it can send commands before the create is answered
+    webview_view_t* view;
+    tray_context_t* tray;
+} host_object_t;
+
+static host_object_t g_host_objects[HOST_MAX_OBJECTS];
+
+static host_object_t* host_find(int handle) {
+    if (handle < 0) return NULL;
+    for (int i = 0; i < HOST_MAX_OBJECTS; i++) {
+        if (g_host_objects[i].kind != HOST_OBJECT_NONE && g_host_objects[i].handle == handle) {
+            return &g_host_objects[i];
+        }
+    }
+    return NULL;
+}
+
+// Find a free slot for a new handle; answers the command itself on failure
+static host_object_t* host_reserve(const ipc_command_t* command, int handle) {
+    if (handle < 0 || host_find(handle)) {
+        ipc_write_response(command->id, NULL, "Handle must be unused and >= 0");
+        return NULL;
+    }
+    for (int i = 0; i < HOST_MAX_OBJECTS; i++) {
+        if (g_host_objects[i].kind == HOST_OBJECT_NONE) {
+            g_host_objects[i].handle = handle;
+            return &g_host_objects[i];
+        }
+    }
+    ipc_write_response(command->id, NULL, "Too many host objects");
+    return NULL;
+}
+
+static void host_destroy_view(void* data) {
+    webview_view_t* view = (webview_view_t*)data;
+    binary_calls_cancel(view, "Window closed");
+    webview_destroy(view->webview);
+    while (view->bindings) {
+        bind_callback_data_t* binding = view->bindings;
+        view->bindings = binding->next;
+        free(binding);
+    }
+    free(view);
+}
+
+// Free a slot. Webviews are destroyed on a later loop iteration, since this
+// may run inside their own close callback; the callback ignores freed handles.
+static void host_release(host_object_t* object) {
+    if (object->kind == HOST_OBJECT_WEBVIEW) {
+        platform_tray_dispatch(host_destroy_view, object->view);
+    } else if (object->kind == HOST_OBJECT_TRAY) {
+        tray_context_free(object->tray);
+    }
+    memset(object, 0, sizeof(host_object_t));
+}
+
+static void host_close(int handle) {
+    host_object_t* object = host_find(handle);
+    if (object) host_release(object);
+}
+
+// The user closed a hosted window: tell the parent, which drops the object
+static void host_on_window_closed(void* userdata) {
+    int handle = (int)(intptr_t)userdata;
+    host_object_t* object = host_find(handle);
+    if (!object) return;  // Released by the parent
+    
+    ipc_json_writer_t writer;
+    ipc_json_writer_begin(&writer);
+    ipc_json_writer_append(&writer, "{\"type\":\"host:closed\"");
+    write_event_target(&writer, handle);
+    ipc_json_writer_append_n(&writer, "}", 1);
+    ipc_json_writer_send(&writer);
+    
+    host_release(object);
+}
+
+static void webview_view_setup(webview_view_t* view);
+
+// Host method handlers; their target is the thread context
+static int method_host_create_webview(void* target, const ipc_command_t* command) {
+    (void)target;
+    host_object_t* object = host_reserve(command, ipc_command_get_int(command, "handle", -1));
+    if (!object) return -1;
+    
+    const cJSON* config = ipc_command_get_param(command, "config");
+    webview_view_t* view = (webview_view_t*)calloc(1, sizeof(webview_view_t));
+    view->handle = object->handle;
+    view->startup.started_ms = ipc_now_ms();
+    view->webview = webview_create(window_config_debug(config), NULL);
+    if (view->webview == NULL) {
+        free(view);
+        ipc_write_response(command->id, NULL, "Failed to create webview");
+        return -1;
+    }
+    webview_view_setup(view);
+    apply_window_config(view, config);
+    platform_window_set_close_callback(webview_get_window(view->webview), host_on_window_closed,
+                                       (void*)(intptr_t)view->handle);
+    
+    object->kind = HOST_OBJECT_WEBVIEW;
+    object->view = view;
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static int method_host_create_tray(void* target, const ipc_command_t* command) {
+    (void)target;
+    host_object_t* object = host_reserve(command, ipc_command_get_int(command, "handle", -1));
+    if (!object) return -1;
+    
+    tray_context_t* tray = tray_context_create(object->handle, ipc_command_get_string(command, "icon", NULL),
+                                               ipc_command_get_string(command, "tooltip", "Tronbun Tray"));
+    if (!tray) {
+        ipc_write_response(command->id, NULL, "Failed to create tray");
+        return -1;
+    }
+    
+    object->kind = HOST_OBJECT_TRAY;
+    object->tray = tray;
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static int method_host_destroy(void* target, const ipc_command_t* command) {
+    (void)target;
+    host_object_t* object = host_find(ipc_command_get_int(command, "handle", -1));
+    if (!object) {
+        ipc_write_response(command->id, NULL, "Unknown target");
+        return -1;
+    }
+    host_release(object);
+    ipc_write_response(command->id, "true", NULL);
+    return 0;
+}
+
+static const ipc_param_spec_t host_create_webview_params[] = {
+    {"handle", IPC_PARAM_NUMBER, 1}, {"config", IPC_PARAM_OBJECT, 0},
+    {NULL, IPC_PARAM_ANY, 0}
+};
+static const ipc_param_spec_t host_create_tray_params[] = {
+    {"handle", IPC_PARAM_NUMBER, 1}, {"icon", IPC_PARAM_STRING, 0}, {"tooltip", IPC_PARAM_STRING, 0},
+    {NULL, IPC_PARAM_ANY, 0}
+};
+static const ipc_param_spec_t host_destroy_params[] = {{"handle", IPC_PARAM_NUMBER, 1}, {NULL, IPC_PARAM_ANY, 0}};
+
+// Commands without a target are addressed to the host itself
+static ipc_method_t g_host_methods[] = {
+    {"host_create_webview", method_host_create_webview, host_create_webview_params, 0, 0, 0, 0},
+    {"host_create_tray",    method_host_create_tray,    host_create_tray_params,    0, 0, 0, 0},
+    {"host_destroy",        method_host_destroy,        host_destroy_params,        0, 0, 0, 0},
+};
+
+static ipc_method_table_t g_host_method_table;
+
+// Route one command to the host or to the object its target names
+static void run_host_command(thread_context_t* context, const ipc_command_t* command) {
+    if (command->target < 0) {
+        if (ipc_method_table_dispatch(&g_host_method_table, context, command, NULL) == IPC_DISPATCH_UNKNOWN_METHOD) {
+            ipc_write_response(command->id, NULL, "Unknown host method");
+        }
+        return;
+    }
+    
+    host_object_t* object = host_find(command->target);
+    if (!object) {
+        ipc_write_response(command->id, NULL, "Unknown target");
+    } else if (object->kind == HOST_OBJECT_WEBVIEW) {
+        run_command(object->view, command);
+    } else {
+        tray_run_method(object->tray, command);
+        if (object->tray->base.should_exit) {
+            host_release(object);  // tray_destroy ran
+        }
     }
+}
+
+// Run a pooled command on the main thread, within its pipeline slot
+static void execute_pooled_command(ipc_pooled_command_t* cmd) {
+    thread_context_t* context = (thread_context_t*)cmd->context;
     
-    *cmd->response_ready = 1;
-    free(cmd);
+    // Its deadline passed while queued; the error went out under its id already
+    if (!ipc_pipeline_begin(&context->pipeline, &cmd->entry)) {
+        ipc_command_pool_release(cmd);
+        return;
+    }
+    
+    fprintf(stderr, "Executing command: %s\n", cmd->command.method);
+    if (context->host) {
+        run_host_command(context, &cmd->command);
+    } else {
+        run_command(&context->view, &cmd->command);
+    }
+    
+    ipc_pipeline_end(&context->pipeline, &cmd->entry);
+    ipc_command_pool_release(cmd);
+}
+
+// Function to be called on the main thread to execute commands
+void execute_command_dispatch(webview_t w, void* arg) {
+    (void)w; // Suppress unused parameter warning
+    execute_pooled_command((ipc_pooled_command_t*)arg);
+}
+
+// Host mode equivalent, queued on the shared event loop
+static void host_execute_command(void* arg) {
+    execute_pooled_command((ipc_pooled_command_t*)arg);
 }
 
 // Thread function that monitors stdin for commands
 THREAD_RETURN stdin_monitor_thread(THREAD_ARG arg) {
     thread_context_t* context = (thread_context_t*)arg;
-    char command_buffer[IPC_MAX_COMMAND_LENGTH];
     
-    fprintf(stderr, "Command monitor thread started (reading from stdin)\n");
+    fprintf(stderr, "Command monitor thread started (reading from stdin, %d in flight)\n",
+            context->pipeline.window);
+    
+    ipc_reader_t reader;
+    ipc_reader_init(&reader);
     
     while (!context->should_exit) {
-        // Read command from stdin
-        if (fgets(command_buffer, sizeof(command_buffer), stdin) != NULL) {
-            // Remove newline if present
-            size_t len = strlen(command_buffer);
-            if (len > 0 && command_buffer[len-1] == '\n') {
-                command_buffer[len-1] = '\0';
-            }
-            
-            if (strlen(command_buffer) > 0) {
-                fprintf(stderr, "New command detected: %s\n", command_buffer);
-                
-                // Create command dispatch structure
-                command_dispatch_t* cmd = (command_dispatch_t*)malloc(sizeof(command_dispatch_t));
-                if (cmd != NULL) {
-                    cmd->webview = context->webview;
-                    strncpy(cmd->command, command_buffer, IPC_MAX_COMMAND_LENGTH - 1);
-                    cmd->command[IPC_MAX_COMMAND_LENGTH - 1] = '\0';
-                    
-                    int response_ready = 0;
-                    cmd->response_ready = &response_ready;
-                    
-                    // Dispatch the command to the main thread
-                    webview_dispatch(context->webview, execute_command_dispatch, cmd);
-                    
-                    // Wait for response (with timeout)
-                    int timeout_count = 0;
-                    while (!response_ready && timeout_count < 100) {
-                        thread_sleep(10);
-                        timeout_count++;
-                    }
-                    
-                    if (!response_ready) {
-                        ipc_write_response("unknown", NULL, "Command timeout");
-                    }
-                }
-            }
-        } else {
+        // Read command from stdin (a line or a frame, of any size) into a reused buffer
+        size_t length = 0;
+        const char* command_buffer = ipc_reader_next(&reader, stdin, &length);
+        if (command_buffer == NULL) {
             // EOF or error on stdin
             fprintf(stderr, "stdin closed, exiting command monitor\n");
             context->should_exit = 1;
-            webview_terminate(context->webview);
+            ipc_pipeline_shutdown(&context->pipeline);
+            if (context->host) {
+                platform_tray_quit_event_loop();
+            } else {
+                webview_terminate(context->view.webview);
+            }
+            break;
+        }
+        
+        if (length == 0) {
+            continue;
+        }
+        
+        ipc_pooled_command_t* cmd = ipc_command_pool_acquire(&context->pool, context);
+        if (cmd == NULL) {
+            continue;
+        }
+        
+        // Parse here so the main thread only executes, and so errors carry the real id
+        if (!ipc_command_pool_parse(cmd, command_buffer)) {
+            ipc_write_response(cmd->command.id, NULL, "Invalid command format");
+            ipc_command_pool_release(cmd);
+            continue;
+        }
+        
+        // Raw bytes of a binary frame move to the command with the read buffer
+        ipc_reader_detach_attachment(&reader, &cmd->command);
+        
+        // Blocks only while the in-flight window is full; responses are matched by id
+        if (!ipc_pipeline_submit(&context->pipeline, &cmd->entry, cmd->command.id, cmd->command.deadline_ms)) {
+            ipc_command_pool_release(cmd);
             break;
         }
+        
+        if (context->host) {
+            platform_tray_dispatch(host_execute_command, cmd);
+        } else {
+            webview_dispatch(context->view.webview, execute_command_dispatch, cmd);
+        }
     }
     
+    ipc_reader_destroy(&reader);
     fprintf(stderr, "Command monitor thread exiting\n");
     return 0;
 }
 
-#ifdef _WIN32
-int WINAPI WinMain(HINSTANCE hInst, HINSTANCE hPrevInst, LPSTR lpCmdLine, int nCmdShow) {
-    (void)hInst; (void)hPrevInst; (void)lpCmdLine; (void)nCmdShow;
-#else
-int main(void) {
-#endif
-    fprintf(stderr, "Starting WebView with stdin/stdout IPC...\n");
+// tronbun:// scheme: tronbun://app/<path> serves the asset root configured
+// at spawn time, "assets": {"root": "...", "max_age": seconds}, and
+// tronbun://file/<token> serves files shared with share_file
+#define ASSET_SCHEME "tronbun"
+
+static asset_server_t g_asset_server;
+static int g_assets_enabled = 0;
+static asset_file_table_t g_shared_files;  // Shared by every view of the process
+static webview_view_t* g_single_view;      // The process's webview, outside host mode
+
+// Lives until the engine is done with the body
+typedef struct {
+    asset_response_t asset;
+    const char* headers[11];
+} scheme_reply_t;
+
+static void assets_init(const cJSON* config) {
+    const cJSON* assets = cJSON_GetObjectItem(config, "assets");
+    const char* root = config_string(assets, "root");
+    if (!root) return;
+    g_assets_enabled = asset_server_init(&g_asset_server, root, config_int(assets, "max_age", 0));
+}
+
+static void release_scheme_reply(void* owner) {
+    scheme_reply_t* reply = (scheme_reply_t*)owner;
+    asset_response_free(&reply->asset);
+    free(reply);
+}
+
+// Whether a scheme URI names the given host, as in tronbun://<host>/...
+static int scheme_host_is(const char* uri, const char* host) {
+    const char* prefix = ASSET_SCHEME "://";
+    size_t prefix_length = strlen(prefix);
+    size_t host_length = strlen(host);
+    if (!uri || strncmp(uri, prefix, prefix_length) != 0 || strncmp(uri + prefix_length, host, host_length) != 0) {
+        return 0;
+    }
+    char next = uri[prefix_length + host_length];
+    return next == '/' || next == '\0' || next == '?' || next == '#';
+}
+
+// Binary page-to-Bun calls: invoke with an ArrayBuffer or a typed array
+// POSTs the bytes to tronbun://ipc/<channel>. They go to Bun as the
+// attachment of one binary frame,
+//   {"type":"ipc:call","id":"__bunwebview_invoke","seq":"bin-<n>","channel":"...","binary":true}
+// and the request is answered when Bun's ipc:response for the seq arrives
+typedef struct binary_call {
+    struct binary_call* next;
+    char seq[32];
+    void* request;                // Deferred scheme request
+    const webview_view_t* view;   // Page that made the call; cancelled with it
+} binary_call_t;
+
+static binary_call_t* g_binary_calls;  // UI thread only, like the scheme handler
+static unsigned long g_binary_call_count;
+
+// Pages fetch from their own origin, so the scheme answers cross-origin
+static const char* const g_binary_call_headers[] = {
+    "Access-Control-Allow-Origin", "*",
+    "Access-Control-Allow-Methods", "POST",
+    "Cache-Control", "no-store",
+    NULL
+};
+
+static webview_view_t* view_for_window(void* native_window) {
+    if (!native_window) return NULL;
+    for (int i = 0; i < HOST_MAX_OBJECTS; i++) {
+        if (g_host_objects[i].kind == HOST_OBJECT_WEBVIEW &&
+            webview_get_window(g_host_objects[i].view->webview) == native_window) {
+            return g_host_objects[i].view;
+        }
+    }
+    if (g_single_view && webview_get_window(g_single_view->webview) == native_window) {
+        return g_single_view;
+    }
+    return NULL;
+}
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// The channel is the percent-encoded path after the leading slash
+static int decode_channel(const char* path, char* out, size_t size) {
+    size_t length = 0;
+    if (!path) return 0;
+    if (*path == '/') path++;
     
-    // Create webview
-    webview_t w = webview_create(1, NULL); // debug=1 for development
-    if (w == NULL) {
-        fprintf(stderr, "Failed to create webview\n");
-        return 1;
+    while (*path) {
+        int c = (unsigned char)*path++;
+        if (c == '%') {
+            int high = hex_digit(path[0]);
+            int low = high < 0 ? -1 : hex_digit(path[1]);
+            if (low < 0) return 0;
+            c = high * 16 + low;
+            path += 2;
+        }
+        if (c == 0 || length + 1 >= size) return 0;
+        out[length++] = (char)c;
+    }
+    out[length] = '\0';
+    return length > 0;
+}
+
+static void binary_call_reply(platform_scheme_response_t* response, int status, const char* message) {
+    response->status = status;
+    response->content_type = "text/plain; charset=utf-8";
+    response->body = (const unsigned char*)message;
+    response->length = strlen(message);
+    response->headers = g_binary_call_headers;
+}
+
+static void serve_binary_call(const platform_scheme_request_t* request, platform_scheme_response_t* response) {
+    if (request->method && strcmp(request->method, "OPTIONS") == 0) {
+        binary_call_reply(response, 204, "");
+        return;
+    }
+    if (!request->method || strcmp(request->method, "POST") != 0) {
+        binary_call_reply(response, 405, "Binary calls must be POSTed");
+        return;
+    }
+    
+    char channel[256];
+    webview_view_t* view = view_for_window(request->native_window);
+    if (!view || !decode_channel(request->path, channel, sizeof(channel))) {
+        binary_call_reply(response, 400, "Unknown window or channel");
+        return;
+    }
+    
+    binary_call_t* call = (binary_call_t*)calloc(1, sizeof(binary_call_t));
+    if (!call) {
+        binary_call_reply(response, 500, "Out of memory");
+        return;
+    }
+    snprintf(call->seq, sizeof(call->seq), "bin-%lu", ++g_binary_call_count);
+    
+    ipc_json_writer_t writer;
+    ipc_json_writer_begin(&writer);
+    ipc_json_writer_append(&writer, "{\"type\":\"ipc:call\",\"id\":\"__bunwebview_invoke\"");
+    write_event_target(&writer, view->handle);
+    ipc_json_writer_append(&writer, ",\"seq\":");
+    ipc_json_writer_string(&writer, call->seq);
+    ipc_json_writer_append(&writer, ",\"channel\":");
+    ipc_json_writer_string(&writer, channel);
+    ipc_json_writer_append(&writer, ",\"binary\":true}");
+    if (!ipc_json_writer_send_binary(&writer, request->body, request->body_length)) {
+        free(call);
+        binary_call_reply(response, 413, "Binary calls need length framing and at most 1 GB");
+        return;
+    }
+    
+    // Bun's answer is dispatched to this thread, so it can't arrive before this returns
+    call->request = request->handle;
+    call->view = view;
+    call->next = g_binary_calls;
+    g_binary_calls = call;
+    response->deferred = 1;
+}
+
+// Fail the calls of a view whose page or window goes away, so no request
+// outlives it; Bun's later answers for them are dropped
+static void binary_calls_cancel(const webview_view_t* view, const char* reason) {
+    binary_call_t** link = &g_binary_calls;
+    while (*link) {
+        binary_call_t* call = *link;
+        if (call->view != view) {
+            link = &call->next;
+            continue;
+        }
+        *link = call->next;
+        
+        platform_scheme_response_t response;
+        memset(&response, 0, sizeof(response));
+        binary_call_reply(&response, 503, reason);
+        platform_scheme_finish(call->request, &response);
+        free(call);
+    }
+}
+
+static unsigned char* copy_bytes(const void* data, size_t length) {
+    unsigned char* copy = (unsigned char*)malloc(length ? length : 1);
+    if (copy && length) memcpy(copy, data, length);
+    return copy;
+}
+
+// Answer a pending binary call: the attachment as bytes when Bun marked its
+// reply binary, its error as a 500, or its JSON result
+static int binary_call_finish(const char* seq, const ipc_command_t* command) {
+    binary_call_t** link = &g_binary_calls;
+    while (*link && strcmp((*link)->seq, seq) != 0) {
+        link = &(*link)->next;
+    }
+    binary_call_t* call = *link;
+    if (!call) return 0;
+    *link = call->next;
+    
+    platform_scheme_response_t response;
+    memset(&response, 0, sizeof(response));
+    response.status = 200;
+    response.headers = g_binary_call_headers;
+    
+    const char* error = ipc_command_get_string(command, "error", NULL);
+    char* printed = NULL;
+    unsigned char* body;
+    size_t length;
+    if (error) {
+        response.status = 500;
+        response.content_type = "text/plain; charset=utf-8";
+        length = strlen(error);
+        body = copy_bytes(error, length);
+    } else if (ipc_command_get_bool(command, "binary", 0)) {
+        response.content_type = "application/octet-stream";
+        length = command->attachment_length;
+        body = copy_bytes(command->attachment, length);
+    } else {
+        const char* result = ipc_command_get_raw_param(command, "result", &length);
+        if (!result) {
+            const cJSON* result_item = ipc_command_get_param(command, "result");
+            printed = result_item ? cJSON_PrintUnformatted(result_item) : NULL;
+            result = printed ? printed : "null";
+            length = strlen(result);
+        }
+        response.content_type = "application/json";
+        body = copy_bytes(result, length);
+    }
+    cJSON_free(printed);
+    
+    if (!body) {
+        response.status = 500;
+        length = 0;
+    }
+    response.body = body;
+    response.length = length;
+    response.release = free;
+    response.owner = body;
+    platform_scheme_finish(call->request, &response);
+    free(call);
+    return 1;
+}
+
+static void serve_scheme_request(void* userdata, const platform_scheme_request_t* request,
+                                 platform_scheme_response_t* response) {
+    (void)userdata;
+    scheme_reply_t* reply = (scheme_reply_t*)calloc(1, sizeof(scheme_reply_t));
+    if (!reply) {
+        response->status = 500;
+        response->content_type = "text/plain; charset=utf-8";
+        return;
+    }
+    
+    asset_response_t* asset = &reply->asset;
+    if (scheme_host_is(request->uri, "ipc")) {
+        free(reply);
+        serve_binary_call(request, response);
+        return;
+    }
+    if (scheme_host_is(request->uri, "app")) {
+        asset_server_handle(&g_asset_server, request->path, request->range, request->if_none_match,
+                            request->accept_encoding, asset);
+    } else if (scheme_host_is(request->uri, "file")) {
+        asset_files_handle(&g_shared_files, request->path, request->range, request->if_none_match, asset);
+    } else {
+        asset->status = 404;
+        asset->content_type = "text/plain; charset=utf-8";
+    }
+    
+    int count = 0;
+    reply->headers[count++] = "Accept-Ranges";
+    reply->headers[count++] = "bytes";
+    if (asset->etag[0]) {
+        reply->headers[count++] = "ETag";
+        reply->headers[count++] = asset->etag;
+    }
+    if (asset->cache_control[0]) {
+        reply->headers[count++] = "Cache-Control";
+        reply->headers[count++] = asset->cache_control;
+    }
+    if (asset->content_range[0]) {
+        reply->headers[count++] = "Content-Range";
+        reply->headers[count++] = asset->content_range;
+    }
+    if (asset->content_encoding) {
+        reply->headers[count++] = "Content-Encoding";
+        reply->headers[count++] = asset->content_encoding;
     }
+    reply->headers[count] = NULL;
     
+    response->status = asset->status;
+    response->content_type = asset->content_type;
+    response->body = asset->body;
+    response->length = asset->length;
+    response->file_path = asset->file_path;
+    response->file_offset = asset->file_offset;
+    response->headers = reply->headers;
+    response->release = release_scheme_reply;
+    response->owner = reply;
+}
+
+// Make a local file fetchable by pages as tronbun://file/<token> without
+// passing its contents through the JSON pipe
+static int method_share_file(void* target, const ipc_command_t* command) {
+    (void)target;
+    char token[ASSET_FILE_TOKEN_LENGTH + 1];
+    if (!asset_files_share(&g_shared_files, ipc_command_get_string(command, "path", ""), token)) {
+        ipc_write_response(command->id, NULL, "Not a readable file");
+        return 0;
+    }
+    char result[128];
+    snprintf(result, sizeof(result), "{\"token\":\"%s\",\"url\":\"%s://file/%s\"}", token, ASSET_SCHEME, token);
+    ipc_write_json_response(command->id, result, NULL);
+    return 0;
+}
+
+static int method_unshare_file(void* target, const ipc_command_t* command) {
+    (void)target;
+    int unshared = asset_files_unshare(&g_shared_files, ipc_command_get_string(command, "token", ""));
+    ipc_write_json_response(command->id, unshared ? "true" : "false", NULL);
+    return 0;
+}
+
+// Default title and size, the window.tronbun bridge and its invoke binding
+static void webview_view_setup(webview_view_t* view) {
     // Set initial properties
-    webview_set_title(w, "Tronbun default title");
-    webview_set_size(w, 800, 600, WEBVIEW_HINT_NONE);
+    webview_set_title(view->webview, DEFAULT_WINDOW_TITLE);
+    webview_set_size(view->webview, DEFAULT_WINDOW_WIDTH, DEFAULT_WINDOW_HEIGHT, WEBVIEW_HINT_NONE);
     
-    webview_init(w,
+    webview_init(view->webview,
       "(function() {"
+        // ArrayBuffers and typed arrays travel as raw bytes, POSTed to the
+        // scheme; without it they are base64-encoded in the JSON call
+        "var isBinary = function(data) {"
+          "return data instanceof ArrayBuffer || ArrayBuffer.isView(data);"
+        "};"
+        "var toBytes = function(data) {"
+          "return data instanceof ArrayBuffer ? new Uint8Array(data)"
+                                             ": new Uint8Array(data.buffer, data.byteOffset, data.byteLength);"
+        "};"
+        "var encodeBytes = function(bytes) {"
+          "var text = '';"
+          "for (var i = 0; i < bytes.length; i += 32768) {"
+            "text += String.fromCharCode.apply(null, bytes.subarray(i, i + 32768));"
+          "}"
+          "return { __tronbun_binary: btoa(text) };"
+        "};"
+        "var decodeResult = function(result) {"
+          "if (!result || typeof result.__tronbun_binary !== 'string') return result;"
+          "var text = atob(result.__tronbun_binary);"
+          "var bytes = new Uint8Array(text.length);"
+          "for (var i = 0; i < text.length; i++) bytes[i] = text.charCodeAt(i);"
+          "return bytes;"
+        "};"
+        // Arguments are serialized once by the binding as [channel, data]
+        "var call = function(channel, data) {"
+          "if (!isBinary(data)) {"
+            "return __bunwebview_invoke(channel, data === undefined ? null : data).then(decodeResult);"
+          "}"
+          "if (!window.tronbun._binaryFetch) {"
+            "return __bunwebview_invoke(channel, encodeBytes(toBytes(data))).then(decodeResult);"
+          "}"
+          // No Content-Type keeps the POST a simple request, without a preflight
+          "return fetch('" ASSET_SCHEME "://ipc/' + encodeURIComponent(channel), { method: 'POST', body: toBytes(data) })"
+            ".then(function(response) {"
+              "if (!response.ok) {"
+                "return response.text().then(function(text) { throw new Error(text || 'Binary call failed'); });"
+              "}"
+              "var type = response.headers.get('Content-Type') || '';"
+              "return type.indexOf('application/json') === 0"
+                "? response.json()"
+                ": response.arrayBuffer().then(function(buffer) { return new Uint8Array(buffer); });"
+            "});"
+        "};"
+        
         // Create the BunWebView IPC API
         "window.tronbun = {"
           "invoke: function(channel, data) {"
-            "return new Promise(function(resolve, reject) {"
-              "var id = Math.random().toString(36).substring(2);"
-              "window._bunwebview_pending = window._bunwebview_pending || {};"
-              "window._bunwebview_pending[id] = { resolve: resolve, reject: reject };"
-              
-              // Use the bound native function
-              "var request = JSON.stringify({"
-                "type: 'invoke',"
-                "channel: channel,"
-                "data: data,"
-                "id: id"
-              "});"
-
-              "console.log('Sending invoke request:', request);"
-              
-              "resolve(__bunwebview_invoke(id, request));"
-            "});"
+            "return call(channel, data);"
           "},"
           "send: function(channel, data) {"
-            "var request = JSON.stringify({"
-              "type: 'send',"
-              "channel: channel,"
-              "data: data"
-            "});"
-            
-            "__bunwebview_invoke('', request);"
+            "call(channel, data);"
+          "},"
+          // Shows a window waiting for the page's ready mark
+          "ready: function() {"
+            "__bunwebview_lifecycle('ready', location.href);"
           "}"
         "};"
         
@@ -421,24 +1520,175 @@ int main(void) {
           "}"
         "};"
         
+        // Lifecycle reports; init scripts run before the document is parsed
+        "var report = function(state) { __bunwebview_lifecycle(state, location.href); };"
+        "if (document.readyState === 'loading') {"
+          "document.addEventListener('DOMContentLoaded', function() { report('dom-ready'); });"
+        "} else {"
+          "report('dom-ready');"
+        "}"
+        "if (document.readyState === 'complete') {"
+          "report('finished');"
+        "} else {"
+          "window.addEventListener('load', function() { report('finished'); });"
+        "}"
+        "if (window.PerformanceObserver) {"
+          "try {"
+            "new PerformanceObserver(function(list, observer) {"
+              "if (list.getEntriesByName('first-contentful-paint').length) {"
+                "observer.disconnect();"
+                "report('first-paint');"
+              "}"
+            "}).observe({ type: 'paint', buffered: true });"
+          "} catch (e) {}"
+        "}"
+        
         "console.log('BunWebView IPC bridge initialized (thread-safe)');"
       "})();"
     );
 
     // Create callback data for the invoke handler
     bind_callback_data_t* invoke_callback_data = (bind_callback_data_t*)malloc(sizeof(bind_callback_data_t));
-    invoke_callback_data->webview = w;
+    invoke_callback_data->webview = view->webview;
+    invoke_callback_data->handle = view->handle;
     strncpy(invoke_callback_data->callback_id, "__bunwebview_invoke", sizeof(invoke_callback_data->callback_id) - 1);
     invoke_callback_data->callback_id[sizeof(invoke_callback_data->callback_id) - 1] = '\0';
     
-    webview_bind(w, "__bunwebview_invoke", handle_invoke_callback, invoke_callback_data);
+    webview_bind(view->webview, "__bunwebview_invoke", handle_invoke_callback, invoke_callback_data);
+    
+    view->startup.window_ms = ipc_now_ms();
+    webview_bind(view->webview, "__bunwebview_lifecycle", handle_lifecycle_callback, view);
+    view->native_load_events = platform_window_set_load_callback(webview_get_window(view->webview),
+                                                                 handle_load_event, view);
+    
+    // Registered even without an asset root, for shared files and binary calls
+    int scheme = platform_window_register_scheme(webview_get_window(view->webview), ASSET_SCHEME,
+                                                 serve_scheme_request, NULL);
+    if (!scheme && g_assets_enabled) {
+        fprintf(stderr, "The %s:// scheme is not supported on this platform\n", ASSET_SCHEME);
+    }
+    
+    // Bytes only travel raw when the scheme sees POST bodies and frames can
+    // carry them; otherwise the bridge sends them base64-encoded in the JSON call
+    if (scheme && platform_window_scheme_bodies_supported() && ipc_get_framing() == IPC_FRAMING_LENGTH) {
+        webview_init(view->webview, "window.tronbun._binaryFetch = true;");
+    }
+}
+
+static void thread_context_init(thread_context_t* context, int host) {
+    memset(context, 0, sizeof(thread_context_t));
+    context->view.handle = -1;
+    context->host = host;
+    ipc_pipeline_init_from_env(&context->pipeline);
+    
+    // Keep enough command objects for a full in-flight window
+    int pool_size = context->pipeline.window > IPC_COMMAND_POOL_MAX_FREE ? context->pipeline.window : IPC_COMMAND_POOL_MAX_FREE;
+    ipc_command_pool_init(&context->pool, pool_size);
+    ipc_command_pool_set_passthrough(&context->pool, "ipc:response", "result");
+}
+
+// Host mode: no window of its own; webviews and trays are created on request
+static int run_host(void) {
+    if (!tray_methods_init() ||
+        !ipc_method_table_init(&g_host_method_table, g_host_methods,
+                               (int)(sizeof(g_host_methods) / sizeof(g_host_methods[0])))) {
+        fprintf(stderr, "Failed to build host method table\n");
+        return 1;
+    }
+    if (platform_tray_init_event_loop() != 0) {
+        fprintf(stderr, "Failed to initialize the event loop\n");
+        return 1;
+    }
+    ipc_write_ready();
+    
+    // Process-wide settings from the spawn configuration; windows get theirs per create
+    cJSON* config = read_window_config();
+    assets_init(config);
+    cJSON_Delete(config);
+    
+    thread_context_t context;
+    thread_context_init(&context, 1);
+    thread_create(ipc_pipeline_watchdog_thread, &context.pipeline);
+    thread_create(stdin_monitor_thread, &context);
+    
+    fprintf(stderr, "Native host started, waiting for host_create_webview/host_create_tray...\n");
+    
+    // Closing a window stops the loop it runs in (the webview library
+    // terminates on close), so keep re-entering it until stdin closes
+    while (!context.should_exit) {
+        platform_tray_run_event_loop(NULL);
+    }
+    
+    fprintf(stderr, "Native host stopping, cleaning up...\n");
+    ipc_pipeline_shutdown(&context.pipeline);
+    thread_sleep(200);
+    
+    for (int i = 0; i < HOST_MAX_OBJECTS; i++) {
+        host_object_t* object = &g_host_objects[i];
+        if (object->kind == HOST_OBJECT_WEBVIEW) {
+            host_destroy_view(object->view);
+        } else if (object->kind == HOST_OBJECT_TRAY) {
+            tray_context_free(object->tray);
+        }
+        memset(object, 0, sizeof(host_object_t));
+    }
+    asset_server_free(&g_asset_server);
+    asset_files_free(&g_shared_files);
+    return 0;
+}
+
+#ifdef _WIN32
+int WINAPI WinMain(HINSTANCE hInst, HINSTANCE hPrevInst, LPSTR lpCmdLine, int nCmdShow) {
+    (void)hInst; (void)hPrevInst; (void)lpCmdLine; (void)nCmdShow;
+#else
+int main(void) {
+#endif
+    long long started_ms = ipc_now_ms();
+    fprintf(stderr, "Starting WebView with stdin/stdout IPC...\n");
+    
+    // Before anything touches cJSON: commands are parsed into arenas
+    ipc_init();
+    
+    // Switch to the transport framing requested by the parent process
+    ipc_framing_init_from_env();
+    
+    if (!ipc_method_table_init(&g_webview_method_table, g_webview_methods,
+                               (int)(sizeof(g_webview_methods) / sizeof(g_webview_methods[0])))) {
+        fprintf(stderr, "Failed to build method table\n");
+        return 1;
+    }
+    
+    // One process for every webview and tray of the app, when the parent asks for it
+    const char* host_mode = getenv("TRONBUN_HOST_MODE");
+    if (host_mode && strcmp(host_mode, "1") == 0) {
+        return run_host();
+    }
+    ipc_write_ready();
+    
+    // Create webview with the configuration from the parent, if any
+    cJSON* config = read_window_config();
+    webview_t w = webview_create(window_config_debug(config), NULL);
+    if (w == NULL) {
+        fprintf(stderr, "Failed to create webview\n");
+        cJSON_Delete(config);
+        return 1;
+    }
     
     // Set up thread context
     thread_context_t context;
-    context.webview = w;
-    context.should_exit = 0;
+    thread_context_init(&context, 0);
+    context.view.webview = w;
+    context.view.startup.started_ms = started_ms;
+    assets_init(config);
+    g_single_view = &context.view;
+    webview_view_setup(&context.view);
+    
+    // Everything lands before the first loop iteration, so no defaults are shown
+    apply_window_config(&context.view, config);
+    cJSON_Delete(config);
     
-    // Start the stdin monitoring thread
+    // Start the deadline watchdog and the stdin monitoring thread
+    thread_create(ipc_pipeline_watchdog_thread, &context.pipeline);
     thread_create(stdin_monitor_thread, &context);
     
     fprintf(stderr, "WebView created with stdin/stdout IPC, starting main loop...\n");
@@ -450,14 +1700,18 @@ int main(void) {
     
     fprintf(stderr, "Webview closed, cleaning up...\n");
     
-    // Signal the thread to exit
+    // Signal the threads to exit
     context.should_exit = 1;
+    ipc_pipeline_shutdown(&context.pipeline);
     
     // Give the thread time to exit gracefully
     thread_sleep(200);
     
     // Clean up
+    binary_calls_cancel(&context.view, "Window closed");
     webview_destroy(w);
+    asset_server_free(&g_asset_server);
+    asset_files_free(&g_shared_files);
     
     fprintf(stderr, "Cleanup complete. Exit code: %d\n", result);
     return result;